@@ -0,0 +1,116 @@
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <libslic3r/libslic3r.h>
+#include <libslic3r/ShortestPath.hpp>
+
+const std::string USAGE_STR = {
+    "Usage: chaining [num_segments ...]\n"
+    "Chains randomly placed short segments by the linear nearest neighbor search, by the grid based chain_segments()\n"
+    "and by chain_segments() followed by improve_chain_2opt(). Prints a JSON record with the run times and the travel\n"
+    "lengths for each number of segments and fails if the linear search and chain_segments() produce different chains."
+};
+
+using namespace Slic3r;
+
+// The linear nearest neighbor search, as it was implemented by PolylineCollection::_chained_path_from()
+// (tie_break == ctbLowestIndex) and by ExtrusionEntityCollection::chained_path_from() (tie_break == ctbHighestIndex).
+static std::vector<std::pair<size_t, bool>> chain_segments_linear(const Points &end_points, Point start_near, ChainTieBreak tie_break)
+{
+    std::vector<size_t> segments;
+    for (size_t i = 0; i < end_points.size() / 2; ++ i)
+        segments.emplace_back(i);
+    std::vector<std::pair<size_t, bool>> out;
+    while (! segments.empty()) {
+        size_t best = 0;
+        double best_dist = std::numeric_limits<double>::max();
+        for (size_t i = 0; i < segments.size() * 2; ++ i) {
+            const Point &pt = end_points[2 * segments[i / 2] + (i & 1)];
+            double d = sqr<double>(start_near(0) - pt(0)) + sqr<double>(start_near(1) - pt(1));
+            if (tie_break == ctbLowestIndex ? (d < best_dist) : (d <= best_dist)) {
+                best = i;
+                best_dist = d;
+                if (best_dist < EPSILON)
+                    break;
+            }
+        }
+        size_t segment = segments[best / 2];
+        bool   reverse = (best & 1) != 0;
+        out.emplace_back(segment, reverse);
+        segments.erase(segments.begin() + best / 2);
+        start_near = end_points[2 * segment + (reverse ? 0 : 1)];
+    }
+    return out;
+}
+
+// Segments of length up to 2mm placed randomly over a 250x210mm bed. If snap is set, the end points are snapped
+// to a 1mm grid to produce many candidates at the same distance, testing the tie breaking.
+static Points random_segments(size_t num_segments, bool snap)
+{
+    std::mt19937 rng(size_t(num_segments) * 2 + (snap ? 1 : 0));
+    std::uniform_real_distribution<double> bed_x(0., 250.), bed_y(0., 210.), offset(-1., 1.);
+    Points end_points;
+    end_points.reserve(num_segments * 2);
+    for (size_t i = 0; i < num_segments; ++ i) {
+        Vec2d a(bed_x(rng), bed_y(rng));
+        Vec2d b = a + Vec2d(offset(rng), offset(rng));
+        if (snap) {
+            a = Vec2d(std::round(a.x()), std::round(a.y()));
+            b = Vec2d(std::round(b.x()), std::round(b.y()));
+        }
+        end_points.emplace_back(Point::new_scale(a.x(), a.y()));
+        end_points.emplace_back(Point::new_scale(b.x(), b.y()));
+    }
+    return end_points;
+}
+
+template<typename Fn> static double measure(Fn &&fn)
+{
+    auto t_start = std::chrono::steady_clock::now();
+    fn();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - t_start).count();
+}
+
+int main(const int argc, const char *argv[]) {
+    std::vector<size_t> sizes;
+    for (int i = 1; i < argc; ++ i) {
+        if (std::string(argv[i]) == "-h" || std::string(argv[i]) == "--help") {
+            std::cout << USAGE_STR << std::endl;
+            return EXIT_SUCCESS;
+        }
+        sizes.emplace_back(size_t(std::atol(argv[i])));
+    }
+    if (sizes.empty())
+        sizes = { 1000, 10000, 50000 };
+
+    int result = EXIT_SUCCESS;
+    for (size_t num_segments : sizes)
+        for (int snap = 0; snap < 2; ++ snap)
+            for (ChainTieBreak tie_break : { ctbLowestIndex, ctbHighestIndex }) {
+                Points end_points  = random_segments(num_segments, snap != 0);
+                Point  start_near(0, 0);
+                std::vector<std::pair<size_t, bool>> chain_linear, chain_grid, chain_2opt;
+                double t_linear = measure([&]() { chain_linear = chain_segments_linear(end_points, start_near, tie_break); });
+                double t_grid   = measure([&]() { chain_grid   = chain_segments(end_points, start_near, true, nullptr, tie_break); });
+                double t_2opt   = measure([&]() {
+                    chain_2opt = chain_segments(end_points, start_near, true, nullptr, tie_break);
+                    improve_chain_2opt(chain_2opt, end_points, start_near);
+                });
+                bool identical = chain_linear == chain_grid;
+                if (! identical)
+                    result = EXIT_FAILURE;
+                std::cout << "{\"segments\":" << num_segments << ",\"snapped\":" << (snap ? "true" : "false")
+                          << ",\"tie_break\":\"" << (tie_break == ctbLowestIndex ? "lowest" : "highest") << "\""
+                          << ",\"identical\":" << (identical ? "true" : "false")
+                          << ",\"linear\":{\"time\":" << t_linear << ",\"travel\":" << unscale<double>(chain_travel_length(chain_linear, end_points, start_near)) << "}"
+                          << ",\"grid\":{\"time\":" << t_grid << ",\"travel\":" << unscale<double>(chain_travel_length(chain_grid, end_points, start_near)) << "}"
+                          << ",\"grid_2opt\":{\"time\":" << t_2opt << ",\"travel\":" << unscale<double>(chain_travel_length(chain_2opt, end_points, start_near)) << "}}"
+                          << std::endl;
+            }
+    return result;
+}
@@ -0,0 +1,161 @@
+#include <chrono>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include <libslic3r/libslic3r.h>
+#include <libslic3r/ClipperUtils.hpp>
+#include <libslic3r/TriangleMesh.hpp>
+
+const std::string USAGE_STR = {
+    "Usage: clipperutils [stlfilename.stl] [layer_height] [repetitions]\n"
+    "Slices the mesh and runs the ClipperUtils operations over all the layers twice: With the input converted\n"
+    "to ClipperLib::Paths and scaled in separate passes, as ClipperUtils did before, and by the current ClipperUtils.\n"
+    "Prints a JSON record with the best times of both variants for each operation and fails if the results differ.\n"
+    "If no file is given, a finely tesselated sphere with a cylinder passing through is sliced."
+};
+
+using namespace Slic3r;
+
+// The operations, as they were implemented by ClipperUtils with the input converted to ClipperLib::Paths.
+namespace legacy {
+
+static Polygons offset(const Polygons &polygons, const float delta)
+{
+    return ClipperPaths_to_Slic3rPolygons(_offset(Slic3rMultiPoints_to_ClipperPaths(polygons), ClipperLib::etClosedPolygon, delta, ClipperLib::jtMiter, 3.));
+}
+
+static Polygons diff(const Polygons &subject, const Polygons &clip)
+{
+    ClipperLib::Paths input_subject = Slic3rMultiPoints_to_ClipperPaths(subject);
+    ClipperLib::Paths input_clip    = Slic3rMultiPoints_to_ClipperPaths(clip);
+    ClipperLib::Clipper clipper;
+    clipper.AddPaths(input_subject, ClipperLib::ptSubject, true);
+    clipper.AddPaths(input_clip,    ClipperLib::ptClip,    true);
+    ClipperLib::Paths output;
+    clipper.Execute(ClipperLib::ctDifference, output, ClipperLib::pftNonZero, ClipperLib::pftNonZero);
+    return ClipperPaths_to_Slic3rPolygons(output);
+}
+
+static ExPolygons union_ex(const Polygons &subject)
+{
+    ClipperLib::Paths input_subject = Slic3rMultiPoints_to_ClipperPaths(subject);
+    ClipperLib::Clipper clipper;
+    clipper.AddPaths(input_subject, ClipperLib::ptSubject, true);
+    clipper.Execute(ClipperLib::ctUnion, input_subject, ClipperLib::pftNonZero, ClipperLib::pftNonZero);
+    clipper.Clear();
+    clipper.AddPaths(input_subject, ClipperLib::ptSubject, true);
+    ClipperLib::PolyTree polytree;
+    clipper.Execute(ClipperLib::ctUnion, polytree, ClipperLib::pftNonZero, ClipperLib::pftNonZero);
+    return PolyTreeToExPolygons(polytree);
+}
+
+} // namespace legacy
+
+static bool equal(const Polygons &a, const Polygons &b)
+{
+    if (a.size() != b.size())
+        return false;
+    for (size_t i = 0; i < a.size(); ++ i)
+        if (a[i].points != b[i].points)
+            return false;
+    return true;
+}
+
+static bool equal(const ExPolygons &a, const ExPolygons &b)
+{
+    if (a.size() != b.size())
+        return false;
+    for (size_t i = 0; i < a.size(); ++ i)
+        if (a[i].contour.points != b[i].contour.points || ! equal(a[i].holes, b[i].holes))
+            return false;
+    return true;
+}
+
+// Runs fn over all the layers repeatedly, returns the best time and the results of the last run.
+template<typename Result, typename Fn>
+static double measure(const std::vector<Polygons> &layers, int repetitions, std::vector<Result> &results, Fn &&fn)
+{
+    double best = std::numeric_limits<double>::max();
+    for (int i = 0; i < repetitions; ++ i) {
+        results.assign(layers.size(), Result());
+        auto t_start = std::chrono::steady_clock::now();
+        for (size_t layer = 0; layer < layers.size(); ++ layer)
+            results[layer] = fn(layer);
+        best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - t_start).count());
+    }
+    return best;
+}
+
+template<typename Result, typename FnLegacy, typename FnDirect>
+static bool benchmark_operation(const char *name, const std::vector<Polygons> &layers, int repetitions, FnLegacy &&fn_legacy, FnDirect &&fn_direct)
+{
+    std::vector<Result> results_legacy, results_direct;
+    double t_legacy = measure(layers, repetitions, results_legacy, fn_legacy);
+    double t_direct = measure(layers, repetitions, results_direct, fn_direct);
+    bool   identical = true;
+    for (size_t i = 0; i < layers.size(); ++ i)
+        identical &= equal(results_legacy[i], results_direct[i]);
+    std::cout << "{ \"operation\": \"" << name << "\", \"identical\": " << (identical ? "true" : "false") <<
+        ", \"legacy_seconds\": " << t_legacy << ", \"direct_seconds\": " << t_direct <<
+        ", \"speedup\": " << t_legacy / t_direct << " }" << std::endl;
+    return identical;
+}
+
+static bool benchmark_clipperutils(TriangleMesh &mesh, float layer_height, int repetitions)
+{
+    mesh.repair();
+    BoundingBoxf3 bbox = mesh.bounding_box();
+    std::vector<float> z;
+    for (double slice_z = bbox.min.z() + 0.5 * layer_height; slice_z < bbox.max.z(); slice_z += layer_height)
+        z.emplace_back(float(slice_z));
+    std::vector<ExPolygons> slices;
+    TriangleMeshSlicer(&mesh).slice(z, 0.f, &slices, [](){});
+
+    // Layer outlines and their inner perimeter outlines, as the perimeter generator and the PrintObject produce them.
+    std::vector<Polygons> layers, layers_inner;
+    size_t num_points = 0;
+    for (const ExPolygons &expolygons : slices) {
+        layers.emplace_back(to_polygons(expolygons));
+        layers_inner.emplace_back(offset(expolygons, - float(scale_(0.45))));
+        for (const Polygon &polygon : layers.back())
+            num_points += polygon.points.size();
+    }
+    std::cout << "{ \"facets\": " << mesh.stl.stats.number_of_facets << ", \"layers\": " << layers.size() << ", \"points\": " << num_points << " }" << std::endl;
+
+    const float delta = float(scale_(0.2));
+    bool ok = true;
+    ok &= benchmark_operation<Polygons>("offset", layers, repetitions,
+        [&](size_t i) { return legacy::offset(layers[i], delta); },
+        [&](size_t i) { return offset(layers[i], delta); });
+    ok &= benchmark_operation<Polygons>("diff", layers, repetitions,
+        [&](size_t i) { return legacy::diff(layers[i], layers_inner[i]); },
+        [&](size_t i) { return diff(layers[i], layers_inner[i]); });
+    ok &= benchmark_operation<ExPolygons>("union_ex", layers, repetitions,
+        [&](size_t i) { return legacy::union_ex(layers[i]); },
+        [&](size_t i) { return union_ex(layers[i]); });
+    return ok;
+}
+
+int main(const int argc, const char *argv[]) {
+    float layer_height = (argc > 2) ? float(atof(argv[2])) : 0.1f;
+    int   repetitions  = (argc > 3) ? std::max(1, atoi(argv[3])) : 3;
+    TriangleMesh mesh;
+    if (argc > 1) {
+        if (std::string(argv[1]) == "-h" || std::string(argv[1]) == "--help") {
+            std::cout << USAGE_STR << std::endl;
+            return EXIT_SUCCESS;
+        }
+        if (! mesh.ReadSTLFile(argv[1])) {
+            std::cerr << "Failed to load " << argv[1] << std::endl;
+            return EXIT_FAILURE;
+        }
+    } else {
+        mesh = make_sphere(50., PI / 300.);
+        TriangleMesh cylinder = make_cylinder(20., 100., PI / 1000.);
+        cylinder.translate(30.f, 0.f, -10.f);
+        mesh.merge(cylinder);
+    }
+    return benchmark_clipperutils(mesh, layer_height, repetitions) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,184 @@
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <string>
+
+#include <boost/filesystem/operations.hpp>
+
+#include <libslic3r/libslic3r.h>
+#include <libslic3r/GCodeReader.hpp>
+
+const std::string USAGE_STR = {
+    "Usage: gcodereader [gcodefile.gcode] [repetitions]\n"
+    "Parses the G-code by the GCodeReader: From a file mapped into memory, from a string buffer, from a contiguous block\n"
+    "of lines and line by line from std::getline() with the line, command and comment copied to std::strings, as the GCodeReader\n"
+    "returned them before. Prints a JSON record with the best time and the lines per second of each variant and fails\n"
+    "if the variants do not parse the same. If no file is given, a G-code of two million lines is synthesized."
+};
+
+using namespace Slic3r;
+
+// Summary of the parsed lines to verify that all the variants parse the same.
+struct Checksum
+{
+    size_t lines   = 0;
+    size_t g1      = 0;
+    size_t tagged  = 0;
+    double x       = 0.;
+    double e       = 0.;
+
+    void add(const GCodeReader::GCodeLine &line, bool g1, bool tagged) {
+        ++ this->lines;
+        if (g1) {
+            ++ this->g1;
+            this->x += line.x();
+            this->e += line.e();
+        }
+        if (tagged)
+            ++ this->tagged;
+    }
+    bool operator==(const Checksum &rhs) const
+        { return this->lines == rhs.lines && this->g1 == rhs.g1 && this->tagged == rhs.tagged && this->x == rhs.x && this->e == rhs.e; }
+};
+
+static std::string synthesize_gcode(size_t num_lines)
+{
+    std::ostringstream ss;
+    ss << "; generated by the gcodereader sandbox\nG21 ; set units to millimeters\nG90 ; use absolute coordinates\nM83 ; use relative distances for extrusion\n";
+    char buf[256];
+    double z = 0.2;
+    for (size_t i = 0; i < num_lines; ++ i) {
+        double x = 100. + 50. * std::cos(double(i) * 0.01);
+        double y = 100. + 50. * std::sin(double(i) * 0.01);
+        switch (i % 16) {
+        case 0:
+            sprintf(buf, ";_EXTRUSION_ROLE:%d\n", int(i / 16) % 10 + 1);
+            break;
+        case 1:
+            sprintf(buf, ";_WIDTH:0.45\n");
+            break;
+        case 2:
+            sprintf(buf, "G1 X%.3f Y%.3f F7800.000\n", x, y);
+            break;
+        case 3:
+            sprintf(buf, "G1 E0.80000 F2100.00000\n");
+            break;
+        case 15:
+            if ((i / 16) % 64 == 63) {
+                z += 0.2;
+                sprintf(buf, "G1 Z%.3f F7800.000 ; move to next layer\n", z);
+                break;
+            }
+        default:
+            sprintf(buf, "G1 X%.3f Y%.3f E%.5f\n", x, y, 0.03125);
+        }
+        ss << buf;
+    }
+    return ss.str();
+}
+
+template<typename Fn>
+static double measure(int repetitions, Checksum &checksum, Fn &&fn)
+{
+    double best = std::numeric_limits<double>::max();
+    for (int i = 0; i < repetitions; ++ i) {
+        checksum = Checksum();
+        auto t_start = std::chrono::steady_clock::now();
+        fn(checksum);
+        best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - t_start).count());
+    }
+    return best;
+}
+
+static bool benchmark_gcodereader(const std::string &path, int repetitions)
+{
+    std::string buffer;
+    {
+        std::ifstream ifs(path, std::ios::binary);
+        std::stringstream ss;
+        ss << ifs.rdbuf();
+        buffer = ss.str();
+    }
+    std::cout << "{ \"file\": \"" << path << "\", \"bytes\": " << buffer.size() << " }" << std::endl;
+
+    // The consumers dispatch on the command letter and number and search the comments for tags.
+    auto process = [](Checksum &checksum) {
+        return [&checksum](GCodeReader&, const GCodeReader::GCodeLine &line) {
+            checksum.add(line, line.cmd_code() == GCodeReader::cmd_code('G', 1), line.comment().find("_EXTRUSION_ROLE:") != boost::string_view::npos);
+        };
+    };
+
+    Checksum reference;
+    bool     ok = true;
+    auto report = [&reference, &ok](const char *name, double t, const Checksum &checksum) {
+        bool identical = checksum == reference;
+        ok &= identical;
+        std::cout << "{ \"variant\": \"" << name << "\", \"identical\": " << (identical ? "true" : "false") <<
+            ", \"lines\": " << checksum.lines << ", \"seconds\": " << t << ", \"lines_per_second\": " << double(checksum.lines) / t << " }" << std::endl;
+    };
+
+    // The lines as the GCodeReader returned them before, each of them copied into a newly allocated std::string.
+    double t = measure(repetitions, reference, [&buffer](Checksum &checksum) {
+        GCodeReader reader;
+        std::istringstream is(buffer);
+        std::string gcode_line;
+        while (std::getline(is, gcode_line))
+            reader.parse_line(gcode_line, [&checksum](GCodeReader&, const GCodeReader::GCodeLine &line) {
+                std::string raw(line.raw().data(), line.raw().size());
+                std::string cmd(line.cmd().data(), line.cmd().size());
+                std::string comment(line.comment().data(), line.comment().size());
+                checksum.add(line, cmd == "G1", comment.find("_EXTRUSION_ROLE:") != std::string::npos);
+            });
+    });
+    report("getline_copy", t, reference);
+
+    Checksum checksum;
+    t = measure(repetitions, checksum, [&buffer, &process](Checksum &checksum) {
+        GCodeReader reader;
+        reader.parse_buffer(buffer, process(checksum));
+    });
+    report("parse_buffer", t, checksum);
+
+    t = measure(repetitions, checksum, [&buffer, &process](Checksum &checksum) {
+        GCodeReader reader;
+        reader.parse_lines(buffer.data(), buffer.data() + buffer.size(), process(checksum));
+    });
+    report("parse_lines", t, checksum);
+
+    t = measure(repetitions, checksum, [&path, &process, &ok](Checksum &checksum) {
+        GCodeReader reader;
+        ok &= reader.parse_file(path, process(checksum));
+    });
+    report("parse_file", t, checksum);
+    return ok;
+}
+
+int main(const int argc, const char *argv[]) {
+    int repetitions = (argc > 2) ? std::max(1, atoi(argv[2])) : 3;
+    std::string path;
+    bool        temporary = false;
+    if (argc > 1) {
+        if (std::string(argv[1]) == "-h" || std::string(argv[1]) == "--help") {
+            std::cout << USAGE_STR << std::endl;
+            return EXIT_SUCCESS;
+        }
+        path = argv[1];
+    } else {
+        path = (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("gcodereader-%%%%-%%%%.gcode")).string();
+        std::ofstream ofs(path, std::ios::binary);
+        ofs << synthesize_gcode(2000000);
+        temporary = true;
+    }
+    if (! boost::filesystem::exists(path)) {
+        std::cerr << "Failed to load " << path << std::endl;
+        return EXIT_FAILURE;
+    }
+    bool ok = benchmark_gcodereader(path, repetitions);
+    if (temporary)
+        boost::filesystem::remove(path);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,55 @@
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include <libslic3r/libslic3r.h>
+#include <libslic3r/GCodeTimeEstimator.hpp>
+
+const std::string USAGE_STR = {
+    "Usage: gcodetime gcodefile.gcode [interval]\n"
+    "Estimates the print time of the G-code twice: At once from the file, and line by line with the estimate updated\n"
+    "every [interval] lines (997 by default), as during the G-code export, so that the planner is restarted after\n"
+    "the st_synchronize() of many M109 / G4 / M600 lines. Prints a JSON record with both estimates in full precision.\n"
+    "Run it with two builds of the GCodeTimeEstimator to verify that a change of the planner does not change the times."
+};
+
+using namespace Slic3r;
+
+int main(const int argc, const char *argv[]) {
+    if (argc < 2 || std::string(argv[1]) == "-h" || std::string(argv[1]) == "--help") {
+        std::cout << USAGE_STR << std::endl;
+        return argc < 2 ? EXIT_FAILURE : EXIT_SUCCESS;
+    }
+    size_t interval = (argc > 2) ? size_t(std::max(1, atoi(argv[2]))) : 997;
+
+    std::ifstream file(argv[1]);
+    if (! file.good()) {
+        std::cerr << "Failed to open " << argv[1] << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    auto t_start = std::chrono::steady_clock::now();
+    GCodeTimeEstimator estimator_file(GCodeTimeEstimator::Normal);
+    estimator_file.calculate_time_from_file(argv[1]);
+    double t_file = std::chrono::duration<double>(std::chrono::steady_clock::now() - t_start).count();
+
+    t_start = std::chrono::steady_clock::now();
+    GCodeTimeEstimator estimator_lines(GCodeTimeEstimator::Normal);
+    std::string line;
+    for (size_t i = 1; std::getline(file, line); ++ i) {
+        estimator_lines.add_gcode_line(line);
+        if (i % interval == 0)
+            estimator_lines.calculate_time(false);
+    }
+    estimator_lines.calculate_time(false);
+    double t_lines = std::chrono::duration<double>(std::chrono::steady_clock::now() - t_start).count();
+
+    char buf[512];
+    sprintf(buf, "{ \"file_time\": %.9g, \"file_dhms\": \"%s\", \"file_seconds\": %g, \"lines_time\": %.9g, \"lines_dhms\": \"%s\", \"lines_seconds\": %g }",
+        estimator_file.get_time(), estimator_file.get_time_dhms().c_str(), t_file,
+        estimator_lines.get_time(), estimator_lines.get_time_dhms().c_str(), t_lines);
+    std::cout << buf << std::endl;
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,59 @@
+#include <chrono>
+#include <iostream>
+#include <string>
+
+#include <libslic3r/libslic3r.h>
+#include <libslic3r/TriangleMesh.hpp>
+
+const std::string USAGE_STR = {
+    "Usage: meshconnect [stlfilename.stl] [repetitions]\n"
+    "Measures the throughput of the facet connectivity detection (stl_check_facets_exact) and of the mesh repair.\n"
+    "If no file is given, a finely tesselated sphere is generated."
+};
+
+// Run the stage on a fresh copy of the mesh repeatedly, print the best time as a single JSON record.
+template<typename Stage>
+static void benchmark_stage(const Slic3r::TriangleMesh &mesh, const char *name, const char *stage_name, int repetitions, Stage stage)
+{
+    double best = std::numeric_limits<double>::max();
+    for (int i = 0; i < repetitions; ++ i) {
+        Slic3r::TriangleMesh copy = mesh;
+        auto t_start = std::chrono::steady_clock::now();
+        stage(copy);
+        best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - t_start).count());
+    }
+    size_t num_facets = mesh.stl.stats.number_of_facets;
+    std::cout << "{ \"mesh\": \"" << name << "\", \"stage\": \"" << stage_name << "\", \"facets\": " << num_facets << 
+        ", \"seconds\": " << best << ", \"facets_per_second\": " << double(num_facets) / best << " }" << std::endl;
+}
+
+static void benchmark_mesh(const Slic3r::TriangleMesh &mesh, const char *name, int repetitions)
+{
+    benchmark_stage(mesh, name, "check_facets_exact", repetitions, [](Slic3r::TriangleMesh &m) { stl_check_facets_exact(&m.stl); });
+    benchmark_stage(mesh, name, "repair", repetitions, [](Slic3r::TriangleMesh &m) { m.repaired = false; m.repair(); });
+}
+
+int main(const int argc, const char *argv[]) {
+    using namespace Slic3r;
+
+    int repetitions = (argc > 2) ? std::max(1, atoi(argv[2])) : 5;
+    if (argc > 1) {
+        if (std::string(argv[1]) == "-h" || std::string(argv[1]) == "--help") {
+            std::cout << USAGE_STR << std::endl;
+            return EXIT_SUCCESS;
+        }
+        TriangleMesh mesh;
+        if (! mesh.ReadSTLFile(argv[1])) {
+            std::cerr << "Failed to load " << argv[1] << std::endl;
+            return EXIT_FAILURE;
+        }
+        benchmark_mesh(mesh, "file", repetitions);
+        return EXIT_SUCCESS;
+    }
+
+    // Roughly 2 million facets.
+    benchmark_mesh(make_sphere(50., PI / 700.), "sphere", repetitions);
+    // Roughly 1 million facets.
+    benchmark_mesh(make_cylinder(20., 50., PI / 125000.), "cylinder", repetitions);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,71 @@
+#include <chrono>
+#include <iostream>
+#include <string>
+
+#include <libslic3r/libslic3r.h>
+#include <libslic3r/TriangleMesh.hpp>
+
+const std::string USAGE_STR = {
+    "Usage: meshslice [stlfilename.stl] [layer_height] [repetitions]\n"
+    "Measures the throughput of TriangleMeshSlicer::slice() producing closed polygons.\n"
+    "If no file is given, a finely tesselated sphere with a cylinder passing through is sliced."
+};
+
+// Slice the mesh repeatedly, print the best time as a single JSON record.
+static void benchmark_slice(Slic3r::TriangleMesh &mesh, const char *name, float layer_height, int repetitions)
+{
+    using namespace Slic3r;
+    mesh.repair();
+    BoundingBoxf3 bbox = mesh.bounding_box();
+    std::vector<float> z;
+    for (double slice_z = bbox.min.z() + 0.5 * layer_height; slice_z < bbox.max.z(); slice_z += layer_height)
+        z.emplace_back(float(slice_z));
+
+    auto t_start = std::chrono::steady_clock::now();
+    TriangleMeshSlicer slicer(&mesh);
+    double time_init = std::chrono::duration<double>(std::chrono::steady_clock::now() - t_start).count();
+
+    double best = std::numeric_limits<double>::max();
+    size_t num_points = 0;
+    for (int i = 0; i < repetitions; ++ i) {
+        std::vector<Polygons> layers;
+        t_start = std::chrono::steady_clock::now();
+        slicer.slice(z, &layers, [](){});
+        best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - t_start).count());
+        num_points = 0;
+        for (const Polygons &polygons : layers)
+            for (const Polygon &polygon : polygons)
+                num_points += polygon.points.size();
+    }
+    std::cout << "{ \"mesh\": \"" << name << "\", \"facets\": " << mesh.stl.stats.number_of_facets << ", \"layers\": " << z.size() << 
+        ", \"points\": " << num_points << ", \"init_seconds\": " << time_init << ", \"slice_seconds\": " << best << 
+        ", \"facets_per_second\": " << double(mesh.stl.stats.number_of_facets) / best << " }" << std::endl;
+}
+
+int main(const int argc, const char *argv[]) {
+    using namespace Slic3r;
+
+    float layer_height = (argc > 2) ? float(atof(argv[2])) : 0.05f;
+    int   repetitions  = (argc > 3) ? std::max(1, atoi(argv[3])) : 5;
+    if (argc > 1) {
+        if (std::string(argv[1]) == "-h" || std::string(argv[1]) == "--help") {
+            std::cout << USAGE_STR << std::endl;
+            return EXIT_SUCCESS;
+        }
+        TriangleMesh mesh;
+        if (! mesh.ReadSTLFile(argv[1])) {
+            std::cerr << "Failed to load " << argv[1] << std::endl;
+            return EXIT_FAILURE;
+        }
+        benchmark_slice(mesh, "file", layer_height, repetitions);
+        return EXIT_SUCCESS;
+    }
+
+    // Roughly 370 thousand facets. The tall facets of the cylinder cross all the layers.
+    TriangleMesh mesh = make_sphere(50., PI / 300.);
+    TriangleMesh cylinder = make_cylinder(20., 100., PI / 1000.);
+    cylinder.translate(30.f, 0.f, -10.f);
+    mesh.merge(cylinder);
+    benchmark_slice(mesh, "sphere_cylinder", layer_height, repetitions);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,197 @@
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include <libslic3r/libslic3r.h>
+#include <libslic3r/ExPolygon.hpp>
+#include <libslic3r/TriangleMesh.hpp>
+#include <libslic3r/SLA/SLARaster.hpp>
+
+#include <agg/agg_basics.h>
+#include <agg/agg_rendering_buffer.h>
+#include <agg/agg_pixfmt_gray.h>
+#include <agg/agg_renderer_base.h>
+#include <agg/agg_renderer_scanline.h>
+#include <agg/agg_scanline_p.h>
+#include <agg/agg_rasterizer_scanline_aa.h>
+#include <agg/agg_path_storage.h>
+
+#include <miniz.h>
+
+const std::string USAGE_STR = {
+    "Usage: slaraster [stlfilename.stl] [layer_height] [repetitions]\n"
+    "Slices the mesh and rasterizes and compresses the layers to PNG for the default SL1 display twice: Into a dense\n"
+    "frame compressed by the miniz PNG writer, as the sla::Raster did before, and by the sla::Raster allocating the rows\n"
+    "drawn into only. Prints a JSON record with the best times and the raster memory of both variants and fails if the\n"
+    "PNG files differ. If no file is given, a finely tesselated sphere with a cylinder passing through is sliced."
+};
+
+using namespace Slic3r;
+
+// Default SL1 display in the portrait orientation.
+static const sla::Raster::Resolution DISPLAY_RESOLUTION(1440, 2560);
+static const sla::Raster::PixelDim   DISPLAY_PIXEL(68. / 1440., 120. / 2560.);
+
+// The rasterization into a dense frame, as it was implemented by sla::Raster.
+namespace legacy {
+
+class Raster {
+public:
+    Raster(const sla::Raster::Resolution &res, const sla::Raster::PixelDim &pd) :
+        m_resolution(res),
+        m_pxdim_scaled(SCALING_FACTOR / pd.w_mm, SCALING_FACTOR / pd.h_mm),
+        m_buf(res.pixels()),
+        m_rbuf(m_buf.data(), res.width_px, res.height_px, int(res.width_px)),
+        m_pixfmt(m_rbuf),
+        m_raw_renderer(m_pixfmt),
+        m_renderer(m_raw_renderer)
+    {
+        m_renderer.color(agg::gray8(255));
+        m_raw_renderer.clear(agg::gray8(0));
+    }
+
+    void draw(const ExPolygon &expoly)
+    {
+        agg::rasterizer_scanline_aa<> ras;
+        agg::scanline_p8 scanlines;
+        ras.gamma(agg::gamma_power(1.0));
+        agg::path_storage path = to_path(expoly.contour);
+        ras.add_path(path);
+        for (const Polygon &hole : expoly.holes) {
+            agg::path_storage hole_path = to_path(hole);
+            ras.add_path(hole_path);
+        }
+        agg::render_scanlines(ras, scanlines, m_renderer);
+    }
+
+    std::vector<std::uint8_t> save_png() const
+    {
+        size_t size = 0;
+        void *data = tdefl_write_image_to_png_file_in_memory(m_buf.data(), int(m_resolution.width_px), int(m_resolution.height_px), 1, &size);
+        std::vector<std::uint8_t> out(static_cast<std::uint8_t*>(data), static_cast<std::uint8_t*>(data) + size);
+        MZ_FREE(data);
+        return out;
+    }
+
+    // Number of the rows with any pixel drawn.
+    size_t rows_drawn() const
+    {
+        size_t cnt = 0;
+        for (unsigned y = 0; y < m_resolution.height_px; ++ y) {
+            auto row = m_buf.begin() + y * m_resolution.width_px;
+            cnt += std::any_of(row, row + m_resolution.width_px, [](std::uint8_t v) { return v != 0; });
+        }
+        return cnt;
+    }
+
+private:
+    // Mirrored along the Y axis, as the sla::Raster does for the PNG format.
+    agg::path_storage to_path(const Polygon &polygon) const
+    {
+        agg::path_storage path;
+        path.move_to(polygon.points.front()(0) * m_pxdim_scaled.w_mm, polygon.points.front()(1) * m_pxdim_scaled.h_mm);
+        for (size_t i = 1; i < polygon.points.size(); ++ i)
+            path.line_to(polygon.points[i](0) * m_pxdim_scaled.w_mm, polygon.points[i](1) * m_pxdim_scaled.h_mm);
+        path.line_to(polygon.points.front()(0) * m_pxdim_scaled.w_mm, polygon.points.front()(1) * m_pxdim_scaled.h_mm);
+        path.flip_y(0, m_resolution.height_px);
+        return path;
+    }
+
+    sla::Raster::Resolution                              m_resolution;
+    sla::Raster::PixelDim                                m_pxdim_scaled;
+    std::vector<std::uint8_t>                            m_buf;
+    agg::rendering_buffer                                m_rbuf;
+    agg::pixfmt_gray8                                    m_pixfmt;
+    agg::renderer_base<agg::pixfmt_gray8>                m_raw_renderer;
+    agg::renderer_scanline_aa_solid<agg::renderer_base<agg::pixfmt_gray8>> m_renderer;
+};
+
+} // namespace legacy
+
+// Rasterizes all the layers repeatedly, returns the best time and the PNG files of the last run.
+template<typename Fn>
+static double measure(const std::vector<ExPolygons> &layers, int repetitions, std::vector<std::vector<std::uint8_t>> &pngs, Fn &&fn)
+{
+    double best = std::numeric_limits<double>::max();
+    for (int i = 0; i < repetitions; ++ i) {
+        pngs.assign(layers.size(), std::vector<std::uint8_t>());
+        auto t_start = std::chrono::steady_clock::now();
+        for (size_t layer = 0; layer < layers.size(); ++ layer)
+            pngs[layer] = fn(layers[layer]);
+        best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - t_start).count());
+    }
+    return best;
+}
+
+static bool benchmark_slaraster(TriangleMesh &mesh, float layer_height, int repetitions)
+{
+    mesh.repair();
+    // Center the mesh on the display.
+    BoundingBoxf3 bbox = mesh.bounding_box();
+    Vec3d center = bbox.center();
+    mesh.translate(float(0.5 * DISPLAY_RESOLUTION.width_px * DISPLAY_PIXEL.w_mm - center.x()),
+                   float(0.5 * DISPLAY_RESOLUTION.height_px * DISPLAY_PIXEL.h_mm - center.y()), float(- bbox.min.z()));
+    bbox = mesh.bounding_box();
+    std::vector<float> z;
+    for (double slice_z = 0.5 * layer_height; slice_z < bbox.max.z(); slice_z += layer_height)
+        z.emplace_back(float(slice_z));
+    std::vector<ExPolygons> layers;
+    TriangleMeshSlicer(&mesh).slice(z, 0.f, &layers, [](){});
+
+    std::vector<std::vector<std::uint8_t>> pngs_legacy, pngs_sparse;
+    double t_legacy = measure(layers, repetitions, pngs_legacy, [](const ExPolygons &expolygons) {
+        legacy::Raster raster(DISPLAY_RESOLUTION, DISPLAY_PIXEL);
+        for (const ExPolygon &expoly : expolygons)
+            raster.draw(expoly);
+        return raster.save_png();
+    });
+    double t_sparse = measure(layers, repetitions, pngs_sparse, [](const ExPolygons &expolygons) {
+        sla::Raster raster;
+        raster.reset(DISPLAY_RESOLUTION, DISPLAY_PIXEL, sla::Raster::Format::PNG);
+        for (const ExPolygon &expoly : expolygons)
+            raster.draw(expoly);
+        sla::RawBytes png = raster.save(sla::Raster::Format::PNG);
+        return std::vector<std::uint8_t>(png.data(), png.data() + png.size());
+    });
+
+    // Memory of the raster of the largest layer. The sparse raster allocates the rows drawn into only.
+    size_t rows_max = 0;
+    for (const ExPolygons &expolygons : layers) {
+        legacy::Raster raster(DISPLAY_RESOLUTION, DISPLAY_PIXEL);
+        for (const ExPolygon &expoly : expolygons)
+            raster.draw(expoly);
+        rows_max = std::max(rows_max, raster.rows_drawn());
+    }
+
+    bool identical = pngs_legacy == pngs_sparse;
+    std::cout << "{ \"facets\": " << mesh.stl.stats.number_of_facets << ", \"layers\": " << layers.size() <<
+        ", \"identical\": " << (identical ? "true" : "false") <<
+        ", \"legacy_seconds\": " << t_legacy << ", \"sparse_seconds\": " << t_sparse << ", \"speedup\": " << t_legacy / t_sparse <<
+        ", \"legacy_raster_bytes\": " << DISPLAY_RESOLUTION.pixels() << ", \"sparse_raster_bytes_max\": " << rows_max * DISPLAY_RESOLUTION.width_px << " }" << std::endl;
+    return identical;
+}
+
+int main(const int argc, const char *argv[]) {
+    float layer_height = (argc > 2) ? float(atof(argv[2])) : 0.05f;
+    int   repetitions  = (argc > 3) ? std::max(1, atoi(argv[3])) : 3;
+    TriangleMesh mesh;
+    if (argc > 1) {
+        if (std::string(argv[1]) == "-h" || std::string(argv[1]) == "--help") {
+            std::cout << USAGE_STR << std::endl;
+            return EXIT_SUCCESS;
+        }
+        if (! mesh.ReadSTLFile(argv[1])) {
+            std::cerr << "Failed to load " << argv[1] << std::endl;
+            return EXIT_FAILURE;
+        }
+    } else {
+        mesh = make_sphere(20., PI / 300.);
+        TriangleMesh cylinder = make_cylinder(8., 60., PI / 1000.);
+        cylinder.translate(10.f, 0.f, -30.f);
+        mesh.merge(cylinder);
+    }
+    return benchmark_slaraster(mesh, layer_height, repetitions) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,154 @@
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <tbb/parallel_for.h>
+
+#include <libslic3r/libslic3r.h>
+#include <libslic3r/TriangleMesh.hpp>
+#include <libslic3r/SLA/SLACommon.hpp>
+
+const std::string USAGE_STR = {
+    "Usage: slaraycast [stlfilename.stl] [fans] [repetitions]\n"
+    "Casts fans of eight rays around the axes of random sticks starting on the mesh surface, as the SLA support tree\n"
+    "does to test the sticks for collisions with the mesh. The fans are cast three times: Ray by ray in parallel by\n"
+    "sla::EigenMesh3D::query_ray_hit(), as the support tree did before, fan by fan and all the fans in a single batch\n"
+    "by sla::EigenMesh3D::query_ray_hits(). Prints a JSON record with the best time of each variant and fails if the\n"
+    "hits differ. If no file is given, a finely tesselated sphere with a box and a cylinder is used."
+};
+
+using namespace Slic3r;
+
+static const size_t SAMPLES = 8;
+
+struct Fan {
+    std::vector<Vec3d> sources;
+    std::vector<Vec3d> dirs;
+};
+
+// Rays on a cylinder of radius r around the axis starting at s, as cast by the support tree.
+static Fan make_fan(const Vec3d &s, const Vec3d &dir, double r)
+{
+    Vec3d a = dir.unitOrthogonal();
+    Vec3d b = a.cross(dir);
+    Fan fan;
+    for (size_t i = 0; i < SAMPLES; ++ i) {
+        double phi = double(i) * 2. * PI / double(SAMPLES);
+        fan.sources.emplace_back(s + r * std::cos(phi) * a + r * std::sin(phi) * b);
+        fan.dirs.emplace_back(dir);
+    }
+    return fan;
+}
+
+template<typename Fn>
+static double measure(int repetitions, std::vector<sla::EigenMesh3D::hit_result> &hits, Fn &&fn)
+{
+    double best = std::numeric_limits<double>::max();
+    for (int i = 0; i < repetitions; ++ i) {
+        hits.clear();
+        auto t_start = std::chrono::steady_clock::now();
+        fn(hits);
+        best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - t_start).count());
+    }
+    return best;
+}
+
+static bool identical(const std::vector<sla::EigenMesh3D::hit_result> &lhs, const std::vector<sla::EigenMesh3D::hit_result> &rhs)
+{
+    if (lhs.size() != rhs.size())
+        return false;
+    for (size_t i = 0; i < lhs.size(); ++ i)
+        if (lhs[i].face() != rhs[i].face() || ! (lhs[i].distance() == rhs[i].distance() || (std::isinf(lhs[i].distance()) && std::isinf(rhs[i].distance()))))
+            return false;
+    return true;
+}
+
+static bool benchmark_slaraycast(TriangleMesh &mesh, int num_fans, int repetitions)
+{
+    mesh.repair();
+    sla::EigenMesh3D emesh(mesh);
+
+    // Sticks starting on the surface, pointing to the outside of the mesh.
+    std::mt19937 rng(0);
+    std::uniform_int_distribution<int> random_face(0, int(emesh.F().rows()) - 1);
+    std::normal_distribution<double>   random_coord;
+    std::vector<Fan> fans;
+    while (int(fans.size()) < num_fans) {
+        auto   idx = emesh.F().row(random_face(rng));
+        Vec3d  p1  = emesh.V().row(idx(0));
+        Vec3d  p2  = emesh.V().row(idx(1));
+        Vec3d  p3  = emesh.V().row(idx(2));
+        Vec3d  normal = (p2 - p1).cross(p3 - p1).normalized();
+        Vec3d  dir(random_coord(rng), random_coord(rng), random_coord(rng));
+        dir.normalize();
+        if (dir.dot(normal) < 0.)
+            dir = - dir;
+        fans.emplace_back(make_fan((p1 + p2 + p3) / 3. + 0.2 * dir, dir, 0.5));
+    }
+
+    std::vector<sla::EigenMesh3D::hit_result> hits_legacy, hits_fans, hits_batch;
+    double t_legacy = measure(repetitions, hits_legacy, [&emesh, &fans](std::vector<sla::EigenMesh3D::hit_result> &hits) {
+        for (const Fan &fan : fans) {
+            std::array<sla::EigenMesh3D::hit_result, SAMPLES> fan_hits;
+            tbb::parallel_for(size_t(0), SAMPLES, [&emesh, &fan, &fan_hits](size_t i) {
+                fan_hits[i] = emesh.query_ray_hit(fan.sources[i], fan.dirs[i]);
+            });
+            hits.insert(hits.end(), fan_hits.begin(), fan_hits.end());
+        }
+    });
+    double t_fans = measure(repetitions, hits_fans, [&emesh, &fans](std::vector<sla::EigenMesh3D::hit_result> &hits) {
+        for (const Fan &fan : fans) {
+            std::vector<sla::EigenMesh3D::hit_result> fan_hits = emesh.query_ray_hits(fan.sources, fan.dirs);
+            hits.insert(hits.end(), fan_hits.begin(), fan_hits.end());
+        }
+    });
+    std::vector<Vec3d> sources, dirs;
+    for (const Fan &fan : fans) {
+        sources.insert(sources.end(), fan.sources.begin(), fan.sources.end());
+        dirs.insert(dirs.end(), fan.dirs.begin(), fan.dirs.end());
+    }
+    double t_batch = measure(repetitions, hits_batch, [&emesh, &sources, &dirs](std::vector<sla::EigenMesh3D::hit_result> &hits) {
+        hits = emesh.query_ray_hits(sources, dirs);
+    });
+
+    size_t hit_cnt = 0;
+    for (const sla::EigenMesh3D::hit_result &hit : hits_legacy)
+        hit_cnt += hit.face() >= 0;
+
+    bool ok = identical(hits_legacy, hits_fans) && identical(hits_legacy, hits_batch);
+    std::cout << "{ \"facets\": " << mesh.stl.stats.number_of_facets << ", \"rays\": " << sources.size() << ", \"hits\": " << hit_cnt <<
+        ", \"identical\": " << (ok ? "true" : "false") << ", \"legacy_seconds\": " << t_legacy <<
+        ", \"fans_seconds\": " << t_fans << ", \"batch_seconds\": " << t_batch <<
+        ", \"fans_speedup\": " << t_legacy / t_fans << ", \"batch_speedup\": " << t_legacy / t_batch << " }" << std::endl;
+    return ok;
+}
+
+int main(const int argc, const char *argv[]) {
+    int num_fans    = (argc > 2) ? std::max(1, atoi(argv[2])) : 20000;
+    int repetitions = (argc > 3) ? std::max(1, atoi(argv[3])) : 3;
+    TriangleMesh mesh;
+    if (argc > 1) {
+        if (std::string(argv[1]) == "-h" || std::string(argv[1]) == "--help") {
+            std::cout << USAGE_STR << std::endl;
+            return EXIT_SUCCESS;
+        }
+        if (! mesh.ReadSTLFile(argv[1])) {
+            std::cerr << "Failed to load " << argv[1] << std::endl;
+            return EXIT_FAILURE;
+        }
+    } else {
+        mesh = make_sphere(20., PI / 300.);
+        TriangleMesh box = make_cube(30., 20., 10.);
+        box.translate(10.f, -10.f, 15.f);
+        mesh.merge(box);
+        TriangleMesh cylinder = make_cylinder(8., 60., PI / 1000.);
+        cylinder.translate(-10.f, 0.f, -30.f);
+        mesh.merge(cylinder);
+    }
+    return benchmark_slaraycast(mesh, num_fans, repetitions) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,121 @@
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <libslic3r/libslic3r.h>
+#include <libslic3r/TriangleMesh.hpp>
+#include <libslic3r/SLA/SLACommon.hpp>
+#include <libslic3r/SLA/SLARotfinder.hpp>
+
+const std::string USAGE_STR = {
+    "Usage: slarotfinder [stlfilename.stl] [rotations]\n"
+    "Evaluates the objective of the SLA auto orientation for random rotations of the mesh twice: With the triangle normals\n"
+    "recalculated from the EigenMesh3D for each rotation, as sla::find_best_rotation() did before, and by the sla::RotationScore\n"
+    "with the normals calculated once. Prints a JSON record with the setup and evaluation times of both variants and fails\n"
+    "if the scores differ. If no file is given, a finely tesselated sphere with a box and a cylinder is evaluated."
+};
+
+using namespace Slic3r;
+
+// The objective, as it was evaluated by sla::find_best_rotation().
+namespace legacy {
+
+static double score(const sla::EigenMesh3D &m, double rx, double ry, double rz)
+{
+    Transform3d rt = Transform3d::Identity();
+    rt.rotate(Eigen::AngleAxisd(rz, Vec3d::UnitZ()));
+    rt.rotate(Eigen::AngleAxisd(ry, Vec3d::UnitY()));
+    rt.rotate(Eigen::AngleAxisd(rx, Vec3d::UnitX()));
+
+    double score = 0;
+    for (int i = 0; i < m.F().rows(); i++) {
+        auto idx = m.F().row(i);
+        Vec3d p1 = m.V().row(idx(0));
+        Vec3d p2 = m.V().row(idx(1));
+        Vec3d p3 = m.V().row(idx(2));
+        Eigen::Vector3d U = p2 - p1;
+        Eigen::Vector3d V = p3 - p1;
+        auto n = U.cross(V).normalized();
+        n = rt * n;
+        score += std::abs(n.dot(Vec3d::UnitX()));
+        score += std::abs(n.dot(Vec3d::UnitY()));
+        score += std::abs(n.dot(Vec3d::UnitZ()));
+    }
+    return score;
+}
+
+} // namespace legacy
+
+static double seconds_since(const std::chrono::steady_clock::time_point &t)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - t).count();
+}
+
+static bool benchmark_slarotfinder(TriangleMesh &mesh, int rotations)
+{
+    mesh.repair();
+
+    std::mt19937 rng(0);
+    std::uniform_real_distribution<double> random_angle(- PI / 2., PI / 2.);
+    std::vector<Vec3d> angles;
+    for (int i = 0; i < rotations; ++ i)
+        angles.emplace_back(random_angle(rng), random_angle(rng), random_angle(rng));
+
+    auto t = std::chrono::steady_clock::now();
+    sla::EigenMesh3D emesh(mesh);
+    double t_legacy_setup = seconds_since(t);
+    std::vector<double> scores_legacy;
+    t = std::chrono::steady_clock::now();
+    for (const Vec3d &a : angles)
+        scores_legacy.emplace_back(legacy::score(emesh, a.x(), a.y(), a.z()));
+    double t_legacy = seconds_since(t);
+
+    t = std::chrono::steady_clock::now();
+    sla::RotationScore rotation_score(mesh);
+    double t_precomputed_setup = seconds_since(t);
+    std::vector<double> scores_precomputed;
+    t = std::chrono::steady_clock::now();
+    for (const Vec3d &a : angles)
+        scores_precomputed.emplace_back(rotation_score(a.x(), a.y(), a.z()));
+    double t_precomputed = seconds_since(t);
+
+    // The vertices closer than 1e-6 are merged by the EigenMesh3D and the sums are reordered, the scores differ by rounding.
+    double max_relative_difference = 0.;
+    for (size_t i = 0; i < angles.size(); ++ i)
+        max_relative_difference = std::max(max_relative_difference, std::abs(scores_legacy[i] - scores_precomputed[i]) / scores_legacy[i]);
+    bool ok = max_relative_difference < 1e-6;
+
+    std::cout << "{ \"facets\": " << mesh.stl.stats.number_of_facets << ", \"distinct_normals\": " << rotation_score.normals_count() <<
+        ", \"rotations\": " << rotations << ", \"max_relative_difference\": " << max_relative_difference <<
+        ", \"legacy_setup_seconds\": " << t_legacy_setup << ", \"legacy_seconds\": " << t_legacy <<
+        ", \"precomputed_setup_seconds\": " << t_precomputed_setup << ", \"precomputed_seconds\": " << t_precomputed <<
+        ", \"speedup\": " << t_legacy / t_precomputed << " }" << std::endl;
+    return ok;
+}
+
+int main(const int argc, const char *argv[]) {
+    int rotations = (argc > 2) ? std::max(1, atoi(argv[2])) : 200;
+    TriangleMesh mesh;
+    if (argc > 1) {
+        if (std::string(argv[1]) == "-h" || std::string(argv[1]) == "--help") {
+            std::cout << USAGE_STR << std::endl;
+            return EXIT_SUCCESS;
+        }
+        if (! mesh.ReadSTLFile(argv[1])) {
+            std::cerr << "Failed to load " << argv[1] << std::endl;
+            return EXIT_FAILURE;
+        }
+    } else {
+        mesh = make_sphere(20., PI / 300.);
+        TriangleMesh box = make_cube(30., 20., 10.);
+        box.translate(10.f, -10.f, 15.f);
+        mesh.merge(box);
+        TriangleMesh cylinder = make_cylinder(8., 60., PI / 1000.);
+        cylinder.translate(-10.f, 0.f, -30.f);
+        mesh.merge(cylinder);
+    }
+    return benchmark_slarotfinder(mesh, rotations) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
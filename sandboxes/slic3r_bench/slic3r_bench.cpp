@@ -0,0 +1,325 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+#ifdef _WIN32
+    #define WIN32_LEAN_AND_MEAN
+    #define NOMINMAX
+    #include <Windows.h>
+    #include <psapi.h>
+#else
+    #include <sys/resource.h>
+#endif
+
+#include <libslic3r/libslic3r.h>
+#include <libslic3r/Model.hpp>
+#include <libslic3r/Print.hpp>
+#include <libslic3r/Profiler.hpp>
+#include <libslic3r/SLAPrint.hpp>
+#include <libslic3r/TriangleMesh.hpp>
+
+const std::string USAGE_STR = {
+    "Usage: slic3r_bench [case ...]\n"
+    "Runs the FFF and SLA slicing pipelines on procedurally generated meshes. If no case is given, all cases are run.\n"
+    "For each case a single JSON record is printed with the wall time and the number of calls of the individual steps,\n"
+    "the peak resident memory of the process and the throughput. The peak memory is not reset between the cases,\n"
+    "run a single case per process to measure its peak memory."
+};
+
+using namespace Slic3r;
+
+// Peak resident memory of this process in bytes.
+static size_t peak_memory_usage()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS pmc;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)))
+        return size_t(pmc.PeakWorkingSetSize);
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+        size_t peak = size_t(usage.ru_maxrss);
+    #ifdef __linux__
+        // getrusage returns the value in kB on linux
+        peak *= 1024;
+    #endif
+        return peak;
+    }
+#endif
+    return 0;
+}
+
+// Solid gyroid lattice filling a cube of the given size, with its minimum corner at the origin.
+// The surface is extracted from an implicit function by marching tetrahedra over a regular grid.
+// The tetrahedra share the vertices created at the grid edges, therefore the mesh is closed.
+static TriangleMesh make_gyroid(double size, double period, double thickness, double resolution)
+{
+    const double k         = 2. * PI / period;
+    const double half_size = 0.5 * size;
+    // Negative inside the solid: The gyroid surface thickened to a sheet, clipped by the cube.
+    auto         fn        = [k, half_size, thickness](const Vec3d &p) {
+        double g = std::sin(k * p.x()) * std::cos(k * p.y()) + std::sin(k * p.y()) * std::cos(k * p.z()) + std::sin(k * p.z()) * std::cos(k * p.x());
+        double d = std::abs(g) - thickness;
+        for (int i = 0; i < 3; ++ i)
+            d = std::max(d, std::abs(p(i) - half_size) - half_size);
+        // Keep the values off zero to not produce degenerate triangles at the grid vertices.
+        return (d == 0.) ? 1e-12 : d;
+    };
+
+    struct GridVertex {
+        size_t idx;
+        Vec3d  pt;
+        double value;
+    };
+
+    // One grid cell beyond the cube on each side, so that the grid boundary is outside of the solid.
+    const int    n    = int(std::ceil(size / resolution)) + 2;
+    const double cell = size / double(n - 2);
+    const size_t n1   = size_t(n + 1);
+    std::vector<GridVertex> grid(n1 * n1 * n1);
+    for (int z = 0; z <= n; ++ z)
+        for (int y = 0; y <= n; ++ y)
+            for (int x = 0; x <= n; ++ x) {
+                GridVertex &v = grid[(z * n1 + y) * n1 + x];
+                v.idx   = (z * n1 + y) * n1 + x;
+                v.pt    = Vec3d((x - 1) * cell, (y - 1) * cell, (z - 1) * cell);
+                v.value = fn(v.pt);
+            }
+
+    Pointf3s                          points;
+    std::vector<Vec3crd>              facets;
+    std::unordered_map<uint64_t, int> edge_points;
+    // Intersection of the surface with a grid edge.
+    auto edge_point = [&points, &edge_points, &grid](const GridVertex *a, const GridVertex *b) -> int {
+        // Order the end points, so that the intersection point is calculated the same way by all the tetrahedra sharing the edge.
+        if (a->idx > b->idx)
+            std::swap(a, b);
+        uint64_t key = uint64_t(a->idx) * grid.size() + b->idx;
+        auto     it  = edge_points.find(key);
+        if (it != edge_points.end())
+            return it->second;
+        double t = a->value / (a->value - b->value);
+        int    idx = int(points.size());
+        points.emplace_back(a->pt + t * (b->pt - a->pt));
+        edge_points.emplace(key, idx);
+        return idx;
+    };
+    // Add a triangle, orient it to point outside of the solid.
+    auto add_triangle = [&points, &facets](int a, int b, int c, const Vec3d &outside) {
+        if ((points[b] - points[a]).cross(points[c] - points[a]).dot(outside) < 0.)
+            std::swap(b, c);
+        facets.emplace_back(a, b, c);
+    };
+
+    // Kuhn triangulation of a cube into 6 tetrahedra sharing the 0-7 diagonal. The cube corners are indexed by x + 2y + 4z.
+    // Triangulations of the neighbor cubes match at their shared faces.
+    static const int tetras[6][4] = { { 0, 1, 3, 7 }, { 0, 3, 2, 7 }, { 0, 2, 6, 7 }, { 0, 6, 4, 7 }, { 0, 4, 5, 7 }, { 0, 5, 1, 7 } };
+    for (int z = 0; z < n; ++ z)
+        for (int y = 0; y < n; ++ y)
+            for (int x = 0; x < n; ++ x) {
+                const GridVertex *corners[8];
+                for (int i = 0; i < 8; ++ i)
+                    corners[i] = &grid[((z + ((i >> 2) & 1)) * n1 + y + ((i >> 1) & 1)) * n1 + x + (i & 1)];
+                for (const int (&tetra)[4] : tetras) {
+                    const GridVertex *inside[4];
+                    const GridVertex *outside[4];
+                    size_t            num_inside  = 0;
+                    size_t            num_outside = 0;
+                    for (int i : tetra) {
+                        if (corners[i]->value < 0.)
+                            inside[num_inside ++] = corners[i];
+                        else
+                            outside[num_outside ++] = corners[i];
+                    }
+                    if (num_inside == 0 || num_outside == 0)
+                        continue;
+                    Vec3d dir = Vec3d::Zero();
+                    for (size_t i = 0; i < num_outside; ++ i)
+                        dir += outside[i]->pt / double(num_outside);
+                    for (size_t i = 0; i < num_inside; ++ i)
+                        dir -= inside[i]->pt / double(num_inside);
+                    if (num_inside == 1)
+                        add_triangle(edge_point(inside[0], outside[0]), edge_point(inside[0], outside[1]), edge_point(inside[0], outside[2]), dir);
+                    else if (num_outside == 1)
+                        add_triangle(edge_point(outside[0], inside[0]), edge_point(outside[0], inside[1]), edge_point(outside[0], inside[2]), dir);
+                    else {
+                        // Quad of the edges a-c, a-d, b-d, b-c.
+                        int p0 = edge_point(inside[0], outside[0]);
+                        int p1 = edge_point(inside[0], outside[1]);
+                        int p2 = edge_point(inside[1], outside[1]);
+                        int p3 = edge_point(inside[1], outside[0]);
+                        add_triangle(p0, p1, p2, dir);
+                        add_triangle(p0, p2, p3, dir);
+                    }
+                }
+            }
+    return TriangleMesh(points, facets);
+}
+
+// A cylindrical stem with a wide disc on top, the overhanging disc needs to be supported.
+static TriangleMesh make_mushroom()
+{
+    TriangleMesh mesh = make_cylinder(6., 25., PI / 90.);
+    TriangleMesh cap  = make_cylinder(25., 6., PI / 180.);
+    cap.translate(0.f, 0.f, 24.f);
+    mesh.merge(cap);
+    return mesh;
+}
+
+static ModelObject* add_object(Model &model, TriangleMesh &&mesh, const char *name, const Vec2d &position)
+{
+    mesh.repair();
+    ModelObject *object = model.add_object(name, "", std::move(mesh));
+    object->add_instance()->set_offset(Vec3d(position.x(), position.y(), 0.));
+    object->center_around_origin();
+    object->ensure_on_bed();
+    return object;
+}
+
+struct BenchCase {
+    std::string                             name;
+    PrinterTechnology                       technology;
+    // Fill the model and override the default print config.
+    std::function<void(Model&, DynamicPrintConfig&)> setup;
+};
+
+static std::vector<BenchCase> bench_cases()
+{
+    return {
+        { "fff_sphere", ptFFF, [](Model &model, DynamicPrintConfig &) {
+            add_object(model, make_sphere(30., PI / 180.), "sphere", Vec2d(100., 100.));
+        } },
+        { "fff_gyroid", ptFFF, [](Model &model, DynamicPrintConfig &) {
+            add_object(model, make_gyroid(30., 10., 0.4, 0.6), "gyroid", Vec2d(100., 100.));
+        } },
+        { "fff_supports", ptFFF, [](Model &model, DynamicPrintConfig &config) {
+            add_object(model, make_mushroom(), "mushroom", Vec2d(100., 100.));
+            config.set_key_value("support_material", new ConfigOptionBool(true));
+        } },
+        { "fff_plate", ptFFF, [](Model &model, DynamicPrintConfig &) {
+            // Many small distinct objects, each of them having just a few layers.
+            for (int i = 0; i < 25; ++ i) {
+                Vec2d position(60. + 20. * (i % 5), 60. + 20. * (i / 5));
+                if (i % 2)
+                    add_object(model, make_cylinder(5. + 0.1 * i, 4. + 0.5 * i, PI / 90.), "cylinder", position);
+                else
+                    add_object(model, make_sphere(6. + 0.1 * i, PI / 60.), "sphere", position);
+            }
+        } },
+        { "fff_instances", ptFFF, [](Model &model, DynamicPrintConfig &) {
+            // A single object printed many times, exercising the G-code export rather than the slicing.
+            add_object(model, make_gyroid(15., 5., 0.4, 0.5), "gyroid", Vec2d(0., 0.));
+            model.duplicate_objects_grid(6, 6, 3.);
+            model.objects.front()->ensure_on_bed();
+            model.center_instances_around_point(Vec2d(100., 100.));
+        } },
+        { "sla_sphere", ptSLA, [](Model &model, DynamicPrintConfig &) {
+            add_object(model, make_sphere(20., PI / 180.), "sphere", Vec2d(0., 0.));
+        } },
+        { "sla_gyroid", ptSLA, [](Model &model, DynamicPrintConfig &) {
+            add_object(model, make_gyroid(30., 10., 0.4, 0.6), "gyroid", Vec2d(0., 0.));
+        } },
+    };
+}
+
+static double seconds_since(const std::chrono::steady_clock::time_point &t)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - t).count();
+}
+
+// Run the whole pipeline including the export, print a single JSON record.
+static void run_case(const BenchCase &bench_case, const boost::filesystem::path &output_dir)
+{
+    Model              model;
+    DynamicPrintConfig config;
+    if (bench_case.technology == ptFFF)
+        config.apply(FullPrintConfig::defaults());
+    else
+        config.apply(SLAFullPrintConfig::defaults());
+    bench_case.setup(model, config);
+
+    size_t facets = 0;
+    for (const ModelObject *object : model.objects)
+        facets += object->facets_count() * object->instances.size();
+
+    Print     fff_print;
+    SLAPrint  sla_print;
+    PrintBase *print = (bench_case.technology == ptFFF) ? static_cast<PrintBase*>(&fff_print) : static_cast<PrintBase*>(&sla_print);
+    std::string output_path = (output_dir / (bench_case.name + ((bench_case.technology == ptFFF) ? ".gcode" : ".sl1"))).string();
+
+    Profiler::start();
+    auto   t_start = std::chrono::steady_clock::now();
+    print->apply(model, config);
+    std::string err = print->validate();
+    if (! err.empty())
+        throw std::runtime_error(err);
+    print->process();
+    double time_process = seconds_since(t_start);
+    t_start = std::chrono::steady_clock::now();
+    size_t layers = 0;
+    if (bench_case.technology == ptFFF) {
+        fff_print.export_gcode(output_path, nullptr);
+        for (const PrintObject *object : fff_print.objects())
+            layers += object->total_layer_count();
+    } else {
+        sla_print.export_raster(output_path);
+        layers = sla_print.print_statistics().slow_layers_count + sla_print.print_statistics().fast_layers_count;
+    }
+    double time_export = seconds_since(t_start);
+    Profiler::stop();
+    boost::filesystem::remove(output_path);
+
+    std::cout << "{ \"case\": \"" << bench_case.name << "\", \"technology\": \"" << ((bench_case.technology == ptFFF) ? "FFF" : "SLA") <<
+        "\", \"objects\": " << model.objects.size() << ", \"facets\": " << facets << ", \"layers\": " << layers <<
+        ", \"process_seconds\": " << time_process << ", \"export_seconds\": " << time_export <<
+        ", \"layers_per_second\": " << double(layers) / (time_process + time_export) <<
+        ", \"peak_memory_bytes\": " << peak_memory_usage() << ", \"steps\": [";
+    bool first = true;
+    for (const Profiler::ZoneStats &zone : Profiler::summarize()) {
+        std::cout << (first ? "" : ",") << " { \"name\": \"" << zone.name << "\", \"count\": " << zone.count <<
+            ", \"wall_seconds\": " << zone.wall << ", \"total_seconds\": " << zone.total << " }";
+        first = false;
+    }
+    std::cout << " ] }" << std::endl;
+}
+
+int main(const int argc, const char *argv[]) {
+    std::vector<BenchCase> cases = bench_cases();
+    std::vector<std::string> names;
+    for (int i = 1; i < argc; ++ i)
+        names.emplace_back(argv[i]);
+    if (! names.empty() && (names.front() == "-h" || names.front() == "--help")) {
+        std::cout << USAGE_STR << std::endl << "Cases:";
+        for (const BenchCase &bench_case : cases)
+            std::cout << " " << bench_case.name;
+        std::cout << std::endl;
+        return EXIT_SUCCESS;
+    }
+    for (const std::string &name : names)
+        if (std::find_if(cases.begin(), cases.end(), [&name](const BenchCase &c) { return c.name == name; }) == cases.end()) {
+            std::cerr << "Unknown case " << name << std::endl;
+            return EXIT_FAILURE;
+        }
+
+    boost::filesystem::path output_dir = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("slic3r_bench-%%%%-%%%%");
+    boost::filesystem::create_directories(output_dir);
+    int result = EXIT_SUCCESS;
+    for (const BenchCase &bench_case : cases)
+        if (names.empty() || std::find(names.begin(), names.end(), bench_case.name) != names.end()) {
+            try {
+                run_case(bench_case, output_dir);
+            } catch (const std::exception &ex) {
+                std::cerr << bench_case.name << " failed: " << ex.what() << std::endl;
+                result = EXIT_FAILURE;
+            }
+        }
+    boost::filesystem::remove_all(output_dir);
+    return result;
+}
@@ -0,0 +1,61 @@
+#include <chrono>
+#include <iostream>
+#include <string>
+
+#include <boost/filesystem.hpp>
+
+#include <libslic3r/libslic3r.h>
+#include <libslic3r/TriangleMesh.hpp>
+
+const std::string USAGE_STR = {
+    "Usage: stlload [stlfilename.stl] [repetitions]\n"
+    "Measures the STL loading throughput. If no file is given, a finely tesselated sphere\n"
+    "is generated and loaded both from a binary and from an ASCII STL file."
+};
+
+// Load the file repeatedly, print the best time as a single JSON record.
+static bool benchmark_load(const std::string &path, const char *format, int repetitions)
+{
+    using namespace Slic3r;
+    double best = std::numeric_limits<double>::max();
+    size_t num_facets = 0;
+    for (int i = 0; i < repetitions; ++ i) {
+        TriangleMesh mesh;
+        auto t_start = std::chrono::steady_clock::now();
+        if (! mesh.ReadSTLFile(path.c_str())) {
+            std::cerr << "Failed to load " << path << std::endl;
+            return false;
+        }
+        best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - t_start).count());
+        num_facets = mesh.stl.stats.number_of_facets;
+    }
+    double size_MB = double(boost::filesystem::file_size(path)) / (1024. * 1024.);
+    std::cout << "{ \"format\": \"" << format << "\", \"facets\": " << num_facets << ", \"file_MB\": " << size_MB << 
+        ", \"seconds\": " << best << ", \"facets_per_second\": " << double(num_facets) / best << 
+        ", \"MB_per_second\": " << size_MB / best << " }" << std::endl;
+    return true;
+}
+
+int main(const int argc, const char *argv[]) {
+    using namespace Slic3r;
+
+    int repetitions = (argc > 2) ? std::max(1, atoi(argv[2])) : 5;
+    if (argc > 1) {
+        if (std::string(argv[1]) == "-h" || std::string(argv[1]) == "--help") {
+            std::cout << USAGE_STR << std::endl;
+            return EXIT_SUCCESS;
+        }
+        return benchmark_load(argv[1], "file", repetitions) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    // Roughly 2 million facets.
+    TriangleMesh sphere = make_sphere(50., PI / 700.);
+    boost::filesystem::path tmp_dir = boost::filesystem::temp_directory_path();
+    std::string path_binary = (tmp_dir / boost::filesystem::unique_path("stlload-%%%%%%-binary.stl")).string();
+    std::string path_ascii  = (tmp_dir / boost::filesystem::unique_path("stlload-%%%%%%-ascii.stl")).string();
+    bool ok = sphere.write_binary(path_binary.c_str()) && sphere.write_ascii(path_ascii.c_str());
+    ok = ok && benchmark_load(path_binary, "binary", repetitions) && benchmark_load(path_ascii, "ascii", repetitions);
+    boost::filesystem::remove(path_binary);
+    boost::filesystem::remove(path_ascii);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
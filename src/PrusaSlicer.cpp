@@ -25,6 +25,7 @@
 #include <boost/filesystem.hpp>
 #include <boost/nowide/args.hpp>
 #include <boost/nowide/cenv.hpp>
+#include <boost/nowide/fstream.hpp>
 #include <boost/nowide/iostream.hpp>
 #include <boost/nowide/integration/filesystem.hpp>
 
@@ -41,6 +42,8 @@
 #include "libslic3r/Format/3mf.hpp"
 #include "libslic3r/Format/STL.hpp"
 #include "libslic3r/Format/OBJ.hpp"
+#include "libslic3r/GCode/FileAnalyzer.hpp"
+#include "libslic3r/Profiler.hpp"
 #include "libslic3r/Utils.hpp"
 
 #include "PrusaSlicer.hpp"
@@ -334,6 +337,10 @@ int CLI::run(int argc, char **argv)
         }
     }
 
+    const std::string profile_trace = m_config.opt_string("profile_trace");
+    if (! profile_trace.empty())
+        Profiler::start();
+
     // loop through action options
     for (auto const &opt_key : m_actions) {
         if (opt_key == "help") {
@@ -346,6 +353,27 @@ int CLI::run(int argc, char **argv)
             //FIXME check for mixing the FFF / SLA parameters.
             // or better save fff_print_config vs. sla_print_config
             m_print_config.save(m_config.opt_string("save"));
+        } else if (opt_key == "analyze_gcode") {
+            // Runs on the loaded configuration only, no model is needed.
+            GCodeFileAnalyzer analyzer;
+            try {
+                analyzer.analyze(m_config.opt_string("analyze_gcode"), m_print_config);
+            } catch (const std::exception &ex) {
+                boost::nowide::cerr << ex.what() << std::endl;
+                return 1;
+            }
+            const std::string outfile = m_config.opt_string("output");
+            if (outfile.empty())
+                analyzer.export_json(boost::nowide::cout);
+            else {
+                boost::nowide::ofstream out(outfile);
+                analyzer.export_json(out);
+                if (! out) {
+                    boost::nowide::cerr << "Failed to write the G-code analysis to " << outfile << std::endl;
+                    return 1;
+                }
+                boost::nowide::cout << "G-code analysis exported to " << outfile << std::endl;
+            }
         } else if (opt_key == "info") {
             // --info works on unrepaired model
             for (Model &model : m_models) {
@@ -423,7 +451,7 @@ int CLI::run(int argc, char **argv)
                         print->process();
                         if (printer_technology == ptFFF) {
                             // The outfile is processed by a PlaceholderParser.
-                            outfile = fff_print.export_gcode(outfile, nullptr);
+                            outfile = fff_print.export_gcode(outfile, nullptr, ! m_config.opt_bool("serial_gcode_export"));
                             outfile_final = fff_print.print_statistics().finalize_output_path(outfile);
                         } else {
                             outfile = sla_print.output_filepath(outfile);
@@ -477,6 +505,15 @@ int CLI::run(int argc, char **argv)
         }
     }
 
+    if (! profile_trace.empty()) {
+        Profiler::stop();
+        if (! Profiler::export_chrome_trace(profile_trace)) {
+            boost::nowide::cerr << "Failed to write the profile trace to " << profile_trace << std::endl;
+            return 1;
+        }
+        boost::nowide::cout << "Profile trace exported to " << profile_trace << std::endl;
+    }
+
     if (start_gui) {
 #ifdef SLIC3R_GUI
 // #ifdef USE_WX
@@ -26,6 +26,7 @@
 #include <math.h>
 
 #include <algorithm>
+#include <limits>
 #include <vector>
 
 #include <boost/predef/other/endian.h>
@@ -34,6 +35,11 @@
 #define BOOST_POOL_NO_MT
 #include <boost/pool/object_pool.hpp>
 
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+#include <tbb/parallel_reduce.h>
+#include <tbb/parallel_sort.h>
+
 #include "stl.h"
 
 struct HashEdge {
@@ -43,21 +49,32 @@ struct HashEdge {
 	bool operator==(const HashEdge &rhs) const { return memcmp(key, rhs.key, sizeof(key)) == 0; }
 	bool operator!=(const HashEdge &rhs) const { return ! (*this == rhs); }
 	int  hash(int M) const { return ((key[0] / 11 + key[1] / 7 + key[2] / 3) ^ (key[3] / 11  + key[4] / 7 + key[5] / 3)) % M; }
+	// Order of edges by their keys. Edges with equal keys are ordered by the sequence, in which stl_check_facets_exact()
+	// used to insert them into the hash table, so that the matching of non-manifold edges is reproduced exactly.
+	bool operator<(const HashEdge &rhs) const {
+		for (int i = 0; i < 6; ++ i)
+			if (key[i] != rhs.key[i])
+				return key[i] < rhs.key[i];
+		return (facet_number != rhs.facet_number) ? (facet_number < rhs.facet_number) : (which_edge % 3 < rhs.which_edge % 3);
+	}
 
 	// Index of a facet owning this edge.
 	int        facet_number;
 	// Index of this edge inside the facet with an index of facet_number.
 	// If this edge is stored backwards, which_edge is increased by 3.
 	int        which_edge;
-	HashEdge  *next;
 
 	void load_exact(stl_file *stl, const stl_vertex *a, const stl_vertex *b)
 	{
-		{
-	    	stl_vertex diff = (*a - *b).cwiseAbs();
-	    	float max_diff = std::max(diff(0), std::max(diff(1), diff(2)));
-	    	stl->stats.shortest_edge = std::min(max_diff, stl->stats.shortest_edge);
-	  	}
+		stl->stats.shortest_edge = std::min(this->load_exact(a, b), stl->stats.shortest_edge);
+	}
+
+	// Load the key without touching the mesh statistics, so that the edges may be loaded in parallel.
+	// Returns the length of the edge in the maximum norm.
+	float load_exact(const stl_vertex *a, const stl_vertex *b)
+	{
+    	stl_vertex diff = (*a - *b).cwiseAbs();
+    	float max_diff = std::max(diff(0), std::max(diff(1), diff(2)));
 
 	  	// Ensure identical vertex ordering of equal edges.
 	  	// This method is numerically robust.
@@ -82,6 +99,7 @@ struct HashEdge {
 	      		p[0] = 0;
 	#endif /* BOOST_ENDIAN_LITTLE_BYTE */
 	  	}
+	  	return max_diff;
 	}
 
 	bool load_nearby(const stl_file *stl, const stl_vertex &a, const stl_vertex &b, float tolerance)
@@ -120,9 +138,38 @@ private:
 	}
 };
 
+// Record facets of edge_a and edge_b as neighbors of each other. Only the neighbor slots of the two edges are written,
+// therefore disjoint pairs of edges may be linked concurrently.
+static inline void link_neighbors(stl_file *stl, const HashEdge &edge_a, const HashEdge &edge_b)
+{
+	// Facet a's neighbor is facet b
+	stl->neighbors_start[edge_a.facet_number].neighbor[edge_a.which_edge % 3] = edge_b.facet_number;	/* sets the .neighbor part */
+	stl->neighbors_start[edge_a.facet_number].which_vertex_not[edge_a.which_edge % 3] = (edge_b.which_edge + 2) % 3; /* sets the .which_vertex_not part */
+
+	// Facet b's neighbor is facet a
+	stl->neighbors_start[edge_b.facet_number].neighbor[edge_b.which_edge % 3] = edge_a.facet_number;	/* sets the .neighbor part */
+	stl->neighbors_start[edge_b.facet_number].which_vertex_not[edge_b.which_edge % 3] = (edge_a.which_edge + 2) % 3; /* sets the .which_vertex_not part */
+
+	if (((edge_a.which_edge < 3) && (edge_b.which_edge < 3)) || ((edge_a.which_edge > 2) && (edge_b.which_edge > 2))) {
+		// These facets are oriented in opposite directions, their normals are probably messed up.
+		stl->neighbors_start[edge_a.facet_number].which_vertex_not[edge_a.which_edge % 3] += 3;
+		stl->neighbors_start[edge_b.facet_number].which_vertex_not[edge_b.which_edge % 3] += 3;
+	}
+}
+
+// Edge stored in a chain of HashTableEdges.
+struct HashEdgeLink : public HashEdge {
+	HashEdgeLink() : next(nullptr) {}
+	HashEdgeLink(const HashEdge &edge) : HashEdge(edge), next(nullptr) {}
+	HashEdgeLink *next;
+};
+
+// Chained hash table, used for sequential matching of the open edges by stl_check_facets_nearby() and stl_fill_holes(),
+// where the matching modifies the mesh and the result depends on the order of insertion.
+// Matching of all edges of a mesh by stl_check_facets_exact() is done by sorting, see stl_check_facets_exact().
 struct HashTableEdges {
-	HashTableEdges(size_t number_of_faces) {
-		this->M = (int)hash_size_from_nr_faces(number_of_faces);
+	HashTableEdges(size_t number_of_edges) {
+		this->M = (int)hash_size_from_nr_edges(number_of_edges);
 		this->heads.assign(this->M, nullptr);
 		this->tail = pool.construct();
 		this->tail->next = this->tail;
@@ -132,7 +179,7 @@ struct HashTableEdges {
 	~HashTableEdges() {
 #ifndef NDEBUG
 		for (int i = 0; i < this->M; ++ i)
-	    	for (HashEdge *temp = this->heads[i]; temp != this->tail; temp = temp->next)
+	    	for (HashEdgeLink *temp = this->heads[i]; temp != this->tail; temp = temp->next)
 	        	++ this->freed;
 		this->tail = nullptr;
 #endif /* NDEBUG */
@@ -149,10 +196,10 @@ struct HashTableEdges {
 	}
 
 	// Hash table on edges
-	std::vector<HashEdge*> 	heads;
-	HashEdge* 				tail;
+	std::vector<HashEdgeLink*> heads;
+	HashEdgeLink* 			tail;
 	int           			M;
-	boost::object_pool<HashEdge> pool;
+	boost::object_pool<HashEdgeLink> pool;
 
 #ifndef NDEBUG
 	size_t 					malloced   	= 0;
@@ -161,13 +208,13 @@ struct HashTableEdges {
 #endif /* NDEBUG */
 
 private:
-	static inline size_t hash_size_from_nr_faces(const size_t nr_faces)
+	static inline size_t hash_size_from_nr_edges(const size_t nr_edges)
 	{
 		// Good primes for addressing a cca. 30 bit space.
 		// https://planetmath.org/goodhashtableprimes
 		static std::vector<uint32_t> primes{ 98317, 196613, 393241, 786433, 1572869, 3145739, 6291469, 12582917, 25165843, 50331653, 100663319, 201326611, 402653189, 805306457, 1610612741 };
-		// Find a prime number for 50% filling of the shared triangle edges in the mesh.
-		auto it = std::upper_bound(primes.begin(), primes.end(), nr_faces * 3 * 2 - 1);
+		// Find a prime number for 50% filling of the edges inserted.
+		auto it = std::upper_bound(primes.begin(), primes.end(), nr_edges * 2);
 		return (it == primes.end()) ? primes.back() : *it;
 	}
 
@@ -177,10 +224,10 @@ private:
 	void insert_edge(stl_file *stl, const HashEdge &edge, MatchNeighbors match_neighbors)
 	{
 		int       chain_number = edge.hash(this->M);
-		HashEdge *link         = this->heads[chain_number];
+		HashEdgeLink *link     = this->heads[chain_number];
 		if (link == this->tail) {
 			// This list doesn't have any edges currently in it.  Add this one.
-			HashEdge *new_edge = pool.construct(edge);
+			HashEdgeLink *new_edge = pool.construct(edge);
 #ifndef NDEBUG
 			++ this->malloced;
 #endif /* NDEBUG */
@@ -200,11 +247,10 @@ private:
 			for (;;) {
 				if (link->next == this->tail) {
 					// This is the last item in the list. Insert a new edge.
-					HashEdge *new_edge = pool.construct();
+					HashEdgeLink *new_edge = pool.construct(edge);
 #ifndef NDEBUG
 					++ this->malloced;
 #endif /* NDEBUG */
-					*new_edge = edge;
 					new_edge->next = this->tail;
 					link->next = new_edge;
 #ifndef NDEBUG
@@ -216,7 +262,7 @@ private:
 					// This is a match.  Record result in neighbors list.
 					match_neighbors(edge, *link->next);
 					// Delete the matched edge from the list.
-					HashEdge *temp = link->next;
+					HashEdgeLink *temp = link->next;
 					link->next = link->next->next;
 					// pool.destroy(temp);
 #ifndef NDEBUG
@@ -241,19 +287,7 @@ private:
 
 	static void record_neighbors(stl_file *stl, const HashEdge &edge_a, const HashEdge &edge_b)
 	{
-		// Facet a's neighbor is facet b
-		stl->neighbors_start[edge_a.facet_number].neighbor[edge_a.which_edge % 3] = edge_b.facet_number;	/* sets the .neighbor part */
-		stl->neighbors_start[edge_a.facet_number].which_vertex_not[edge_a.which_edge % 3] = (edge_b.which_edge + 2) % 3; /* sets the .which_vertex_not part */
-
-		// Facet b's neighbor is facet a
-		stl->neighbors_start[edge_b.facet_number].neighbor[edge_b.which_edge % 3] = edge_a.facet_number;	/* sets the .neighbor part */
-		stl->neighbors_start[edge_b.facet_number].which_vertex_not[edge_b.which_edge % 3] = (edge_a.which_edge + 2) % 3; /* sets the .which_vertex_not part */
-
-		if (((edge_a.which_edge < 3) && (edge_b.which_edge < 3)) || ((edge_a.which_edge > 2) && (edge_b.which_edge > 2))) {
-			// These facets are oriented in opposite directions, their normals are probably messed up.
-			stl->neighbors_start[edge_a.facet_number].which_vertex_not[edge_a.which_edge % 3] += 3;
-			stl->neighbors_start[edge_b.facet_number].which_vertex_not[edge_b.which_edge % 3] += 3;
-		}
+		link_neighbors(stl, edge_a, edge_b);
 
 		// Count successful connects:
 		// Total connects:
@@ -425,6 +459,15 @@ private:
 	}
 };
 
+// Number of edges without a neighbor, used to size the hash table of the open edges.
+static size_t stl_count_open_edges(const stl_file *stl)
+{
+	size_t num_open = 0;
+	for (const stl_neighbors &neighbors : stl->neighbors_start)
+		num_open += neighbors.num_neighbors_missing();
+	return num_open;
+}
+
 // This function builds the neighbors list.  No modifications are made
 // to any of the facets.  The edges are said to match only if all six
 // floats of the first edge matches all six floats of the second edge.
@@ -453,21 +496,77 @@ void stl_check_facets_exact(stl_file *stl)
 		  	++ i;
   	}
 
-  	// Initialize hash table.
-  	HashTableEdges hash_table(stl->stats.number_of_facets);
 	for (auto &neighbor : stl->neighbors_start)
 		neighbor.reset();
 
-  	// Connect neighbor edges.
-	for (uint32_t i = 0; i < stl->stats.number_of_facets; ++ i) {
-		const stl_facet &facet = stl->facet_start[i];
-		for (int j = 0; j < 3; ++ j) {
-			HashEdge edge;
-			edge.facet_number = i;
-			edge.which_edge = j;
-			edge.load_exact(stl, &facet.vertex[j], &facet.vertex[(j + 1) % 3]);
-			hash_table.insert_edge_exact(stl, edge);
-		}
+	// Load all edges with their keys in parallel.
+	std::vector<HashEdge> edges(size_t(stl->stats.number_of_facets) * 3);
+	stl->stats.shortest_edge = std::min(stl->stats.shortest_edge, tbb::parallel_reduce(
+		tbb::blocked_range<uint32_t>(0, stl->stats.number_of_facets), std::numeric_limits<float>::max(),
+		[stl, &edges](const tbb::blocked_range<uint32_t> &range, float shortest_edge) {
+			for (uint32_t i = range.begin(); i < range.end(); ++ i) {
+				const stl_facet &facet = stl->facet_start[i];
+				for (int j = 0; j < 3; ++ j) {
+					HashEdge &edge = edges[size_t(i) * 3 + j];
+					edge.facet_number = i;
+					edge.which_edge = j;
+					shortest_edge = std::min(shortest_edge, edge.load_exact(&facet.vertex[j], &facet.vertex[(j + 1) % 3]));
+				}
+			}
+			return shortest_edge;
+		},
+		[](float a, float b) { return std::min(a, b); }));
+
+	// Sort the edges, so that equal edges are grouped together, ordered by their facet and edge index.
+	tbb::parallel_sort(edges.begin(), edges.end());
+
+	// Connect neighbor edges. Each group of equal edges is matched the same way a chained hash table filled with edges
+	// in the order of facets would match them: an edge is matched with the first unmatched edge of a different facet
+	// inserted before it. Groups are independent and they write to disjoint neighbor slots, thus they are processed in parallel.
+	tbb::parallel_for(tbb::blocked_range<size_t>(0, edges.size()),
+		[stl, &edges](const tbb::blocked_range<size_t> &range) {
+			std::vector<const HashEdge*> unmatched;
+			size_t i = range.begin();
+			// Skip the tail of a group started by the preceding range.
+			while (i < range.end() && i > 0 && edges[i] == edges[i - 1])
+				++ i;
+			while (i < range.end()) {
+				size_t j = i + 1;
+				while (j < edges.size() && edges[j] == edges[i])
+					++ j;
+				if (j == i + 2) {
+					// Manifold edge, the most common case.
+					if (edges[i].facet_number != edges[i + 1].facet_number)
+						link_neighbors(stl, edges[i + 1], edges[i]);
+				} else if (j > i + 2) {
+					// Non-manifold edge.
+					unmatched.clear();
+					for (size_t k = i; k < j; ++ k) {
+						const HashEdge &edge = edges[k];
+						auto it = std::find_if(unmatched.begin(), unmatched.end(), 
+							[&edge](const HashEdge *e){ return e->facet_number != edge.facet_number; });
+						if (it == unmatched.end())
+							unmatched.emplace_back(&edge);
+						else {
+							link_neighbors(stl, edge, **it);
+							unmatched.erase(it);
+						}
+					}
+				}
+				i = j;
+			}
+		});
+
+	// Count successful connects.
+	for (const stl_neighbors &neighbors : stl->neighbors_start) {
+		int num_neighbors = neighbors.num_neighbors();
+		stl->stats.connected_edges += num_neighbors;
+		if (num_neighbors > 0)
+			++ stl->stats.connected_facets_1_edge;
+		if (num_neighbors > 1)
+			++ stl->stats.connected_facets_2_edge;
+		if (num_neighbors > 2)
+			++ stl->stats.connected_facets_3_edge;
 	}
 
 #if 0
@@ -486,7 +585,7 @@ void stl_check_facets_nearby(stl_file *stl, float tolerance)
     	return;
   	}
 
-  	HashTableEdges hash_table(stl->stats.number_of_facets);
+  	HashTableEdges hash_table(stl_count_open_edges(stl));
   	for (uint32_t i = 0; i < stl->stats.number_of_facets; ++ i) {
     	//FIXME is the copy necessary?
     	stl_facet facet = stl->facet_start[i];
@@ -667,7 +766,7 @@ void stl_remove_unconnected_facets(stl_file *stl)
 void stl_fill_holes(stl_file *stl)
 {
 	// Insert all unconnected edges into hash list.
-	HashTableEdges hash_table(stl->stats.number_of_facets);
+	HashTableEdges hash_table(stl_count_open_edges(stl));
 	for (uint32_t i = 0; i < stl->stats.number_of_facets; ++ i) {
   		stl_facet facet = stl->facet_start[i];
 		for (int j = 0; j < 3; ++ j) {
@@ -26,9 +26,18 @@
 #include <math.h>
 #include <assert.h>
 
+#include <algorithm>
+#include <vector>
+
 #include <boost/log/trivial.hpp>
 #include <boost/nowide/cstdio.hpp>
 #include <boost/detail/endian.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+#include <tbb/parallel_reduce.h>
 
 #include "stl.h"
 
@@ -36,7 +45,7 @@
 #error "SEEK_SET not defined"
 #endif
 
-static FILE* stl_open_count_facets(stl_file *stl, const char *file) 
+static FILE* stl_open_count_facets(stl_file *stl, const char *file, size_t &file_size_out) 
 {
   	// Open the file in binary mode first.
   	FILE *fp = boost::nowide::fopen(file, "rb");
@@ -47,6 +56,7 @@ static FILE* stl_open_count_facets(stl_file *stl, const char *file)
   	// Find size of file.
   	fseek(fp, 0, SEEK_END);
   	long file_size = ftell(fp);
+  	file_size_out = size_t(file_size);
 
   	// Check for binary or ASCII file.
   	fseek(fp, HEADER_SIZE, SEEK_SET);
@@ -136,69 +146,247 @@ static FILE* stl_open_count_facets(stl_file *stl, const char *file)
   	return fp;
 }
 
-/* Reads the contents of the file pointed to by fp into the stl structure,
-   starting at facet first_facet.  The second argument says if it's our first
-   time running this for the stl and therefore we should reset our max and min stats. */
-static bool stl_read(stl_file *stl, FILE *fp, int first_facet, bool first)
+namespace bip = boost::interprocess;
+
+// Size of a window of the STL file mapped into memory at once.
+#define STL_MAPPED_WINDOW_SIZE (64 * 1024 * 1024)
+// Number of facets copied or bounded by a single TBB task.
+#define STL_FACETS_PER_TASK 16384
+
+// Minimalistic tokenizer of an ASCII STL file mapped into memory, replacing a chain of fscanf() calls per facet.
+// The tokens are separated by white spaces (including newlines, Windows newlines and tabs).
+class StlAsciiTokenizer
 {
-	if (stl->stats.type == binary)
-    	fseek(fp, HEADER_SIZE, SEEK_SET);
-  	else
-    	rewind(fp);
+public:
+	StlAsciiTokenizer(const char *begin, const char *end) : m_ptr(begin), m_end(end) {}
 
-  	char normal_buf[3][32];
-  	for (uint32_t i = first_facet; i < stl->stats.number_of_facets; ++ i) {
-  	  	stl_facet facet;
+	// Is there anything else than white spaces left?
+	bool eof() {
+		skip_whitespaces();
+		return m_ptr == m_end;
+	}
+	// Try to consume the given keyword, return false if the next token is not the keyword.
+	bool keyword(const char *kw) {
+		skip_whitespaces();
+		const char *p = m_ptr;
+		for (; *kw != 0; ++ kw, ++ p)
+			if (p == m_end || *p != *kw)
+				return false;
+		m_ptr = p;
+		return true;
+	}
+	// Skip the rest of the current line including the newline.
+	void skip_line() {
+		const char *eol = (const char*)memchr(m_ptr, '\n', m_end - m_ptr);
+		m_ptr = (eol == nullptr) ? m_end : eol + 1;
+	}
+	// Parse a single float. Returns false if there is no valid number at the current position.
+	// The conversion itself is left to strtof() to produce the same floats as scanf("%f"), the speed up comes
+	// from not having to go through the scanf format interpreter and the FILE locking for each number.
+	// The number is copied into a zero terminated buffer first, as the mapped file is not zero terminated.
+	bool number(float &out) {
+		skip_whitespaces();
+		size_t len = 0;
+		for (; m_ptr + len != m_end && len + 1 < sizeof(m_number) && ! is_whitespace(m_ptr[len]); ++ len)
+			m_number[len] = m_ptr[len];
+		m_number[len] = 0;
+		char *endptr = nullptr;
+		out = strtof(m_number, &endptr);
+		if (endptr == m_number)
+			return false;
+		m_ptr += endptr - m_number;
+		return true;
+	}
+	// Parse a whole white space separated token as a number. Returns false if the token does not start with a number.
+	bool number_token(float &out) {
+		skip_whitespaces();
+		const char *token_end = m_ptr;
+		for (; token_end != m_end && ! is_whitespace(*token_end); ++ token_end) ;
+		bool valid = this->number(out);
+		m_ptr = token_end;
+		return valid;
+	}
 
-    	if (stl->stats.type == binary) {
-      		// Read a single facet from a binary .STL file. We assume little-endian architecture!
-      		if (fread(&facet, 1, SIZEOF_STL_FACET, fp) != SIZEOF_STL_FACET)
-      			return false;
-#ifndef BOOST_LITTLE_ENDIAN
-      		// Convert the loaded little endian data to big endian.
-      		stl_internal_reverse_quads((char*)&facet, 48);
-#endif /* BOOST_LITTLE_ENDIAN */
-    	} else {
-			// Read a single facet from an ASCII .STL file
+private:
+	static bool is_whitespace(char c) { return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f'; }
+	void skip_whitespaces() { for (; m_ptr != m_end && is_whitespace(*m_ptr); ++ m_ptr) ; }
+
+	const char *m_ptr;
+	const char *m_end;
+	char 		m_number[64];
+};
+
+// Find the end of the last line of [begin, end) containing "endfacet", so that a window of a mapped ASCII STL file
+// is only parsed up to the end of its last complete facet. Returns begin if there is no such line.
+static const char* stl_ascii_last_facet_end(const char *begin, const char *end)
+{
+	static const char   endfacet[] = "endfacet";
+	static const size_t endfacet_len = sizeof(endfacet) - 1;
+	// Only the complete lines are considered.
+	while (end > begin && end[-1] != '\n')
+		-- end;
+	for (const char *line_end = end; line_end > begin;) {
+		const char *line_begin = line_end - 1;
+		while (line_begin > begin && line_begin[-1] != '\n')
+			-- line_begin;
+		for (const char *p = line_begin; p + endfacet_len <= line_end; ++ p)
+			if (memcmp(p, endfacet, endfacet_len) == 0)
+				return line_end;
+		line_end = line_begin;
+	}
+	return begin;
+}
+
+static bool stl_read_ascii(stl_file *stl, const bip::file_mapping &mapping, size_t file_size, int first_facet)
+{
+	// Parse the file window by window, each window is cut at a facet boundary.
+	size_t   window_size = STL_MAPPED_WINDOW_SIZE;
+	size_t   offset      = 0;
+	uint32_t i           = first_facet;
+	while (i < stl->stats.number_of_facets && offset < file_size) {
+		size_t size = std::min(window_size, file_size - offset);
+		bip::mapped_region region(mapping, bip::read_only, bip::offset_t(offset), size);
+		region.advise(bip::mapped_region::advice_sequential);
+		const char *begin = static_cast<const char*>(region.get_address());
+		const char *end   = begin + size;
+		if (offset + size < file_size) {
+			end = stl_ascii_last_facet_end(begin, end);
+			if (end == begin) {
+				// Not even a single facet fits into the window.
+				window_size *= 2;
+				continue;
+			}
+		}
+		StlAsciiTokenizer tokenizer(begin, end);
+		for (; i < stl->stats.number_of_facets && ! tokenizer.eof(); ++ i) {
+			stl_facet facet;
 			// skip solid/endsolid
 			// (in this order, otherwise it won't work when they are paired in the middle of a file)
-			fscanf(fp, "endsolid %*[^\n]\n");
-			fscanf(fp, "solid %*[^\n]\n");  // name might contain spaces so %*s doesn't work and it also can be empty (just "solid")
-			// Leading space in the fscanf format skips all leading white spaces including numerous new lines and tabs.
-			int res_normal     = fscanf(fp, " facet normal %31s %31s %31s ", normal_buf[0], normal_buf[1], normal_buf[2]);
-			assert(res_normal == 3);
-			int res_outer_loop = fscanf(fp, " outer loop ");
-			assert(res_outer_loop == 0);
-			int res_vertex1    = fscanf(fp, " vertex %f %f %f ", &facet.vertex[0](0), &facet.vertex[0](1), &facet.vertex[0](2));
-			assert(res_vertex1 == 3);
-			int res_vertex2    = fscanf(fp, " vertex %f %f %f ", &facet.vertex[1](0), &facet.vertex[1](1), &facet.vertex[1](2));
-			assert(res_vertex2 == 3);
-			int res_vertex3    = fscanf(fp, " vertex %f %f %f ", &facet.vertex[2](0), &facet.vertex[2](1), &facet.vertex[2](2));
-			assert(res_vertex3 == 3);
-			int res_endloop    = fscanf(fp, " endloop %*[^\n]\n");
-			assert(res_endloop == 0);
-			// There is a leading and trailing white space around endfacet to eat up all leading and trailing white spaces including numerous tabs and new lines.
-			int res_endfacet   = fscanf(fp, " endfacet %*[^\n]\n");
-			if (res_normal != 3 || res_outer_loop != 0 || res_vertex1 != 3 || res_vertex2 != 3 || res_vertex3 != 3 || res_endloop != 0 || res_endfacet != 0) {
+			// name might contain spaces and it also can be empty (just "solid")
+			if (tokenizer.keyword("endsolid"))
+				tokenizer.skip_line();
+			if (tokenizer.keyword("solid"))
+				tokenizer.skip_line();
+			bool ok = tokenizer.keyword("facet") && tokenizer.keyword("normal");
+			if (ok) {
+				// The facet normal is parsed token by token as to workaround for not a numbers in the normal definition.
+				float normal[3];
+				bool  valid = true;
+				for (int j = 0; j < 3; ++ j)
+					valid &= tokenizer.number_token(normal[j]);
+				// Normal was mangled. Maybe denormals or "not a number" were stored?
+				// Just reset the normal and silently ignore it.
+				facet.normal = valid ? stl_normal(normal[0], normal[1], normal[2]) : stl_normal::Zero();
+			}
+			// "outer loop", "endloop" and "endfacet" are not enforced, as the fscanf() based loader did not enforce them either.
+			if (ok && tokenizer.keyword("outer"))
+				tokenizer.keyword("loop");
+			for (int j = 0; ok && j < 3; ++ j)
+				ok = tokenizer.keyword("vertex") && tokenizer.number(facet.vertex[j](0)) && tokenizer.number(facet.vertex[j](1)) && tokenizer.number(facet.vertex[j](2));
+			if (ok && tokenizer.keyword("endloop"))
+				tokenizer.skip_line();
+			if (ok && tokenizer.keyword("endfacet"))
+				tokenizer.skip_line();
+			if (! ok) {
 				BOOST_LOG_TRIVIAL(error) << "Something is syntactically very wrong with this ASCII STL! ";
 				return false;
 			}
-
-			// The facet normal has been parsed as a single string as to workaround for not a numbers in the normal definition.
-			if (sscanf(normal_buf[0], "%f", &facet.normal(0)) != 1 ||
-			    sscanf(normal_buf[1], "%f", &facet.normal(1)) != 1 ||
-			    sscanf(normal_buf[2], "%f", &facet.normal(2)) != 1) {
-			    // Normal was mangled. Maybe denormals or "not a number" were stored?
-			  	// Just reset the normal and silently ignore it.
-			  	memset(&facet.normal, 0, sizeof(facet.normal));
-			}
+			// Write the facet into memory.
+			stl->facet_start[i] = facet;
 		}
+		offset += end - begin;
+	}
+	if (i < stl->stats.number_of_facets) {
+		BOOST_LOG_TRIVIAL(error) << "Something is syntactically very wrong with this ASCII STL! ";
+		return false;
+	}
+	return true;
+}
+
+static bool stl_read_binary(stl_file *stl, const bip::file_mapping &mapping, int first_facet)
+{
+	// Map the file window by window, the facets are packed to SIZEOF_STL_FACET bytes in the file.
+	const size_t facets_per_window = STL_MAPPED_WINDOW_SIZE / SIZEOF_STL_FACET;
+	for (uint32_t i = first_facet; i < stl->stats.number_of_facets;) {
+		size_t num_facets = std::min<size_t>(facets_per_window, stl->stats.number_of_facets - i);
+		bip::mapped_region region(mapping, bip::read_only, bip::offset_t(HEADER_SIZE + size_t(i - first_facet) * SIZEOF_STL_FACET), num_facets * SIZEOF_STL_FACET);
+		region.advise(bip::mapped_region::advice_sequential);
+		const char *src = static_cast<const char*>(region.get_address());
+		stl_facet  *dst = stl->facet_start.data() + i;
+		tbb::parallel_for(tbb::blocked_range<size_t>(0, num_facets, STL_FACETS_PER_TASK),
+			[src, dst](const tbb::blocked_range<size_t> &range) {
+				for (size_t j = range.begin(); j < range.end(); ++ j) {
+					// We assume little-endian architecture!
+					memcpy(dst + j, src + j * SIZEOF_STL_FACET, SIZEOF_STL_FACET);
+#ifndef BOOST_LITTLE_ENDIAN
+					// Convert the loaded little endian data to big endian.
+					stl_internal_reverse_quads((char*)(dst + j), 48);
+#endif /* BOOST_LITTLE_ENDIAN */
+				}
+			});
+		i += uint32_t(num_facets);
+	}
+	return true;
+}
+
+// Update the bounding box of the facets starting with first_facet, see stl_facet_stats().
+static void stl_facets_stats(stl_file *stl, int first_facet, bool first)
+{
+	if (uint32_t(first_facet) >= stl->stats.number_of_facets)
+		return;
+	if (first) {
+		// Initialize the max and min values the first time through
+		const stl_facet &facet = stl->facet_start[first_facet];
+		stl->stats.min = facet.vertex[0];
+		stl->stats.max = facet.vertex[0];
+		stl_vertex diff = (facet.vertex[1] - facet.vertex[0]).cwiseAbs();
+		stl->stats.shortest_edge = std::max(diff(0), std::max(diff(1), diff(2)));
+	}
+	// Reduce the bounding box over chunks of facets in parallel.
+	typedef std::pair<stl_vertex, stl_vertex> MinMax;
+	const std::vector<stl_facet> &facets = stl->facet_start;
+	MinMax bbox = tbb::parallel_reduce(
+		tbb::blocked_range<size_t>(first_facet, stl->stats.number_of_facets, STL_FACETS_PER_TASK),
+		MinMax(stl->stats.min, stl->stats.max),
+		[&facets](const tbb::blocked_range<size_t> &range, const MinMax &init) {
+			// Accumulate in local variables, which the compiler keeps in registers.
+			float min[3] = { init.first(0),  init.first(1),  init.first(2) };
+			float max[3] = { init.second(0), init.second(1), init.second(2) };
+			for (size_t k = range.begin(); k < range.end(); ++ k)
+				for (size_t i = 0; i < 3; ++ i)
+					for (size_t j = 0; j < 3; ++ j) {
+						float v = facets[k].vertex[i](j);
+						min[j] = std::min(min[j], v);
+						max[j] = std::max(max[j], v);
+					}
+			return MinMax(stl_vertex(min[0], min[1], min[2]), stl_vertex(max[0], max[1], max[2]));
+		},
+		[](const MinMax &a, const MinMax &b) { return MinMax(a.first.cwiseMin(b.first), a.second.cwiseMax(b.second)); });
+	stl->stats.min = bbox.first;
+	stl->stats.max = bbox.second;
+}
+
+/* Reads the contents of the file into the stl structure, starting at facet first_facet.
+   The last argument says if it's our first time running this for the stl and therefore
+   we should reset our max and min stats. */
+static bool stl_read(stl_file *stl, const char *file, size_t file_size, int first_facet, bool first)
+{
+	try {
+		bip::file_mapping mapping(file, bip::read_only);
+		if (! (stl->stats.type == binary ? stl_read_binary(stl, mapping, first_facet) : stl_read_ascii(stl, mapping, file_size, first_facet)))
+			return false;
+	} catch (const bip::interprocess_exception &ex) {
+		BOOST_LOG_TRIVIAL(error) << "stl_read: Couldn't map " << file << " into memory: " << ex.what();
+		return false;
+	}
 
 #if 0
-		// Report close to zero vertex coordinates. Due to the nature of the floating point numbers,
-		// close to zero values may be represented with singificantly higher precision than the rest of the vertices.
-		// It may be worth to round these numbers to zero during loading to reduce the number of errors reported
-		// during the STL import.
+	// Report close to zero vertex coordinates. Due to the nature of the floating point numbers,
+	// close to zero values may be represented with singificantly higher precision than the rest of the vertices.
+	// It may be worth to round these numbers to zero during loading to reduce the number of errors reported
+	// during the STL import.
+	for (uint32_t i = first_facet; i < stl->stats.number_of_facets; ++ i) {
+		const stl_facet &facet = stl->facet_start[i];
 		for (size_t j = 0; j < 3; ++ j) {
 		if (facet.vertex[j](0) > -1e-12f && facet.vertex[j](0) < 1e-12f)
 		    printf("stl_read: facet %d(0) = %e\r\n", j, facet.vertex[j](0));
@@ -207,13 +395,10 @@ static bool stl_read(stl_file *stl, FILE *fp, int first_facet, bool first)
 		if (facet.vertex[j](2) > -1e-12f && facet.vertex[j](2) < 1e-12f)
 		    printf("stl_read: facet %d(2) = %e\r\n", j, facet.vertex[j](2));
 		}
+	}
 #endif
 
-		// Write the facet into memory.
-		stl->facet_start[i] = facet;
-		stl_facet_stats(stl, facet, first);
-  	}
-  
+	stl_facets_stats(stl, first_facet, first);
   	stl->stats.size = stl->stats.max - stl->stats.min;
   	stl->stats.bounding_diameter = stl->stats.size.norm();
   	return true;
@@ -222,13 +407,14 @@ static bool stl_read(stl_file *stl, FILE *fp, int first_facet, bool first)
 bool stl_open(stl_file *stl, const char *file)
 {
 	stl->clear();
-	FILE *fp = stl_open_count_facets(stl, file);
+	size_t file_size = 0;
+	FILE *fp = stl_open_count_facets(stl, file, file_size);
 	if (fp == nullptr)
 		return false;
+	// The facets are read from the file mapped into memory.
+	fclose(fp);
 	stl_allocate(stl);
-	bool result = stl_read(stl, fp, 0, true);
-  	fclose(fp);
-  	return result;
+	return stl_read(stl, file, file_size, 0, true);
 }
 
 #ifndef BOOST_LITTLE_ENDIAN
@@ -119,6 +119,7 @@ PolyTreeToExPolygons(ClipperLib::PolyTree& polytree)
 Slic3r::Polygon ClipperPath_to_Slic3rPolygon(const ClipperLib::Path &input)
 {
     Polygon retval;
+    retval.points.reserve(input.size());
     for (ClipperLib::Path::const_iterator pit = input.begin(); pit != input.end(); ++pit)
         retval.points.emplace_back(pit->X, pit->Y);
     return retval;
@@ -127,6 +128,7 @@ Slic3r::Polygon ClipperPath_to_Slic3rPolygon(const ClipperLib::Path &input)
 Slic3r::Polyline ClipperPath_to_Slic3rPolyline(const ClipperLib::Path &input)
 {
     Polyline retval;
+    retval.points.reserve(input.size());
     for (ClipperLib::Path::const_iterator pit = input.begin(); pit != input.end(); ++pit)
         retval.points.emplace_back(pit->X, pit->Y);
     return retval;
@@ -170,24 +172,16 @@ ClipperLib::Path
 Slic3rMultiPoint_to_ClipperPath(const MultiPoint &input)
 {
     ClipperLib::Path retval;
+    retval.reserve(input.points.size());
     for (Points::const_iterator pit = input.points.begin(); pit != input.points.end(); ++pit)
         retval.emplace_back((*pit)(0), (*pit)(1));
     return retval;
 }
 
-ClipperLib::Path
-Slic3rMultiPoint_to_ClipperPath_reversed(const Slic3r::MultiPoint &input)
-{
-    ClipperLib::Path output;
-    output.reserve(input.points.size());
-    for (Slic3r::Points::const_reverse_iterator pit = input.points.rbegin(); pit != input.points.rend(); ++pit)
-        output.emplace_back((*pit)(0), (*pit)(1));
-    return output;
-}
-
 ClipperLib::Paths Slic3rMultiPoints_to_ClipperPaths(const Polygons &input)
 {
     ClipperLib::Paths retval;
+    retval.reserve(input.size());
     for (Polygons::const_iterator it = input.begin(); it != input.end(); ++it)
         retval.emplace_back(Slic3rMultiPoint_to_ClipperPath(*it));
     return retval;
@@ -196,16 +190,74 @@ ClipperLib::Paths Slic3rMultiPoints_to_ClipperPaths(const Polygons &input)
 ClipperLib::Paths Slic3rMultiPoints_to_ClipperPaths(const Polylines &input)
 {
     ClipperLib::Paths retval;
+    retval.reserve(input.size());
     for (Polylines::const_iterator it = input.begin(); it != input.end(); ++it)
         retval.emplace_back(Slic3rMultiPoint_to_ClipperPath(*it));
     return retval;
 }
 
-ClipperLib::Paths _offset(ClipperLib::Paths &&input, ClipperLib::EndType endType, const float delta, ClipperLib::JoinType joinType, double miterLimit)
+ClipperLib::Paths Slic3rMultiPoints_to_ClipperPaths(const PolygonSet &input)
+{
+    ClipperLib::Paths retval;
+    retval.reserve(input.num_polygons());
+    for (size_t i = 0; i < input.num_polygons(); ++ i) {
+        PolygonSet::PolygonView polygon = input.polygon(i);
+        retval.emplace_back();
+        ClipperLib::Path &path = retval.back();
+        path.reserve(polygon.size());
+        for (const Point &pt : polygon)
+            path.emplace_back(pt(0), pt(1));
+    }
+    return retval;
+}
+
+// Convert the points to a ClipperLib::Path scaled by CLIPPER_OFFSET_SCALE, as expected by the offset functions,
+// in a single pass. If reversed, the points are converted from the back, as needed for offsetting the holes.
+static ClipperLib::Path Slic3rPoints_to_ClipperPath_scaled(const Point *begin, const Point *end, bool reversed = false)
+{
+    ClipperLib::Path retval;
+    retval.reserve(end - begin);
+    if (reversed) {
+        for (const Point *pt = end; pt != begin;) {
+            -- pt;
+            retval.emplace_back(ClipperLib::cInt((*pt)(0)) << CLIPPER_OFFSET_POWER_OF_2, ClipperLib::cInt((*pt)(1)) << CLIPPER_OFFSET_POWER_OF_2);
+        }
+    } else {
+        for (const Point *pt = begin; pt != end; ++ pt)
+            retval.emplace_back(ClipperLib::cInt((*pt)(0)) << CLIPPER_OFFSET_POWER_OF_2, ClipperLib::cInt((*pt)(1)) << CLIPPER_OFFSET_POWER_OF_2);
+    }
+    return retval;
+}
+
+static inline ClipperLib::Path Slic3rPoints_to_ClipperPath_scaled(const Points &points, bool reversed = false)
+{
+    return Slic3rPoints_to_ClipperPath_scaled(points.data(), points.data() + points.size(), reversed);
+}
+
+template<typename MultiPointType>
+static ClipperLib::Paths Slic3rMultiPoints_to_ClipperPaths_scaled(const std::vector<MultiPointType> &input)
+{
+    ClipperLib::Paths retval;
+    retval.reserve(input.size());
+    for (const MultiPointType &mp : input)
+        retval.emplace_back(Slic3rPoints_to_ClipperPath_scaled(mp.points));
+    return retval;
+}
+
+static ClipperLib::Paths Slic3rMultiPoints_to_ClipperPaths_scaled(const PolygonSet &input)
+{
+    ClipperLib::Paths retval;
+    retval.reserve(input.num_polygons());
+    for (size_t i = 0; i < input.num_polygons(); ++ i) {
+        PolygonSet::PolygonView polygon = input.polygon(i);
+        retval.emplace_back(Slic3rPoints_to_ClipperPath_scaled(polygon.begin(), polygon.end()));
+    }
+    return retval;
+}
+
+// input_scaled: scaled by CLIPPER_OFFSET_SCALE.
+static ClipperLib::Paths _offset_scaled(const ClipperLib::Paths &input_scaled, ClipperLib::EndType endType, const float delta, ClipperLib::JoinType joinType, double miterLimit)
 {
-    // scale input
-    scaleClipperPolygons(input);
-    
     // perform offset
     ClipperLib::ClipperOffset co;
     if (joinType == jtRound)
@@ -214,7 +266,7 @@ ClipperLib::Paths _offset(ClipperLib::Paths &&input, ClipperLib::EndType endType
         co.MiterLimit = miterLimit;
     float delta_scaled = delta * float(CLIPPER_OFFSET_SCALE);
     co.ShortestEdgeLength = double(std::abs(delta_scaled * CLIPPER_OFFSET_SHORTEST_EDGE_FACTOR));
-    co.AddPaths(input, joinType, endType);
+    co.AddPaths(input_scaled, joinType, endType);
     ClipperLib::Paths retval;
     co.Execute(retval, delta_scaled);
     
@@ -223,6 +275,33 @@ ClipperLib::Paths _offset(ClipperLib::Paths &&input, ClipperLib::EndType endType
     return retval;
 }
 
+ClipperLib::Paths _offset(ClipperLib::Paths &&input, ClipperLib::EndType endType, const float delta, ClipperLib::JoinType joinType, double miterLimit)
+{
+    // scale input
+    scaleClipperPolygons(input);
+    return _offset_scaled(input, endType, delta, joinType, miterLimit);
+}
+
+ClipperLib::Paths _offset(const Slic3r::Points &input, ClipperLib::EndType endType, const float delta, ClipperLib::JoinType joinType, double miterLimit)
+{
+    return _offset_scaled(ClipperLib::Paths { Slic3rPoints_to_ClipperPath_scaled(input) }, endType, delta, joinType, miterLimit);
+}
+
+ClipperLib::Paths _offset(const Slic3r::Polygons &input, ClipperLib::EndType endType, const float delta, ClipperLib::JoinType joinType, double miterLimit)
+{
+    return _offset_scaled(Slic3rMultiPoints_to_ClipperPaths_scaled(input), endType, delta, joinType, miterLimit);
+}
+
+ClipperLib::Paths _offset(const Slic3r::Polylines &input, ClipperLib::EndType endType, const float delta, ClipperLib::JoinType joinType, double miterLimit)
+{
+    return _offset_scaled(Slic3rMultiPoints_to_ClipperPaths_scaled(input), endType, delta, joinType, miterLimit);
+}
+
+ClipperLib::Paths _offset(const Slic3r::PolygonSet &input, ClipperLib::EndType endType, const float delta, ClipperLib::JoinType joinType, double miterLimit)
+{
+    return _offset_scaled(Slic3rMultiPoints_to_ClipperPaths_scaled(input), endType, delta, joinType, miterLimit);
+}
+
 ClipperLib::Paths _offset(ClipperLib::Path &&input, ClipperLib::EndType endType, const float delta, ClipperLib::JoinType joinType, double miterLimit)
 {
     ClipperLib::Paths paths;
@@ -241,15 +320,13 @@ ClipperLib::Paths _offset(const Slic3r::ExPolygon &expolygon, const float delta,
     const float delta_scaled = delta * float(CLIPPER_OFFSET_SCALE);
     ClipperLib::Paths contours;
     {
-        ClipperLib::Path input = Slic3rMultiPoint_to_ClipperPath(expolygon.contour);
-        scaleClipperPolygon(input);
         ClipperLib::ClipperOffset co;
         if (joinType == jtRound)
             co.ArcTolerance = miterLimit * double(CLIPPER_OFFSET_SCALE);
         else
             co.MiterLimit = miterLimit;
         co.ShortestEdgeLength = double(std::abs(delta_scaled * CLIPPER_OFFSET_SHORTEST_EDGE_FACTOR));
-        co.AddPath(input, joinType, ClipperLib::etClosedPolygon);
+        co.AddPath(Slic3rPoints_to_ClipperPath_scaled(expolygon.contour.points), joinType, ClipperLib::etClosedPolygon);
         co.Execute(contours, delta_scaled);
     }
 
@@ -258,18 +335,16 @@ ClipperLib::Paths _offset(const Slic3r::ExPolygon &expolygon, const float delta,
     {
         holes.reserve(expolygon.holes.size());
         for (Polygons::const_iterator it_hole = expolygon.holes.begin(); it_hole != expolygon.holes.end(); ++ it_hole) {
-            ClipperLib::Path input = Slic3rMultiPoint_to_ClipperPath_reversed(*it_hole);
-            scaleClipperPolygon(input);
             ClipperLib::ClipperOffset co;
             if (joinType == jtRound)
                 co.ArcTolerance = miterLimit * double(CLIPPER_OFFSET_SCALE);
             else
                 co.MiterLimit = miterLimit;
             co.ShortestEdgeLength = double(std::abs(delta_scaled * CLIPPER_OFFSET_SHORTEST_EDGE_FACTOR));
-            co.AddPath(input, joinType, ClipperLib::etClosedPolygon);
+            co.AddPath(Slic3rPoints_to_ClipperPath_scaled(it_hole->points, true), joinType, ClipperLib::etClosedPolygon);
             ClipperLib::Paths out;
             co.Execute(out, - delta_scaled);
-            holes.insert(holes.end(), out.begin(), out.end());
+            std::move(out.begin(), out.end(), std::back_inserter(holes));
         }
     }
 
@@ -307,15 +382,13 @@ ClipperLib::Paths _offset(const Slic3r::ExPolygons &expolygons, const float delt
         // 1) Offset the outer contour.
         ClipperLib::Paths contours;
         {
-            ClipperLib::Path input = Slic3rMultiPoint_to_ClipperPath(it_expoly->contour);
-            scaleClipperPolygon(input);
             ClipperLib::ClipperOffset co;
             if (joinType == jtRound)
                 co.ArcTolerance = miterLimit * double(CLIPPER_OFFSET_SCALE);
             else
                 co.MiterLimit = miterLimit;
             co.ShortestEdgeLength = double(std::abs(delta_scaled * CLIPPER_OFFSET_SHORTEST_EDGE_FACTOR));
-            co.AddPath(input, joinType, ClipperLib::etClosedPolygon);
+            co.AddPath(Slic3rPoints_to_ClipperPath_scaled(it_expoly->contour.points), joinType, ClipperLib::etClosedPolygon);
             co.Execute(contours, delta_scaled);
         }
         if (contours.empty())
@@ -324,32 +397,30 @@ ClipperLib::Paths _offset(const Slic3r::ExPolygons &expolygons, const float delt
 
         if (it_expoly->holes.empty()) {
             // No need to subtract holes from the offsetted expolygon, we are done.
-            contours_cummulative.insert(contours_cummulative.end(), contours.begin(), contours.end());
+            std::move(contours.begin(), contours.end(), std::back_inserter(contours_cummulative));
             ++ expolygons_collected;
         } else {
             // 2) Offset the holes one by one, collect the offsetted holes.
             ClipperLib::Paths holes;
             {
                 for (Polygons::const_iterator it_hole = it_expoly->holes.begin(); it_hole != it_expoly->holes.end(); ++ it_hole) {
-                    ClipperLib::Path input = Slic3rMultiPoint_to_ClipperPath_reversed(*it_hole);
-                    scaleClipperPolygon(input);
                     ClipperLib::ClipperOffset co;
                     if (joinType == jtRound)
                         co.ArcTolerance = miterLimit * double(CLIPPER_OFFSET_SCALE);
                     else
                         co.MiterLimit = miterLimit;
                     co.ShortestEdgeLength = double(std::abs(delta_scaled * CLIPPER_OFFSET_SHORTEST_EDGE_FACTOR));
-                    co.AddPath(input, joinType, ClipperLib::etClosedPolygon);
+                    co.AddPath(Slic3rPoints_to_ClipperPath_scaled(it_hole->points, true), joinType, ClipperLib::etClosedPolygon);
                     ClipperLib::Paths out;
                     co.Execute(out, - delta_scaled);
-                    holes.insert(holes.end(), out.begin(), out.end());
+                    std::move(out.begin(), out.end(), std::back_inserter(holes));
                 }
             }
 
             // 3) Subtract holes from the contours.
             if (holes.empty()) {
                 // No hole remaining after an offset. Just copy the outer contour.
-                contours_cummulative.insert(contours_cummulative.end(), contours.begin(), contours.end());
+                std::move(contours.begin(), contours.end(), std::back_inserter(contours_cummulative));
                 ++ expolygons_collected;
             } else if (delta < 0) {
                 // Negative offset. There is a chance, that the offsetted hole intersects the outer contour. 
@@ -361,7 +432,7 @@ ClipperLib::Paths _offset(const Slic3r::ExPolygons &expolygons, const float delt
                 ClipperLib::Paths output;
                 clipper.Execute(ClipperLib::ctDifference, output, ClipperLib::pftNonZero, ClipperLib::pftNonZero);
                 if (! output.empty()) {
-                    contours_cummulative.insert(contours_cummulative.end(), output.begin(), output.end());
+                    std::move(output.begin(), output.end(), std::back_inserter(contours_cummulative));
                     ++ expolygons_collected;
                 } else {
                     // The offsetted holes have eaten up the offsetted outer contour.
@@ -371,11 +442,11 @@ ClipperLib::Paths _offset(const Slic3r::ExPolygons &expolygons, const float delt
                 // area than the original hole or even disappear, therefore there will be no new intersections.
                 // Just collect the reversed holes.
                 contours_cummulative.reserve(contours.size() + holes.size());
-                contours_cummulative.insert(contours_cummulative.end(), contours.begin(), contours.end());
+                std::move(contours.begin(), contours.end(), std::back_inserter(contours_cummulative));
                 // Reverse the holes in place.
                 for (size_t i = 0; i < holes.size(); ++ i)
                     std::reverse(holes[i].begin(), holes[i].end());
-                contours_cummulative.insert(contours_cummulative.end(), holes.begin(), holes.end());
+                std::move(holes.begin(), holes.end(), std::back_inserter(contours_cummulative));
                 ++ expolygons_collected;
             }
         }
@@ -403,12 +474,6 @@ ClipperLib::Paths
 _offset2(const Polygons &polygons, const float delta1, const float delta2,
     const ClipperLib::JoinType joinType, const double miterLimit)
 {
-    // read input
-    ClipperLib::Paths input = Slic3rMultiPoints_to_ClipperPaths(polygons);
-    
-    // scale input
-    scaleClipperPolygons(input);
-    
     // prepare ClipperOffset object
     ClipperLib::ClipperOffset co;
     if (joinType == jtRound) {
@@ -422,7 +487,7 @@ _offset2(const Polygons &polygons, const float delta1, const float delta2,
     
     // perform first offset
     ClipperLib::Paths output1;
-    co.AddPaths(input, joinType, ClipperLib::etClosedPolygon);
+    co.AddPaths(Slic3rMultiPoints_to_ClipperPaths_scaled(polygons), joinType, ClipperLib::etClosedPolygon);
     co.Execute(output1, delta_scaled1);
     
     // perform second offset
@@ -471,31 +536,28 @@ ExPolygons offset2_ex(const ExPolygons &expolygons, const float delta1,
     return union_ex(polys);
 }
 
-template <class T>
+// Add the Slic3r polygons to the Clipper, safety offsetted if requested.
+template <class TInput>
+static void _clipper_add_paths(ClipperLib::Clipper &clipper, const TInput &input, ClipperLib::PolyType polyType, bool closed, bool safety_offset_)
+{
+    ClipperLib::Paths paths = Slic3rMultiPoints_to_ClipperPaths(input);
+    if (safety_offset_)
+        safety_offset(&paths);
+    clipper.AddPaths(paths, polyType, closed);
+}
+
+template <class T, class TSubject, class TClip>
 T
-_clipper_do(const ClipperLib::ClipType clipType, const Polygons &subject, 
-    const Polygons &clip, const ClipperLib::PolyFillType fillType, const bool safety_offset_)
+_clipper_do(const ClipperLib::ClipType clipType, const TSubject &subject, 
+    const TClip &clip, const ClipperLib::PolyFillType fillType, const bool safety_offset_)
 {
-    // read input
-    ClipperLib::Paths input_subject = Slic3rMultiPoints_to_ClipperPaths(subject);
-    ClipperLib::Paths input_clip    = Slic3rMultiPoints_to_ClipperPaths(clip);
-    
-    // perform safety offset
-    if (safety_offset_) {
-        if (clipType == ClipperLib::ctUnion) {
-            safety_offset(&input_subject);
-        } else {
-            safety_offset(&input_clip);
-        }
-    }
-    
     // init Clipper
     ClipperLib::Clipper clipper;
     clipper.Clear();
     
-    // add polygons
-    clipper.AddPaths(input_subject, ClipperLib::ptSubject, true);
-    clipper.AddPaths(input_clip,    ClipperLib::ptClip,    true);
+    // add polygons, perform safety offset
+    _clipper_add_paths(clipper, subject, ClipperLib::ptSubject, true, safety_offset_ && clipType == ClipperLib::ctUnion);
+    _clipper_add_paths(clipper, clip,    ClipperLib::ptClip,    true, safety_offset_ && clipType != ClipperLib::ctUnion);
     
     // perform operation
     T retval;
@@ -510,27 +572,22 @@ _clipper_do(const ClipperLib::ClipType clipType, const Polygons &subject,
 // This function implmenets a following workaround:
 // 1) Peform the Clipper operation with the output to Paths. This method handles overlaps in a reasonable time.
 // 2) Run Clipper Union once again to extract the PolyTree from the result of 1).
-inline ClipperLib::PolyTree _clipper_do_polytree2(const ClipperLib::ClipType clipType, const Polygons &subject, 
-    const Polygons &clip, const ClipperLib::PolyFillType fillType, const bool safety_offset_)
+template <class TSubject, class TClip>
+inline ClipperLib::PolyTree _clipper_do_polytree2(const ClipperLib::ClipType clipType, const TSubject &subject, 
+    const TClip &clip, const ClipperLib::PolyFillType fillType, const bool safety_offset_)
 {
-    // read input
-    ClipperLib::Paths input_subject = Slic3rMultiPoints_to_ClipperPaths(subject);
-    ClipperLib::Paths input_clip    = Slic3rMultiPoints_to_ClipperPaths(clip);
-    
-    // perform safety offset
-    if (safety_offset_)
-        safety_offset((clipType == ClipperLib::ctUnion) ? &input_subject : &input_clip);
-    
+    // add polygons, perform safety offset
     ClipperLib::Clipper clipper;
-    clipper.AddPaths(input_subject, ClipperLib::ptSubject, true);
-    clipper.AddPaths(input_clip,    ClipperLib::ptClip,    true);
-    // Perform the operation with the output to input_subject.
+    _clipper_add_paths(clipper, subject, ClipperLib::ptSubject, true, safety_offset_ && clipType == ClipperLib::ctUnion);
+    _clipper_add_paths(clipper, clip,    ClipperLib::ptClip,    true, safety_offset_ && clipType != ClipperLib::ctUnion);
+    // Perform the operation with the output to paths.
     // This pass does not generate a PolyTree, which is a very expensive operation with the current Clipper library
     // if there are overapping edges.
-    clipper.Execute(clipType, input_subject, fillType, fillType);
+    ClipperLib::Paths paths;
+    clipper.Execute(clipType, paths, fillType, fillType);
     // Perform an additional Union operation to generate the PolyTree ordering.
     clipper.Clear();
-    clipper.AddPaths(input_subject, ClipperLib::ptSubject, true);
+    clipper.AddPaths(paths, ClipperLib::ptSubject, true);
     ClipperLib::PolyTree retval;
     clipper.Execute(ClipperLib::ctUnion, retval, fillType, fillType);
     return retval;
@@ -540,20 +597,13 @@ ClipperLib::PolyTree _clipper_do_pl(const ClipperLib::ClipType clipType, const P
     const Polygons &clip, const ClipperLib::PolyFillType fillType,
     const bool safety_offset_)
 {
-    // read input
-    ClipperLib::Paths input_subject = Slic3rMultiPoints_to_ClipperPaths(subject);
-    ClipperLib::Paths input_clip    = Slic3rMultiPoints_to_ClipperPaths(clip);
-    
-    // perform safety offset
-    if (safety_offset_) safety_offset(&input_clip);
-    
     // init Clipper
     ClipperLib::Clipper clipper;
     clipper.Clear();
     
-    // add polygons
-    clipper.AddPaths(input_subject, ClipperLib::ptSubject, false);
-    clipper.AddPaths(input_clip,    ClipperLib::ptClip,    true);
+    // add polygons, perform safety offset
+    clipper.AddPaths(Slic3rMultiPoints_to_ClipperPaths(subject), ClipperLib::ptSubject, false);
+    _clipper_add_paths(clipper, clip, ClipperLib::ptClip, true, safety_offset_);
     
     // perform operation
     ClipperLib::PolyTree retval;
@@ -572,6 +622,28 @@ ExPolygons _clipper_ex(ClipperLib::ClipType clipType, const Polygons &subject, c
     return PolyTreeToExPolygons(polytree);
 }
 
+Polygons _clipper(ClipperLib::ClipType clipType, const PolygonSet &subject, const Polygons &clip, bool safety_offset_)
+{
+    return ClipperPaths_to_Slic3rPolygons(_clipper_do<ClipperLib::Paths>(clipType, subject, clip, ClipperLib::pftNonZero, safety_offset_));
+}
+
+Polygons _clipper(ClipperLib::ClipType clipType, const Polygons &subject, const PolygonSet &clip, bool safety_offset_)
+{
+    return ClipperPaths_to_Slic3rPolygons(_clipper_do<ClipperLib::Paths>(clipType, subject, clip, ClipperLib::pftNonZero, safety_offset_));
+}
+
+ExPolygons _clipper_ex(ClipperLib::ClipType clipType, const PolygonSet &subject, const Polygons &clip, bool safety_offset_)
+{
+    ClipperLib::PolyTree polytree = _clipper_do_polytree2(clipType, subject, clip, ClipperLib::pftNonZero, safety_offset_);
+    return PolyTreeToExPolygons(polytree);
+}
+
+ExPolygons _clipper_ex(ClipperLib::ClipType clipType, const Polygons &subject, const PolygonSet &clip, bool safety_offset_)
+{
+    ClipperLib::PolyTree polytree = _clipper_do_polytree2(clipType, subject, clip, ClipperLib::pftNonZero, safety_offset_);
+    return PolyTreeToExPolygons(polytree);
+}
+
 Polylines _clipper_pl(ClipperLib::ClipType clipType, const Polylines &subject, const Polygons &clip, bool safety_offset_)
 {
     ClipperLib::Paths output;
@@ -714,15 +786,12 @@ ExPolygons simplify_polygons_ex(const Polygons &subject, bool preserve_collinear
     if (! preserve_collinear)
         return union_ex(simplify_polygons(subject, false));
 
-    // convert into Clipper polygons
-    ClipperLib::Paths input_subject = Slic3rMultiPoints_to_ClipperPaths(subject);
-    
     ClipperLib::PolyTree polytree;
     
     ClipperLib::Clipper c;
     c.PreserveCollinear(true);
     c.StrictlySimple(true);
-    c.AddPaths(input_subject, ClipperLib::ptSubject, true);
+    c.AddPaths(Slic3rMultiPoints_to_ClipperPaths(subject), ClipperLib::ptSubject, true);
     c.Execute(ClipperLib::ctUnion, polytree, ClipperLib::pftNonZero, ClipperLib::pftNonZero);
     
     // convert into ExPolygons
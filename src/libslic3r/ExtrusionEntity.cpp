@@ -4,12 +4,117 @@
 #include "ClipperUtils.hpp"
 #include "Extruder.hpp"
 #include "Flow.hpp"
+#include <algorithm>
+#include <atomic>
 #include <cmath>
 #include <limits>
 #include <sstream>
 
+#include <tbb/spin_mutex.h>
+
 namespace Slic3r {
-    
+
+static const size_t extrusion_entity_arena_chunk_size = 65536;
+
+struct ExtrusionEntityArena::Data
+{
+    // References held by the arena and by each of its entities alive.
+    std::atomic<size_t>                     num_references { 1 };
+    size_t                                  memory_reserved = 0;
+    tbb::spin_mutex                         mutex;
+    std::vector<char*>                      chunks;
+    // Unused part of the last chunk.
+    char                                   *chunk_begin = nullptr;
+    char                                   *chunk_end   = nullptr;
+    // Blocks of the deleted entities by the block size, linked through their first pointer.
+    std::vector<std::pair<size_t, void*>>   free_blocks;
+
+    ~Data() { for (char *chunk : chunks) ::operator delete(chunk); }
+
+    void* allocate(size_t size)
+    {
+        tbb::spin_mutex::scoped_lock lock(this->mutex);
+        ++ this->num_references;
+        for (std::pair<size_t, void*> &free_list : this->free_blocks)
+            if (free_list.first == size && free_list.second != nullptr) {
+                void *block = free_list.second;
+                free_list.second = *reinterpret_cast<void**>(block);
+                return block;
+            }
+        if (size_t(this->chunk_end - this->chunk_begin) < size) {
+            size_t new_chunk_size = std::max(extrusion_entity_arena_chunk_size, size);
+            this->chunks.emplace_back(static_cast<char*>(::operator new(new_chunk_size)));
+            this->memory_reserved += new_chunk_size;
+            this->chunk_begin = this->chunks.back();
+            this->chunk_end   = this->chunk_begin + new_chunk_size;
+        }
+        void *block = this->chunk_begin;
+        this->chunk_begin += size;
+        return block;
+    }
+
+    void deallocate(void *block, size_t size)
+    {
+        {
+            tbb::spin_mutex::scoped_lock lock(this->mutex);
+            auto it = std::find_if(this->free_blocks.begin(), this->free_blocks.end(), [size](const std::pair<size_t, void*> &l) { return l.first == size; });
+            if (it == this->free_blocks.end())
+                it = this->free_blocks.emplace(this->free_blocks.end(), size, nullptr);
+            *reinterpret_cast<void**>(block) = it->second;
+            it->second = block;
+        }
+        this->release();
+    }
+
+    void release() { if (-- this->num_references == 0) delete this; }
+};
+
+// Arena of the calling thread, see ExtrusionEntityArena::Scope.
+static thread_local ExtrusionEntityArena::Data *s_active_arena = nullptr;
+
+ExtrusionEntityArena::ExtrusionEntityArena() : m_data(new Data) {}
+ExtrusionEntityArena::~ExtrusionEntityArena() { m_data->release(); }
+size_t ExtrusionEntityArena::num_entities() const { return m_data->num_references - 1; }
+size_t ExtrusionEntityArena::memory_reserved() const
+{
+    tbb::spin_mutex::scoped_lock lock(m_data->mutex);
+    return m_data->memory_reserved;
+}
+
+ExtrusionEntityArena::Scope::Scope(ExtrusionEntityArena &arena) : m_previous(s_active_arena) { s_active_arena = arena.m_data; }
+ExtrusionEntityArena::Scope::~Scope() { s_active_arena = m_previous; }
+
+// Each extrusion entity is preceded by a header pointing to the arena it was allocated from, or nullptr if it was allocated from the heap.
+// The header keeps the entities 8 bytes aligned, which is sufficient for all of them.
+static const size_t extrusion_entity_header_size = sizeof(void*);
+static_assert(alignof(ExtrusionPath) <= 8 && alignof(ExtrusionMultiPath) <= 8 && alignof(ExtrusionLoop) <= 8 && alignof(ExtrusionEntityCollection) <= 8,
+    "Extrusion entities are allocated with 8 bytes alignment");
+
+static inline size_t extrusion_entity_block_size(size_t size)
+{
+    return (size + extrusion_entity_header_size + 7) & ~size_t(7);
+}
+
+void* ExtrusionEntity::operator new(size_t size)
+{
+    ExtrusionEntityArena::Data *arena = s_active_arena;
+    void *block = (arena == nullptr) ? ::operator new(extrusion_entity_block_size(size)) : arena->allocate(extrusion_entity_block_size(size));
+    *reinterpret_cast<ExtrusionEntityArena::Data**>(block) = arena;
+    return static_cast<char*>(block) + extrusion_entity_header_size;
+}
+
+void ExtrusionEntity::operator delete(void *ptr, size_t size)
+{
+    if (ptr == nullptr)
+        return;
+    void *block = static_cast<char*>(ptr) - extrusion_entity_header_size;
+    ExtrusionEntityArena::Data *arena = *reinterpret_cast<ExtrusionEntityArena::Data**>(block);
+    if (arena == nullptr)
+        ::operator delete(block);
+    else
+        arena->deallocate(block, extrusion_entity_block_size(size));
+}
+
 void
 ExtrusionPath::intersect_expolygons(const ExPolygonCollection &collection, ExtrusionEntityCollection* retval) const
 {
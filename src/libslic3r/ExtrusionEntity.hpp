@@ -66,9 +66,51 @@ enum ExtrusionLoopRole {
     elrSkirt,
 };
 
+// Memory arena of the extrusion entities of a layer.
+// A print produces millions of small extrusion entities. While an arena is activated for a thread by ExtrusionEntityArena::Scope,
+// the extrusion entities created by the thread are allocated from large memory chunks of the arena instead of one by one from the heap.
+// The entities are still owned and deleted by their collections. The memory of a deleted entity is kept by the arena for reuse,
+// all the chunks are released at once when both the arena and all of its entities are destroyed.
+class ExtrusionEntityArena
+{
+public:
+    // Shared by the arena and by its entities, released by the last one of them.
+    struct Data;
+
+    ExtrusionEntityArena();
+    ~ExtrusionEntityArena();
+    ExtrusionEntityArena(const ExtrusionEntityArena &) = delete;
+    ExtrusionEntityArena& operator=(const ExtrusionEntityArena &) = delete;
+
+    // Number of the entities allocated from this arena and not deleted yet.
+    size_t  num_entities() const;
+    // Memory of the chunks allocated by this arena, in bytes.
+    size_t  memory_reserved() const;
+
+    // Allocates the extrusion entities created by the calling thread from the arena for the life time of the Scope.
+    // The scopes may be nested, the previous arena is restored by the destructor.
+    class Scope
+    {
+    public:
+        explicit Scope(ExtrusionEntityArena &arena);
+        ~Scope();
+        Scope(const Scope &) = delete;
+        Scope& operator=(const Scope &) = delete;
+    private:
+        Data *m_previous;
+    };
+
+private:
+    Data   *m_data;
+};
+
 class ExtrusionEntity
 {
 public:
+    // Allocated from the arena active on the calling thread, see ExtrusionEntityArena::Scope, or from the heap.
+    static void* operator new(size_t size);
+    static void  operator delete(void *ptr, size_t size);
+
     virtual ExtrusionRole role() const = 0;
     virtual bool is_collection() const { return false; }
     virtual bool is_loop() const { return false; }
@@ -1,4 +1,5 @@
 #include "ExtrusionEntityCollection.hpp"
+#include "ShortestPath.hpp"
 #include <algorithm>
 #include <cmath>
 #include <map>
@@ -49,10 +50,8 @@ ExtrusionEntityCollection::operator ExtrusionPaths() const
 ExtrusionEntityCollection*
 ExtrusionEntityCollection::clone() const
 {
-    ExtrusionEntityCollection* coll = new ExtrusionEntityCollection(*this);
-    for (size_t i = 0; i < coll->entities.size(); ++i)
-        coll->entities[i] = this->entities[i]->clone();
-    return coll;
+    // The copy constructor clones the entities.
+    return new ExtrusionEntityCollection(*this);
 }
 
 void
@@ -111,10 +110,9 @@ void ExtrusionEntityCollection::chained_path_from(Point start_near, ExtrusionEnt
     retval->entities.reserve(this->entities.size());
     retval->orig_indices.reserve(this->entities.size());
     
-    // if we're asked to return the original indices, build a map
-    std::map<ExtrusionEntity*,size_t> indices_map;
-    
     ExtrusionEntitiesPtr my_paths;
+    // Indices of my_paths in this->entities.
+    std::vector<size_t>  my_indices;
     for (ExtrusionEntitiesPtr::const_iterator it = this->entities.begin(); it != this->entities.end(); ++it) {
         if (role != erMixed) {
             // The caller wants only paths with a specific extrusion role.
@@ -126,35 +124,28 @@ void ExtrusionEntityCollection::chained_path_from(Point start_near, ExtrusionEnt
             }
         }
 
-        ExtrusionEntity* entity = (*it)->clone();
-        my_paths.push_back(entity);
-        if (orig_indices != NULL) indices_map[entity] = it - this->entities.begin();
+        my_paths.push_back((*it)->clone());
+        my_indices.push_back(it - this->entities.begin());
     }
     
-    Points endpoints;
-    for (ExtrusionEntitiesPtr::iterator it = my_paths.begin(); it != my_paths.end(); ++it) {
-        endpoints.push_back((*it)->first_point());
-        if (no_reverse || !(*it)->can_reverse()) {
-            endpoints.push_back((*it)->first_point());
-        } else {
-            endpoints.push_back((*it)->last_point());
-        }
+    Points            endpoints;
+    // never reverse loops, since it's pointless for chained path and callers might depend on orientation
+    std::vector<bool> reversible;
+    endpoints.reserve(my_paths.size() * 2);
+    reversible.reserve(my_paths.size());
+    for (const ExtrusionEntity *entity : my_paths) {
+        endpoints.push_back(entity->first_point());
+        endpoints.push_back(entity->last_point());
+        reversible.push_back(entity->can_reverse());
     }
     
-    while (!my_paths.empty()) {
-        // find nearest point
-        int start_index = start_near.nearest_point_index(endpoints);
-        int path_index = start_index/2;
-        ExtrusionEntity* entity = my_paths.at(path_index);
-        // never reverse loops, since it's pointless for chained path and callers might depend on orientation
-        if (start_index % 2 && !no_reverse && entity->can_reverse()) {
+    // Ties are resolved the same way as Point::nearest_point_index() does.
+    for (const std::pair<size_t, bool> &idx : chain_segments(endpoints, start_near, ! no_reverse, &reversible, ctbHighestIndex)) {
+        ExtrusionEntity *entity = my_paths[idx.first];
+        if (idx.second)
             entity->reverse();
-        }
-        retval->entities.push_back(my_paths.at(path_index));
-        if (orig_indices != NULL) orig_indices->push_back(indices_map[entity]);
-        my_paths.erase(my_paths.begin() + path_index);
-        endpoints.erase(endpoints.begin() + 2*path_index, endpoints.begin() + 2*path_index + 2);
-        start_near = retval->entities.back()->last_point();
+        retval->entities.push_back(entity);
+        if (orig_indices != NULL) orig_indices->push_back(my_indices[idx.first]);
     }
 }
 
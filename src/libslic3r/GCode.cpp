@@ -6,6 +6,7 @@
 #include "Geometry.hpp"
 #include "GCode/PrintExtents.hpp"
 #include "GCode/WipeTower.hpp"
+#include "Profiler.hpp"
 #include "Utils.hpp"
 
 #include <algorithm>
@@ -25,6 +26,9 @@
 #include "SVG.hpp"
 
 #include <tbb/parallel_for.h>
+#include <tbb/pipeline.h>
+#include <tbb/task_group.h>
+#include <tbb/task_scheduler_init.h>
 
 #include <Shiny/Shiny.h>
 
@@ -616,6 +620,7 @@ void GCode::do_export(Print *print, const char *path, GCodePreviewData *preview_
         return;
 
 	print->set_started(psGCodeExport);
+    SLIC3R_PROFILE_ZONE("GCode::do_export");
 
     BOOST_LOG_TRIVIAL(info) << "Exporting G-code..." << log_memory_info();
 
@@ -663,14 +668,14 @@ void GCode::do_export(Print *print, const char *path, GCodePreviewData *preview_
     }
 
     if (print->config().remaining_times.value) {
-        BOOST_LOG_TRIVIAL(debug) << "Processing remaining times for normal mode" << log_memory_info();
-        m_normal_time_estimator.post_process_remaining_times(path_tmp, 60.0f);
+        BOOST_LOG_TRIVIAL(debug) << "Processing remaining times" << log_memory_info();
+        std::vector<const GCodeTimeEstimator*> estimators { &m_normal_time_estimator };
+        if (m_silent_time_estimator_enabled)
+            estimators.emplace_back(&m_silent_time_estimator);
+        GCodeTimeEstimator::post_process_remaining_times(path_tmp, 60.0f, estimators);
         m_normal_time_estimator.reset();
-        if (m_silent_time_estimator_enabled) {
-            BOOST_LOG_TRIVIAL(debug) << "Processing remaining times for silent mode" << log_memory_info();
-            m_silent_time_estimator.post_process_remaining_times(path_tmp, 60.0f);
+        if (m_silent_time_estimator_enabled)
             m_silent_time_estimator.reset();
-        }
     }
 
     // starts analyzer calculations
@@ -693,6 +698,25 @@ void GCode::do_export(Print *print, const char *path, GCodePreviewData *preview_
     PROFILE_OUTPUT(debug_out_path("gcode-export-profile.txt").c_str());
 }
 
+// Calculate the edge grids over the layer slices used by GCode::extrude_loop() to avoid placing seams over overhangs.
+// The grids are calculated in parallel here, so that the serial G-code generator only looks them up.
+// The grids are kept with the layers, therefore a repeated G-code export only calculates the grids, which were invalidated.
+static void prepare_slices_edge_grids(const Print &print)
+{
+    if (print.config().spiral_vase)
+        // The seam of a spiral vase is not placed by the penalties.
+        return;
+    for (const PrintObject *object : print.objects())
+        if (object->config().seam_position.value != spRandom && object->layers().size() > 1)
+            // The topmost layer has no overhangs above it.
+            tbb::parallel_for(tbb::blocked_range<size_t>(0, object->layers().size() - 1),
+                [object, &print](const tbb::blocked_range<size_t> &range) {
+                    // The caller throws if canceled.
+                    for (size_t layer_idx = range.begin(); layer_idx < range.end() && ! print.canceled(); ++ layer_idx)
+                        object->layers()[layer_idx]->slices_edge_grid();
+                });
+}
+
 void GCode::_do_export(Print &print, FILE *file)
 {
     PROFILE_FUNC();
@@ -708,43 +732,13 @@ void GCode::_do_export(Print &print, FILE *file)
     // this->print_machine_envelope(file, print);
     // shall be adjusted as well to produce a G-code block compatible with the particular firmware flavor.
     if (print.config().gcode_flavor.value == gcfMarlin) {
-        m_normal_time_estimator.set_max_acceleration((float)print.config().machine_max_acceleration_extruding.values[0]);
-		m_normal_time_estimator.set_retract_acceleration((float)print.config().machine_max_acceleration_retracting.values[0]);
-		m_normal_time_estimator.set_minimum_feedrate((float)print.config().machine_min_extruding_rate.values[0]);
-		m_normal_time_estimator.set_minimum_travel_feedrate((float)print.config().machine_min_travel_rate.values[0]);
-		m_normal_time_estimator.set_axis_max_acceleration(GCodeTimeEstimator::X, (float)print.config().machine_max_acceleration_x.values[0]);
-		m_normal_time_estimator.set_axis_max_acceleration(GCodeTimeEstimator::Y, (float)print.config().machine_max_acceleration_y.values[0]);
-		m_normal_time_estimator.set_axis_max_acceleration(GCodeTimeEstimator::Z, (float)print.config().machine_max_acceleration_z.values[0]);
-		m_normal_time_estimator.set_axis_max_acceleration(GCodeTimeEstimator::E, (float)print.config().machine_max_acceleration_e.values[0]);
-		m_normal_time_estimator.set_axis_max_feedrate(GCodeTimeEstimator::X, (float)print.config().machine_max_feedrate_x.values[0]);
-		m_normal_time_estimator.set_axis_max_feedrate(GCodeTimeEstimator::Y, (float)print.config().machine_max_feedrate_y.values[0]);
-		m_normal_time_estimator.set_axis_max_feedrate(GCodeTimeEstimator::Z, (float)print.config().machine_max_feedrate_z.values[0]);
-		m_normal_time_estimator.set_axis_max_feedrate(GCodeTimeEstimator::E, (float)print.config().machine_max_feedrate_e.values[0]);
-		m_normal_time_estimator.set_axis_max_jerk(GCodeTimeEstimator::X, (float)print.config().machine_max_jerk_x.values[0]);
-		m_normal_time_estimator.set_axis_max_jerk(GCodeTimeEstimator::Y, (float)print.config().machine_max_jerk_y.values[0]);
-		m_normal_time_estimator.set_axis_max_jerk(GCodeTimeEstimator::Z, (float)print.config().machine_max_jerk_z.values[0]);
-		m_normal_time_estimator.set_axis_max_jerk(GCodeTimeEstimator::E, (float)print.config().machine_max_jerk_e.values[0]);
+        m_normal_time_estimator.set_machine_limits(print.config());
 
         if (m_silent_time_estimator_enabled)
         {
             m_silent_time_estimator.reset();
             m_silent_time_estimator.set_dialect(print.config().gcode_flavor);
-			m_silent_time_estimator.set_max_acceleration((float)print.config().machine_max_acceleration_extruding.values[1]);
-			m_silent_time_estimator.set_retract_acceleration((float)print.config().machine_max_acceleration_retracting.values[1]);
-			m_silent_time_estimator.set_minimum_feedrate((float)print.config().machine_min_extruding_rate.values[1]);
-			m_silent_time_estimator.set_minimum_travel_feedrate((float)print.config().machine_min_travel_rate.values[1]);
-			m_silent_time_estimator.set_axis_max_acceleration(GCodeTimeEstimator::X, (float)print.config().machine_max_acceleration_x.values[1]);
-			m_silent_time_estimator.set_axis_max_acceleration(GCodeTimeEstimator::Y, (float)print.config().machine_max_acceleration_y.values[1]);
-			m_silent_time_estimator.set_axis_max_acceleration(GCodeTimeEstimator::Z, (float)print.config().machine_max_acceleration_z.values[1]);
-			m_silent_time_estimator.set_axis_max_acceleration(GCodeTimeEstimator::E, (float)print.config().machine_max_acceleration_e.values[1]);
-			m_silent_time_estimator.set_axis_max_feedrate(GCodeTimeEstimator::X, (float)print.config().machine_max_feedrate_x.values[1]);
-			m_silent_time_estimator.set_axis_max_feedrate(GCodeTimeEstimator::Y, (float)print.config().machine_max_feedrate_y.values[1]);
-			m_silent_time_estimator.set_axis_max_feedrate(GCodeTimeEstimator::Z, (float)print.config().machine_max_feedrate_z.values[1]);
-			m_silent_time_estimator.set_axis_max_feedrate(GCodeTimeEstimator::E, (float)print.config().machine_max_feedrate_e.values[1]);
-			m_silent_time_estimator.set_axis_max_jerk(GCodeTimeEstimator::X, (float)print.config().machine_max_jerk_x.values[1]);
-			m_silent_time_estimator.set_axis_max_jerk(GCodeTimeEstimator::Y, (float)print.config().machine_max_jerk_y.values[1]);
-			m_silent_time_estimator.set_axis_max_jerk(GCodeTimeEstimator::Z, (float)print.config().machine_max_jerk_z.values[1]);
-			m_silent_time_estimator.set_axis_max_jerk(GCodeTimeEstimator::E, (float)print.config().machine_max_jerk_e.values[1]);
+            m_silent_time_estimator.set_machine_limits(print.config());
             if (print.config().single_extruder_multi_material) {
                 // As of now the fields are shown at the UI dialog in the same combo box as the ramming values, so they
                 // are considered to be active for the single extruder multi-material printers only.
@@ -1018,6 +1012,9 @@ void GCode::_do_export(Print &print, FILE *file)
         print.throw_if_canceled();
     }
 
+    prepare_slices_edge_grids(print);
+    print.throw_if_canceled();
+
     // Calculate wiping points if needed
     if (print.config().ooze_prevention.value && ! print.config().single_extruder_multi_material) {
         Points skirt_points;
@@ -1104,12 +1101,13 @@ void GCode::_do_export(Print &print, FILE *file)
                 m_cooling_buffer->set_current_extruder(initial_extruder_id);
                 // Pair the object layers with the support layers by z, extrude them.
                 std::vector<LayerToPrint> layers_to_print = collect_layers_to_print(object);
-                for (const LayerToPrint &ltp : layers_to_print) {
+                const size_t              single_object_idx = &copy - object.copies().data();
+                this->process_layers(print, layers_to_print.size(), [this, &print, &tool_ordering, &layers_to_print, single_object_idx](size_t idx) {
+                    const LayerToPrint &ltp = layers_to_print[idx];
                     std::vector<LayerToPrint> lrs;
-                    lrs.emplace_back(std::move(ltp));
-                    this->process_layer(file, print, lrs, tool_ordering.tools_for_layer(ltp.print_z()), &copy - object.copies().data());
-                    print.throw_if_canceled();
-                }
+                    lrs.emplace_back(ltp);
+                    return this->process_layer(print, lrs, tool_ordering.tools_for_layer(ltp.print_z()), single_object_idx);
+                }, file);
 #ifdef HAS_PRESSURE_EQUALIZER
                 if (m_pressure_equalizer)
                     _write(file, m_pressure_equalizer->process("", true));
@@ -1161,13 +1159,13 @@ void GCode::_do_export(Print &print, FILE *file)
             print.throw_if_canceled();
         }
         // Extrude the layers.
-        for (auto &layer : layers_to_print) {
+        this->process_layers(print, layers_to_print.size(), [this, &print, &tool_ordering, &layers_to_print](size_t idx) {
+            const std::pair<coordf_t, std::vector<LayerToPrint>> &layer = layers_to_print[idx];
             const LayerTools &layer_tools = tool_ordering.tools_for_layer(layer.first);
             if (m_wipe_tower && layer_tools.has_wipe_tower)
                 m_wipe_tower->next_layer();
-            this->process_layer(file, print, layer.second, layer_tools, size_t(-1));
-            print.throw_if_canceled();
-        }
+            return this->process_layer(print, layer.second, layer_tools, size_t(-1));
+        }, file);
 #ifdef HAS_PRESSURE_EQUALIZER
         if (m_pressure_equalizer)
             _write(file, m_pressure_equalizer->process("", true));
@@ -1221,10 +1219,14 @@ void GCode::_do_export(Print &print, FILE *file)
 
     print.throw_if_canceled();
 
-    // calculates estimated printing time
-    m_normal_time_estimator.calculate_time(false);
-    if (m_silent_time_estimator_enabled)
-        m_silent_time_estimator.calculate_time(false);
+    // calculates estimated printing time, the normal and the silent mode estimates in parallel
+    if (m_silent_time_estimator_enabled) {
+        tbb::task_group task_group;
+        task_group.run([this]() { m_silent_time_estimator.calculate_time(false); });
+        m_normal_time_estimator.calculate_time(false);
+        task_group.wait();
+    } else
+        m_normal_time_estimator.calculate_time(false);
 
     // Get filament stats.
     print.m_print_statistics.clear();
@@ -1481,9 +1483,8 @@ inline std::vector<GCode::ObjectByExtruder::Island>& object_islands_by_extruder(
 // In non-sequential mode, process_layer is called per each print_z height with all object and support layers accumulated.
 // For multi-material prints, this routine minimizes extruder switches by gathering extruder specific extrusion paths
 // and performing the extruder specific extrusions together.
-void GCode::process_layer(
-    // Write into the output file.
-    FILE                            *file,
+// The returned G-code is not post-processed yet, see GCode::process_layers().
+GCode::LayerResult GCode::process_layer(
     const Print                     &print,
     // Set of object & print layers of the same PrintObject and with the same print_z.
     const std::vector<LayerToPrint> &layers,
@@ -1492,14 +1493,16 @@ void GCode::process_layer(
     // Otherwise print a single copy of a single object.
     const size_t                     single_object_idx)
 {
+    SLIC3R_PROFILE_ZONE("GCode::process_layer");
     assert(! layers.empty());
 //    assert(! layer_tools.extruders.empty());
     // Either printing all copies of all objects, or just a single copy of a single object.
     assert(single_object_idx == size_t(-1) || layers.size() == 1);
 
+    LayerResult result;
     if (layer_tools.extruders.empty())
         // Nothing to extrude.
-        return;
+        return result;
 
     // Extract 1st object_layer and support_layer of this set of layers with an equal print_z.
     const Layer         *object_layer  = nullptr;
@@ -1531,12 +1534,14 @@ void GCode::process_layer(
                     break;
                 }
         }
-        m_spiral_vase->enable = enable;
+        m_spiral_vase_enable = enable;
     }
     // If we're going to apply spiralvase to this layer, disable loop clipping
-    m_enable_loop_clipping = ! m_spiral_vase || ! m_spiral_vase->enable;
+    m_enable_loop_clipping = ! m_spiral_vase || ! m_spiral_vase_enable;
+    result.layer_id           = layer.id();
+    result.spiral_vase_enable = m_spiral_vase_enable;
     
-    std::string gcode;
+    std::string &gcode = result.gcode;
 
     // Set new layer - this will change Z and force a retraction if retract_layer_change is enabled.
     if (! print.config().before_layer_gcode.value.empty()) {
@@ -1779,7 +1784,6 @@ void GCode::process_layer(
     } // for objects
 
     // Extrude the skirt, brim, support, perimeters, infill ordered by the extruders.
-    std::vector<std::unique_ptr<EdgeGrid::Grid>> lower_layer_edge_grids(layers.size());
     for (unsigned int extruder_id : layer_tools.extruders)
     {
         gcode += (layer_tools.has_wipe_tower && m_wipe_tower) ?
@@ -1879,9 +1883,9 @@ void GCode::process_layer(
 
                         if (print.config().infill_first) {
                             gcode += this->extrude_infill(print, by_region_specific);
-                            gcode += this->extrude_perimeters(print, by_region_specific, lower_layer_edge_grids[layer_id]);
+                            gcode += this->extrude_perimeters(print, by_region_specific);
                         } else {
-                            gcode += this->extrude_perimeters(print, by_region_specific, lower_layer_edge_grids[layer_id]);
+                            gcode += this->extrude_perimeters(print, by_region_specific);
                             gcode += this->extrude_infill(print,by_region_specific);
                         }
                     }
@@ -1893,33 +1897,112 @@ void GCode::process_layer(
         }
     }
 
-    // Apply spiral vase post-processing if this layer contains suitable geometry
-    // (we must feed all the G-code into the post-processor, including the first 
-    // bottom non-spiral layers otherwise it will mess with positions)
-    // we apply spiral vase at this stage because it requires a full layer.
-    // Just a reminder: A spiral vase mode is allowed for a single object per layer, single material print only.
-    if (m_spiral_vase)
-        gcode = m_spiral_vase->process_layer(gcode);
-
-    // Apply cooling logic; this may alter speeds.
-    if (m_cooling_buffer)
-        gcode = m_cooling_buffer->process_layer(gcode, layer.id());
+    BOOST_LOG_TRIVIAL(trace) << "Generated layer " << layer.id() << " print_z " << print_z << log_memory_info();
+    return result;
+}
 
+void GCode::process_layers(const Print &print, size_t num_layers, const std::function<LayerResult(size_t)> &generate_layer, FILE *file)
+{
+    // The G-code generator and each of the filters below keep their own state from layer to layer,
+    // therefore each of them has to see the layers one by one in the print order. Different stages may
+    // work on different layers at the same time though, which is what the pipelined mode does.
+    // Both modes call the very same stages in the very same order, therefore they produce the same output.
+    auto spiral_vase = [this](LayerResult &&in) -> LayerResult {
+        // Apply spiral vase post-processing if this layer contains suitable geometry
+        // (we must feed all the G-code into the post-processor, including the first 
+        // bottom non-spiral layers otherwise it will mess with positions)
+        // we apply spiral vase at this stage because it requires a full layer.
+        // Just a reminder: A spiral vase mode is allowed for a single object per layer, single material print only.
+        if (m_spiral_vase && ! in.nop()) {
+            SLIC3R_PROFILE_ZONE("SpiralVase::process_layer");
+            m_spiral_vase->enable = in.spiral_vase_enable;
+            in.gcode = m_spiral_vase->process_layer(in.gcode);
+        }
+        return std::move(in);
+    };
+    // The cooling buffer is split into the steps, which pass the state from layer to layer (cooling_begin, cooling_commit),
+    // and into the steps, which only read the state and which may process multiple layers concurrently (cooling_scan, cooling_adjust).
+    auto cooling_scan = [this](LayerResult &&in) -> LayerResult {
+        if (m_cooling_buffer && ! in.nop()) {
+            SLIC3R_PROFILE_ZONE("CoolingBuffer::scan_layer");
+            in.cooling.layer_id = in.layer_id;
+            m_cooling_buffer->scan_layer(in.gcode, in.cooling);
+        }
+        return std::move(in);
+    };
+    auto cooling_begin = [this](LayerResult &&in) -> LayerResult {
+        if (m_cooling_buffer && ! in.nop())
+            m_cooling_buffer->begin_layer(in.cooling);
+        return std::move(in);
+    };
+    auto cooling_adjust = [this](LayerResult &&in) -> LayerResult {
+        if (m_cooling_buffer && ! in.nop()) {
+            SLIC3R_PROFILE_ZONE("CoolingBuffer::adjust_layer");
+            // Apply cooling logic; this may alter speeds.
+            in.gcode = m_cooling_buffer->adjust_layer(in.gcode, in.cooling);
+        }
+        return std::move(in);
+    };
+    auto cooling_commit = [this](LayerResult &&in) -> LayerResult {
+        if (in.nop())
+            return std::move(in);
+        if (m_cooling_buffer)
+            m_cooling_buffer->commit_layer(in.cooling, in.gcode);
 #ifdef HAS_PRESSURE_EQUALIZER
-    // Apply pressure equalization if enabled;
-    // printf("G-code before filter:\n%s\n", gcode.c_str());
-    if (m_pressure_equalizer)
-        gcode = m_pressure_equalizer->process(gcode.c_str(), false);
-    // printf("G-code after filter:\n%s\n", out.c_str());
+        // Apply pressure equalization if enabled;
+        if (m_pressure_equalizer)
+            in.gcode = m_pressure_equalizer->process(in.gcode.c_str(), false);
 #endif /* HAS_PRESSURE_EQUALIZER */
-    
-    _write(file, gcode);
-    BOOST_LOG_TRIVIAL(trace) << "Exported layer " << layer.id() << " print_z " << print_z << 
-        ", time estimator memory: " <<
-            format_memsize_MB(m_normal_time_estimator.memory_used() + m_silent_time_estimator_enabled ? m_silent_time_estimator.memory_used() : 0) <<
-        ", analyzer memory: " <<
-            format_memsize_MB(m_analyzer.memory_used()) <<
-        log_memory_info();
+        return std::move(in);
+    };
+    auto output = [this, file](LayerResult &&in) {
+        if (in.nop())
+            return;
+        SLIC3R_PROFILE_ZONE("GCode::write_layer");
+        _write(file, in.gcode);
+        BOOST_LOG_TRIVIAL(trace) << "Exported layer " << in.layer_id <<
+            ", time estimator memory: " <<
+                format_memsize_MB(m_normal_time_estimator.memory_used() + m_silent_time_estimator_enabled ? m_silent_time_estimator.memory_used() : 0) <<
+            ", analyzer memory: " <<
+                format_memsize_MB(m_analyzer.memory_used()) <<
+            log_memory_info();
+    };
+
+    if (! m_pipelined_export) {
+        for (size_t idx = 0; idx < num_layers; ++ idx) {
+            output(cooling_commit(cooling_adjust(cooling_begin(cooling_scan(spiral_vase(generate_layer(idx)))))));
+            print.throw_if_canceled();
+        }
+        return;
+    }
+
+    size_t layer_to_generate = 0;
+    // Most stages are serial, only the cooling_scan and cooling_adjust stages process multiple layers at once.
+    // Let these two stages keep all the threads busy, without holding the G-code of many layers in memory.
+    const size_t max_layers_in_flight = std::max<size_t>(8, 2 * tbb::task_scheduler_init::default_num_threads());
+    tbb::parallel_pipeline(max_layers_in_flight,
+        tbb::make_filter<void, LayerResult>(tbb::filter::serial_in_order,
+            [&print, num_layers, &generate_layer, &layer_to_generate](tbb::flow_control &fc) -> LayerResult {
+                if (layer_to_generate == num_layers) {
+                    fc.stop();
+                    return LayerResult();
+                }
+                LayerResult out = generate_layer(layer_to_generate ++);
+                print.throw_if_canceled();
+                return out;
+            }) &
+        tbb::make_filter<LayerResult, LayerResult>(tbb::filter::serial_in_order, 
+            [&spiral_vase](LayerResult in) -> LayerResult { return spiral_vase(std::move(in)); }) &
+        tbb::make_filter<LayerResult, LayerResult>(tbb::filter::parallel,
+            [&cooling_scan](LayerResult in) -> LayerResult { return cooling_scan(std::move(in)); }) &
+        tbb::make_filter<LayerResult, LayerResult>(tbb::filter::serial_in_order,
+            [&cooling_begin](LayerResult in) -> LayerResult { return cooling_begin(std::move(in)); }) &
+        tbb::make_filter<LayerResult, LayerResult>(tbb::filter::parallel,
+            [&cooling_adjust](LayerResult in) -> LayerResult { return cooling_adjust(std::move(in)); }) &
+        tbb::make_filter<LayerResult, LayerResult>(tbb::filter::serial_in_order,
+            [&cooling_commit](LayerResult in) -> LayerResult { return cooling_commit(std::move(in)); }) &
+        tbb::make_filter<LayerResult, void>(tbb::filter::serial_in_order,
+            [&output](LayerResult in) { output(std::move(in)); }));
 }
 
 void GCode::apply_print_config(const PrintConfig &print_config)
@@ -2195,32 +2278,11 @@ std::vector<float> polygon_angles_at_vertices(const Polygon &polygon, const std:
     return angles;
 }
 
-std::string GCode::extrude_loop(ExtrusionLoop loop, std::string description, double speed, std::unique_ptr<EdgeGrid::Grid> *lower_layer_edge_grid)
+std::string GCode::extrude_loop(ExtrusionLoop loop, std::string description, double speed, const Layer *lower_layer)
 {
     // get a copy; don't modify the orientation of the original loop object otherwise
     // next copies (if any) would not detect the correct orientation
 
-    if (m_layer->lower_layer != nullptr && lower_layer_edge_grid != nullptr) {
-        if (! *lower_layer_edge_grid) {
-            // Create the distance field for a layer below.
-            const coord_t distance_field_resolution = coord_t(scale_(1.) + 0.5);
-            *lower_layer_edge_grid = make_unique<EdgeGrid::Grid>();
-            (*lower_layer_edge_grid)->create(m_layer->lower_layer->slices, distance_field_resolution);
-            (*lower_layer_edge_grid)->calculate_sdf();
-            #if 0
-            {
-                static int iRun = 0;
-                BoundingBox bbox = (*lower_layer_edge_grid)->bbox();
-                bbox.min(0) -= scale_(5.f);
-                bbox.min(1) -= scale_(5.f);
-                bbox.max(0) += scale_(5.f);
-                bbox.max(1) += scale_(5.f);
-                EdgeGrid::save_png(*(*lower_layer_edge_grid), bbox, scale_(0.1f), debug_out_path("GCode_extrude_loop_edge_grid-%d.png", iRun++));
-            }
-            #endif
-        }
-    }
-  
     // extrude all loops ccw
     bool was_clockwise = loop.make_counter_clockwise();
     
@@ -2304,8 +2366,21 @@ std::string GCode::extrude_loop(ExtrusionLoop loop, std::string description, dou
         }
 
         // Penalty for overhangs.
-        if (lower_layer_edge_grid && (*lower_layer_edge_grid)) {
+        if (lower_layer != nullptr) {
             // Use the edge grid distance field structure over the lower layer to calculate overhangs.
+            // The grid is calculated on demand and kept with the lower layer, see prepare_slices_edge_grids().
+            const EdgeGrid::Grid &lower_layer_edge_grid = lower_layer->slices_edge_grid();
+            #if 0
+            {
+                static int iRun = 0;
+                BoundingBox bbox = lower_layer_edge_grid.bbox();
+                bbox.min(0) -= scale_(5.f);
+                bbox.min(1) -= scale_(5.f);
+                bbox.max(0) += scale_(5.f);
+                bbox.max(1) += scale_(5.f);
+                EdgeGrid::save_png(lower_layer_edge_grid, bbox, scale_(0.1f), debug_out_path("GCode_extrude_loop_edge_grid-%d.png", iRun++));
+            }
+            #endif
             coord_t nozzle_r = coord_t(floor(scale_(0.5 * nozzle_dmr) + 0.5));
             coord_t search_r = coord_t(floor(scale_(0.8 * nozzle_dmr) + 0.5));
             for (size_t i = 0; i < polygon.points.size(); ++ i) {
@@ -2315,9 +2390,9 @@ std::string GCode::extrude_loop(ExtrusionLoop loop, std::string description, dou
                 // The point is considered at an overhang, if it is more than nozzle radius
                 // outside of the lower layer contour.
                 #ifdef NDEBUG // to suppress unused variable warning in release mode
-                    (*lower_layer_edge_grid)->signed_distance(p, search_r, dist);
+                    lower_layer_edge_grid.signed_distance(p, search_r, dist);
                 #else
-                    bool found = (*lower_layer_edge_grid)->signed_distance(p, search_r, dist);
+                    bool found = lower_layer_edge_grid.signed_distance(p, search_r, dist);
                 #endif
                 // If the approximate Signed Distance Field was initialized over lower_layer_edge_grid,
                 // then the signed distnace shall always be known.
@@ -2479,14 +2554,14 @@ std::string GCode::extrude_multi_path(ExtrusionMultiPath multipath, std::string
     return gcode;
 }
 
-std::string GCode::extrude_entity(const ExtrusionEntity &entity, std::string description, double speed, std::unique_ptr<EdgeGrid::Grid> *lower_layer_edge_grid)
+std::string GCode::extrude_entity(const ExtrusionEntity &entity, std::string description, double speed, const Layer *lower_layer)
 {
     if (const ExtrusionPath* path = dynamic_cast<const ExtrusionPath*>(&entity))
         return this->extrude_path(*path, description, speed);
     else if (const ExtrusionMultiPath* multipath = dynamic_cast<const ExtrusionMultiPath*>(&entity))
         return this->extrude_multi_path(*multipath, description, speed);
     else if (const ExtrusionLoop* loop = dynamic_cast<const ExtrusionLoop*>(&entity))
-        return this->extrude_loop(*loop, description, speed, lower_layer_edge_grid);
+        return this->extrude_loop(*loop, description, speed, lower_layer);
     else {
         throw std::invalid_argument("Invalid argument supplied to extrude()");
         return "";
@@ -2508,13 +2583,13 @@ std::string GCode::extrude_path(ExtrusionPath path, std::string description, dou
 }
 
 // Extrude perimeters: Decide where to put seams (hide or align seams).
-std::string GCode::extrude_perimeters(const Print &print, const std::vector<ObjectByExtruder::Island::Region> &by_region, std::unique_ptr<EdgeGrid::Grid> &lower_layer_edge_grid)
+std::string GCode::extrude_perimeters(const Print &print, const std::vector<ObjectByExtruder::Island::Region> &by_region)
 {
     std::string gcode;
     for (const ObjectByExtruder::Island::Region &region : by_region) {
         m_config.apply(print.regions()[&region - &by_region.front()]->config());
         for (ExtrusionEntity *ee : region.perimeters.entities)
-            gcode += this->extrude_entity(*ee, "perimeter", -1., &lower_layer_edge_grid);
+            gcode += this->extrude_entity(*ee, "perimeter", -1., m_layer->lower_layer);
     }
     return gcode;
 }
@@ -2569,15 +2644,34 @@ std::string GCode::extrude_support(const ExtrusionEntityCollection &support_fill
 void GCode::_write(FILE* file, const char *what)
 {
     if (what != nullptr) {
-        // apply analyzer, if enabled
-        const char* gcode = m_enable_analyzer ? m_analyzer.process_gcode(what).c_str() : what;
+        // The G-code is parsed just once, the parsed lines are passed to the analyzer and to the time estimators.
+        // If the analyzer is enabled, it removes its workcodes, thus the lines it lets through are collected
+        // into m_analyzer_output to be written out.
+        if (m_enable_analyzer)
+            m_analyzer_output.clear();
+        auto process_line = [this](GCodeReader&, const GCodeReader::GCodeLine &line) {
+            if (m_enable_analyzer) {
+                if (! m_analyzer.process_gcode_line(line))
+                    return;
+                m_analyzer_output.append(line.raw().data(), line.raw().size());
+                m_analyzer_output += '\n';
+            }
+            // updates time estimator and gcode lines vector
+            m_normal_time_estimator.add_gcode_line(line);
+            if (m_silent_time_estimator_enabled)
+                m_silent_time_estimator.add_gcode_line(line);
+        };
+        GCodeReader::GCodeLine gline;
+        for (const char *ptr = what; *ptr != 0;) {
+            gline.reset();
+            ptr = m_output_parser.parse_line(ptr, gline, process_line);
+        }
 
         // writes string to file
-        fwrite(gcode, 1, ::strlen(gcode), file);
-        // updates time estimator and gcode lines vector
-        m_normal_time_estimator.add_gcode_block(gcode);
-        if (m_silent_time_estimator_enabled)
-            m_silent_time_estimator.add_gcode_block(gcode);
+        if (m_enable_analyzer)
+            fwrite(m_analyzer_output.data(), 1, m_analyzer_output.size(), file);
+        else
+            fwrite(what, 1, ::strlen(what), file);
     }
 }
 
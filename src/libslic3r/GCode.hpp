@@ -18,6 +18,7 @@
 #include "EdgeGrid.hpp"
 #include "GCode/Analyzer.hpp"
 
+#include <functional>
 #include <memory>
 #include <string>
 
@@ -156,6 +157,8 @@ public:
         m_normal_time_estimator(GCodeTimeEstimator::Normal),
         m_silent_time_estimator(GCodeTimeEstimator::Silent),
         m_silent_time_estimator_enabled(false),
+        m_spiral_vase_enable(false),
+        m_pipelined_export(true),
         m_last_obj_copy(nullptr, Point(std::numeric_limits<coord_t>::max(), std::numeric_limits<coord_t>::max()))
         {}
     ~GCode() {}
@@ -163,6 +166,9 @@ public:
     // throws std::runtime_exception on error,
     // throws CanceledException through print->throw_if_canceled().
     void            do_export(Print *print, const char *path, GCodePreviewData *preview_data = nullptr);
+    // Generate the layers and post-process them in a TBB pipeline (default) or layer by layer on a single thread.
+    // Both modes produce the same output, the serial mode is kept for verification and debugging.
+    void            set_pipelined_export(bool pipelined) { m_pipelined_export = pipelined; }
 
     // Exported for the helper classes (OozePrevention, Wipe) and for the Perl binding for unit tests.
     const Vec2d&    origin() const { return m_origin; }
@@ -204,9 +210,20 @@ protected:
     };
     static std::vector<GCode::LayerToPrint>                            collect_layers_to_print(const PrintObject &object);
     static std::vector<std::pair<coordf_t, std::vector<LayerToPrint>>> collect_layers_to_print(const Print &print);
-    void            process_layer(
-        // Write into the output file.
-        FILE                            *file,
+
+    // G-code of a single layer as produced by process_layer(), before the post-processing filters are applied.
+    struct LayerResult
+    {
+        std::string gcode;
+        // Set to size_t(-1) if nothing was extruded at this layer and the post-processing filters shall be skipped.
+        size_t      layer_id            = size_t(-1);
+        // Shall the spiral vase filter be enabled for this layer?
+        bool        spiral_vase_enable  = false;
+        // State of the cooling buffer passed between the steps of the cooling of this layer.
+        CoolingBuffer::Layer cooling;
+        bool        nop() const { return layer_id == size_t(-1); }
+    };
+    LayerResult     process_layer(
         const Print                     &print,
         // Set of object & print layers of the same PrintObject and with the same print_z.
         const std::vector<LayerToPrint> &layers,
@@ -214,14 +231,20 @@ protected:
         // If set to size_t(-1), then print all copies of all objects.
         // Otherwise print a single copy of a single object.
         const size_t                     single_object_idx = size_t(-1));
+    // Generate G-code of num_layers layers by calling generate_layer(0 .. num_layers - 1), pass it through
+    // the post-processing filters (spiral vase, cooling buffer, pressure equalizer) and write it into the file.
+    // If m_pipelined_export is set, the generator and the filters work on consecutive layers concurrently,
+    // and the slow down of the cooling buffer is calculated for multiple layers concurrently.
+    void            process_layers(const Print &print, size_t num_layers, const std::function<LayerResult(size_t)> &generate_layer, FILE *file);
 
     void            set_last_pos(const Point &pos) { m_last_pos = pos; m_last_pos_defined = true; }
     bool            last_pos_defined() const { return m_last_pos_defined; }
     void            set_extruders(const std::vector<unsigned int> &extruder_ids);
     std::string     preamble();
     std::string     change_layer(coordf_t print_z);
-    std::string     extrude_entity(const ExtrusionEntity &entity, std::string description = "", double speed = -1., std::unique_ptr<EdgeGrid::Grid> *lower_layer_edge_grid = nullptr);
-    std::string     extrude_loop(ExtrusionLoop loop, std::string description, double speed = -1., std::unique_ptr<EdgeGrid::Grid> *lower_layer_edge_grid = nullptr);
+    // If lower_layer is set, the seams of the loops are not placed over the overhangs of lower_layer, see Layer::slices_edge_grid().
+    std::string     extrude_entity(const ExtrusionEntity &entity, std::string description = "", double speed = -1., const Layer *lower_layer = nullptr);
+    std::string     extrude_loop(ExtrusionLoop loop, std::string description, double speed = -1., const Layer *lower_layer = nullptr);
     std::string     extrude_multi_path(ExtrusionMultiPath multipath, std::string description = "", double speed = -1.);
     std::string     extrude_path(ExtrusionPath path, std::string description = "", double speed = -1.);
 
@@ -259,7 +282,7 @@ protected:
     };
 
 
-    std::string     extrude_perimeters(const Print &print, const std::vector<ObjectByExtruder::Island::Region> &by_region, std::unique_ptr<EdgeGrid::Grid> &lower_layer_edge_grid);
+    std::string     extrude_perimeters(const Print &print, const std::vector<ObjectByExtruder::Island::Region> &by_region);
     std::string     extrude_infill(const Print &print, const std::vector<ObjectByExtruder::Island::Region> &by_region);
     std::string     extrude_support(const ExtrusionEntityCollection &support_fills);
 
@@ -316,6 +339,9 @@ protected:
 
     std::unique_ptr<CoolingBuffer>      m_cooling_buffer;
     std::unique_ptr<SpiralVase>         m_spiral_vase;
+    // Spiral vase state as decided by the G-code generator. It is passed to m_spiral_vase together with the layer G-code,
+    // as the spiral vase filter may still be processing one of the previous layers.
+    bool                                m_spiral_vase_enable;
 #ifdef HAS_PRESSURE_EQUALIZER
     std::unique_ptr<PressureEqualizer>  m_pressure_equalizer;
 #endif /* HAS_PRESSURE_EQUALIZER */
@@ -338,9 +364,17 @@ protected:
     GCodeTimeEstimator m_silent_time_estimator;
     bool m_silent_time_estimator_enabled;
 
+    // Run the layer generator and the post-processing filters in a TBB pipeline.
+    bool m_pipelined_export;
+
     // Analyzer
     GCodeAnalyzer m_analyzer;
 
+    // Parses the exported G-code for the analyzer and the time estimators, see _write().
+    GCodeReader m_output_parser;
+    // G-code passed through the analyzer, reused between the calls to _write() to avoid reallocations.
+    std::string m_analyzer_output;
+
     // Write a string into a file.
     void _write(FILE* file, const std::string& what) { this->_write(file, what.c_str()); }
     void _write(FILE* file, const char *what);
@@ -138,12 +138,21 @@ const std::string& GCodeAnalyzer::process_gcode(const std::string& gcode)
     m_process_output = "";
 
     m_parser.parse_buffer(gcode,
-        [this](GCodeReader& reader, const GCodeReader::GCodeLine& line)
-    { this->_process_gcode_line(reader, line); });
+        [this](GCodeReader&, const GCodeReader::GCodeLine& line)
+    {
+        if (this->process_gcode_line(line))
+            // puts the line back into the gcode
+            m_process_output.append(line.raw().data(), line.raw().size()) += '\n';
+    });
 
     return m_process_output;
 }
 
+bool GCodeAnalyzer::process_gcode_line(const GCodeReader::GCodeLine& line)
+{
+    return this->_process_gcode_line(line);
+}
+
 void GCodeAnalyzer::calc_gcode_preview_data(GCodePreviewData& preview_data, std::function<void()> cancel_callback)
 {
     // resets preview data
@@ -167,16 +176,16 @@ bool GCodeAnalyzer::is_valid_extrusion_role(ExtrusionRole role)
     return ((erPerimeter <= role) && (role < erMixed));
 }
 
-void GCodeAnalyzer::_process_gcode_line(GCodeReader&, const GCodeReader::GCodeLine& line)
+bool GCodeAnalyzer::_process_gcode_line(const GCodeReader::GCodeLine& line)
 {
     // processes 'special' comments contained in line
     if (_process_tags(line))
     {
 #if 0
         // DEBUG ONLY: puts the line back into the gcode
-        m_process_output += line.raw() + "\n";
+        return true;
 #endif
-        return;
+        return false;
     }
 
     // sets new start position/extrusion
@@ -184,14 +193,13 @@ void GCodeAnalyzer::_process_gcode_line(GCodeReader&, const GCodeReader::GCodeLi
     _set_start_extrusion(_get_axis_position(E));
 
     // processes 'normal' gcode lines
-    std::string cmd = line.cmd();
-    if (cmd.length() > 1)
+    if (line.cmd_letter() != 0)
     {
-        switch (::toupper(cmd[0]))
+        switch (line.cmd_letter())
         {
         case 'G':
             {
-                switch (::atoi(&cmd[1]))
+                switch (line.cmd_number())
                 {
                 case 1: // Move
                     {
@@ -239,7 +247,7 @@ void GCodeAnalyzer::_process_gcode_line(GCodeReader&, const GCodeReader::GCodeLi
             }
         case 'M':
             {
-                switch (::atoi(&cmd[1]))
+                switch (line.cmd_number())
                 {
                 case 82: // Set extruder to absolute mode
                     {
@@ -281,8 +289,8 @@ void GCodeAnalyzer::_process_gcode_line(GCodeReader&, const GCodeReader::GCodeLi
         }
     }
 
-    // puts the line back into the gcode
-    m_process_output += line.raw() + "\n";
+    // the line shall be put back into the gcode
+    return true;
 }
 
 // Returns the new absolute position on the given axis in dependence of the given parameters
@@ -446,16 +454,13 @@ void GCodeAnalyzer::_processM108orM135(const GCodeReader::GCodeLine& line)
     // They have to be processed otherwise toolchanges will be unrecognised
     // by the analyzer - see https://github.com/prusa3d/PrusaSlicer/issues/2566
 
-    size_t code = ::atoi(&(line.cmd()[1]));
+    int code = line.cmd_number();
     if ((code == 108 && m_gcode_flavor == gcfSailfish)
         || (code == 135 && m_gcode_flavor == gcfMakerWare)) {
 
-        std::string cmd = line.raw();
-        size_t T_pos = cmd.find("T");
-        if (T_pos != std::string::npos) {
-            cmd = cmd.substr(T_pos);
-            _processT(cmd);
-        }
+        size_t T_pos = line.raw().find('T');
+        if (T_pos != boost::string_view::npos)
+            _processT(line.raw().substr(T_pos));
     }
 }
 
@@ -513,11 +518,12 @@ void GCodeAnalyzer::_reset_cached_position()
     }
 }
 
-void GCodeAnalyzer::_processT(const std::string& cmd)
+void GCodeAnalyzer::_processT(const boost::string_view& cmd)
 {
     if (cmd.length() > 1)
     {
-        unsigned int id = (unsigned int)::strtol(cmd.substr(1).c_str(), nullptr, 10);
+        // The command is followed by the end of the line, therefore it may be parsed in place.
+        unsigned int id = (unsigned int)::strtol(cmd.data() + 1, nullptr, 10);
         if (_get_extruder_id() != id)
         {
             _set_extruder_id(id);
@@ -535,7 +541,7 @@ void GCodeAnalyzer::_processT(const GCodeReader::GCodeLine& line)
 
 bool GCodeAnalyzer::_process_tags(const GCodeReader::GCodeLine& line)
 {
-    std::string comment = line.comment();
+    boost::string_view comment = line.comment();
 
     // extrusion role tag
     size_t pos = comment.find(Extrusion_Role_Tag);
@@ -580,9 +586,9 @@ bool GCodeAnalyzer::_process_tags(const GCodeReader::GCodeLine& line)
     return false;
 }
 
-void GCodeAnalyzer::_process_extrusion_role_tag(const std::string& comment, size_t pos)
+void GCodeAnalyzer::_process_extrusion_role_tag(const boost::string_view& comment, size_t pos)
 {
-    int role = (int)::strtol(comment.substr(pos + Extrusion_Role_Tag.length()).c_str(), nullptr, 10);
+    int role = (int)::strtol(comment.data() + pos + Extrusion_Role_Tag.length(), nullptr, 10);
     if (_is_valid_extrusion_role(role))
         _set_extrusion_role((ExtrusionRole)role);
     else
@@ -591,19 +597,19 @@ void GCodeAnalyzer::_process_extrusion_role_tag(const std::string& comment, size
     }
 }
 
-void GCodeAnalyzer::_process_mm3_per_mm_tag(const std::string& comment, size_t pos)
+void GCodeAnalyzer::_process_mm3_per_mm_tag(const boost::string_view& comment, size_t pos)
 {
-    _set_mm3_per_mm(::strtod(comment.substr(pos + Mm3_Per_Mm_Tag.length()).c_str(), nullptr));
+    _set_mm3_per_mm(::strtod(comment.data() + pos + Mm3_Per_Mm_Tag.length(), nullptr));
 }
 
-void GCodeAnalyzer::_process_width_tag(const std::string& comment, size_t pos)
+void GCodeAnalyzer::_process_width_tag(const boost::string_view& comment, size_t pos)
 {
-    _set_width((float)::strtod(comment.substr(pos + Width_Tag.length()).c_str(), nullptr));
+    _set_width((float)::strtod(comment.data() + pos + Width_Tag.length(), nullptr));
 }
 
-void GCodeAnalyzer::_process_height_tag(const std::string& comment, size_t pos)
+void GCodeAnalyzer::_process_height_tag(const boost::string_view& comment, size_t pos)
 {
-    _set_height((float)::strtod(comment.substr(pos + Height_Tag.length()).c_str(), nullptr));
+    _set_height((float)::strtod(comment.data() + pos + Height_Tag.length(), nullptr));
 }
 
 void GCodeAnalyzer::_process_color_change_tag()
@@ -770,12 +776,6 @@ Vec3d GCodeAnalyzer::_get_end_position() const
 
 void GCodeAnalyzer::_store_move(GCodeAnalyzer::GCodeMove::EType type)
 {
-    // if type non mapped yet, map it
-    TypeToMovesMap::iterator it = m_moves_map.find(type);
-    if (it == m_moves_map.end())
-        it = m_moves_map.insert(TypeToMovesMap::value_type(type, GCodeMovesList())).first;
-
-    // store move
     Vec3d extruder_offset = Vec3d::Zero();
     unsigned int extruder_id = _get_extruder_id();
     ExtruderOffsetsMap::iterator extr_it = m_extruder_offsets.find(extruder_id);
@@ -784,6 +784,19 @@ void GCodeAnalyzer::_store_move(GCodeAnalyzer::GCodeMove::EType type)
 
     Vec3d start_position = _get_start_position() + extruder_offset;
     Vec3d end_position = _get_end_position() + extruder_offset;
+
+    if (m_move_callback) {
+        // pass the move to the callback without storing it
+        m_move_callback(GCodeMove(type, _get_extrusion_role(), extruder_id, _get_mm3_per_mm(), _get_width(), _get_height(), _get_feedrate(), start_position, end_position, _get_delta_extrusion(), _get_cp_color_id()));
+        return;
+    }
+
+    // if type non mapped yet, map it
+    TypeToMovesMap::iterator it = m_moves_map.find(type);
+    if (it == m_moves_map.end())
+        it = m_moves_map.insert(TypeToMovesMap::value_type(type, GCodeMovesList())).first;
+
+    // store move
     it->second.emplace_back(type, _get_extrusion_role(), extruder_id, _get_mm3_per_mm(), _get_width(), _get_height(), _get_feedrate(), start_position, end_position, _get_delta_extrusion(), _get_cp_color_id());
 }
 
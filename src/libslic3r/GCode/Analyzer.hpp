@@ -88,6 +88,7 @@ public:
     typedef std::vector<GCodeMove> GCodeMovesList;
     typedef std::map<GCodeMove::EType, GCodeMovesList> TypeToMovesMap;
     typedef std::map<unsigned int, Vec2d> ExtruderOffsetsMap;
+    typedef std::function<void(const GCodeMove&)> MoveCallback;
 
 private:
     struct State
@@ -109,6 +110,7 @@ private:
     TypeToMovesMap m_moves_map;
     ExtruderOffsetsMap m_extruder_offsets;
     GCodeFlavor m_gcode_flavor;
+    MoveCallback m_move_callback;
 
     // The output of process_layer()
     std::string m_process_output;
@@ -120,12 +122,20 @@ public:
 
     void set_gcode_flavor(const GCodeFlavor& flavor);
 
+    // If set, the moves are passed to the callback instead of being stored for calc_gcode_preview_data(),
+    // so that a G-code of any size is analyzed in bounded memory.
+    void set_move_callback(MoveCallback callback) { m_move_callback = callback; }
+
     // Reinitialize the analyzer
     void reset();
 
     // Adds the gcode contained in the given string to the analysis and returns it after removing the workcodes
     const std::string& process_gcode(const std::string& gcode);
 
+    // Adds a single gcode line, already parsed by the caller, to the analysis.
+    // Returns false if the line is a workcode to be removed from the gcode.
+    bool process_gcode_line(const GCodeReader::GCodeLine& line);
+
     // Calculates all data needed for gcode visualization
     // throws CanceledException through print->throw_if_canceled() (sent by the caller as callback).
     void calc_gcode_preview_data(GCodePreviewData& preview_data, std::function<void()> cancel_callback = std::function<void()>());
@@ -137,7 +147,8 @@ public:
 
 private:
     // Processes the given gcode line
-    void _process_gcode_line(GCodeReader& reader, const GCodeReader::GCodeLine& line);
+    // Returns false if the line is a workcode to be removed from the gcode
+    bool _process_gcode_line(const GCodeReader::GCodeLine& line);
 
     // Move
     void _processG1(const GCodeReader::GCodeLine& line);
@@ -179,7 +190,7 @@ private:
     void _processM402(const GCodeReader::GCodeLine& line);
 
     // Processes T line (Select Tool)
-    void _processT(const std::string& command);
+    void _processT(const boost::string_view& command);
     void _processT(const GCodeReader::GCodeLine& line);
 
     // Processes the tags
@@ -187,16 +198,16 @@ private:
     bool _process_tags(const GCodeReader::GCodeLine& line);
 
     // Processes extrusion role tag
-    void _process_extrusion_role_tag(const std::string& comment, size_t pos);
+    void _process_extrusion_role_tag(const boost::string_view& comment, size_t pos);
 
     // Processes mm3_per_mm tag
-    void _process_mm3_per_mm_tag(const std::string& comment, size_t pos);
+    void _process_mm3_per_mm_tag(const boost::string_view& comment, size_t pos);
 
     // Processes width tag
-    void _process_width_tag(const std::string& comment, size_t pos);
+    void _process_width_tag(const boost::string_view& comment, size_t pos);
 
     // Processes height tag
-    void _process_height_tag(const std::string& comment, size_t pos);
+    void _process_height_tag(const boost::string_view& comment, size_t pos);
 
     // Processes color change tag
     void _process_color_change_tag();
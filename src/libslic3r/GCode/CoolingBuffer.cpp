@@ -2,6 +2,7 @@
 #include "CoolingBuffer.hpp"
 #include <boost/algorithm/string/predicate.hpp>
 #include <boost/algorithm/string/replace.hpp>
+#include <boost/utility/string_view.hpp>
 #include <iostream>
 #include <float.h>
 
@@ -15,19 +16,20 @@
 
 namespace Slic3r {
 
-CoolingBuffer::CoolingBuffer(GCode &gcodegen) : m_gcodegen(gcodegen), m_current_extruder(0)
+CoolingBuffer::CoolingBuffer(GCode &gcodegen) : m_gcodegen(gcodegen)
 {
+    m_current.extruder = 0;
     this->reset();
 }
 
 void CoolingBuffer::reset()
 {
-    m_current_pos.assign(5, 0.f);
     Vec3d pos = m_gcodegen.writer().get_position();
-    m_current_pos[0] = float(pos(0));
-    m_current_pos[1] = float(pos(1));
-    m_current_pos[2] = float(pos(2));
-    m_current_pos[4] = float(m_gcodegen.config().travel_speed.value);
+    m_current.pos[0] = float(pos(0));
+    m_current.pos[1] = float(pos(1));
+    m_current.pos[2] = float(pos(2));
+    m_current.pos[3] = 0.f;
+    m_current.pos[4] = float(m_gcodegen.config().travel_speed.value);
 }
 
 struct CoolingLine
@@ -280,14 +282,92 @@ finished:
 
 std::string CoolingBuffer::process_layer(const std::string &gcode, size_t layer_id)
 {
-    std::vector<PerExtruderAdjustments> per_extruder_adjustments = this->parse_layer_gcode(gcode, m_current_pos);
+    Layer layer;
+    layer.layer_id = layer_id;
+    this->scan_layer(gcode, layer);
+    this->begin_layer(layer);
+    std::string out = this->adjust_layer(gcode, layer);
+    this->commit_layer(layer, out);
+    return out;
+}
+
+// Parse the axes of a G0, G1 or G92 line into pos, starting after the command up to the comment or the end of the line.
+// Returns the mask of the axes set. The feedrate is converted from mm/min to mm/sec.
+static unsigned int parse_axes(const char *c, const char extrusion_axis, float *pos)
+{
+    unsigned int mask = 0;
+    for (;;) {
+        // Skip whitespaces.
+        for (; *c == ' ' || *c == '\t'; ++ c);
+        if (*c == 0 || *c == ';' || *c == '\n')
+            break;
+        // Parse the axis.
+        size_t axis = (*c >= 'X' && *c <= 'Z') ? (*c - 'X') :
+                      (*c == extrusion_axis) ? 3 : (*c == 'F') ? 4 : size_t(-1);
+        if (axis != size_t(-1)) {
+            pos[axis] = float(atof(++c));
+            if (axis == 4)
+                // Convert mm/min to mm/sec.
+                pos[4] /= 60.f;
+            mask |= 1 << axis;
+        }
+        // Skip this word.
+        for (; *c != ' ' && *c != '\t' && *c != 0 && *c != '\n'; ++ c);
+    }
+    return mask;
+}
+
+void CoolingBuffer::scan_layer(const std::string &gcode, Layer &layer) const
+{
+    const std::string toolchange_prefix = m_gcodegen.writer().toolchange_prefix();
+    const char        extrusion_axis    = m_gcodegen.config().get_extrusion_axis()[0];
+    layer.set_mask = 0;
+    for (const char *line_start = gcode.c_str(); *line_start != 0;) {
+        const char *line_end = strchr(line_start, '\n');
+        if (line_end == nullptr)
+            line_end = gcode.c_str() + gcode.size();
+        boost::string_view sline(line_start, line_end - line_start);
+        if (boost::starts_with(sline, "G0 ") || boost::starts_with(sline, "G1 ") || boost::starts_with(sline, "G92 ")) {
+            layer.set_mask |= parse_axes(line_start + 3, extrusion_axis, layer.set.pos);
+        } else if (boost::starts_with(sline, toolchange_prefix)) {
+            layer.set.extruder = (unsigned int)atoi(line_start + toolchange_prefix.size());
+            layer.set_mask |= 1 << 5;
+        }
+        line_start = (*line_end == '\n') ? line_end + 1 : line_end;
+    }
+}
+
+void CoolingBuffer::begin_layer(Layer &layer)
+{
+    layer.start = m_current;
+    for (size_t axis = 0; axis < 5; ++ axis)
+        if (layer.set_mask & (1 << axis))
+            m_current.pos[axis] = layer.set.pos[axis];
+    if (layer.set_mask & (1 << 5))
+        m_current.extruder = layer.set.extruder;
+}
+
+std::string CoolingBuffer::adjust_layer(const std::string &gcode, Layer &layer) const
+{
+    std::vector<PerExtruderAdjustments> per_extruder_adjustments = this->parse_layer_gcode(gcode, layer.start);
     float layer_time_stretched = this->calculate_layer_slowdown(per_extruder_adjustments);
-    return this->apply_layer_cooldown(gcode, layer_id, layer_time_stretched, per_extruder_adjustments);
+    return this->apply_layer_cooldown(gcode, layer, layer_time_stretched, per_extruder_adjustments);
+}
+
+void CoolingBuffer::commit_layer(const Layer &layer, std::string &gcode)
+{
+    GCodeWriter &writer = m_gcodegen.writer();
+    std::string  fan_gcode = writer.set_fan((unsigned int)layer.fan_speed_start);
+    if (! fan_gcode.empty())
+        gcode.insert(0, fan_gcode);
+    // The fan speed changes inside the layer have been emitted by adjust_layer() already.
+    if (layer.fan_speed_end != layer.fan_speed_start)
+        writer.set_fan((unsigned int)layer.fan_speed_end);
 }
 
 // Parse the layer G-code for the moves, which could be adjusted.
 // Return the list of parsed lines, bucketed by an extruder.
-std::vector<PerExtruderAdjustments> CoolingBuffer::parse_layer_gcode(const std::string &gcode, std::vector<float> &current_pos) const
+std::vector<PerExtruderAdjustments> CoolingBuffer::parse_layer_gcode(const std::string &gcode, const State &start) const
 {
     const FullPrintConfig       &config        = m_gcodegen.config();
     const std::vector<Extruder> &extruders     = m_gcodegen.writer().extruders();
@@ -308,7 +388,9 @@ std::vector<PerExtruderAdjustments> CoolingBuffer::parse_layer_gcode(const std::
     }
 
     const std::string toolchange_prefix = m_gcodegen.writer().toolchange_prefix();
-    unsigned int      current_extruder  = m_current_extruder;
+    unsigned int      current_extruder  = start.extruder;
+    float             current_pos[5];
+    memcpy(current_pos, start.pos, sizeof(current_pos));
     PerExtruderAdjustments *adjustment  = &per_extruder_adjustments[map_extruder_to_per_extruder_adjustment[current_extruder]];
     const char       *line_start = gcode.c_str();
     const char       *line_end   = line_start;
@@ -321,8 +403,9 @@ std::vector<PerExtruderAdjustments> CoolingBuffer::parse_layer_gcode(const std::
     {
         while (*line_end != '\n' && *line_end != 0)
             ++ line_end;
-        // sline will not contain the trailing '\n'.
-        std::string sline(line_start, line_end);
+        // sline will not contain the trailing '\n'. It references the source G-code, which continues
+        // with the new line or with the terminating zero, therefore the numbers may be parsed in place.
+        boost::string_view sline(line_start, line_end - line_start);
         // CoolingLine will contain the trailing '\n'.
         if (*line_end == '\n')
             ++ line_end;
@@ -336,29 +419,11 @@ std::vector<PerExtruderAdjustments> CoolingBuffer::parse_layer_gcode(const std::
         if (line.type) {
             // G0, G1 or G92
             // Parse the G-code line.
-            std::vector<float> new_pos(current_pos);
-            const char *c = sline.data() + 3;
-            for (;;) {
-                // Skip whitespaces.
-                for (; *c == ' ' || *c == '\t'; ++ c);
-                if (*c == 0 || *c == ';')
-                    break;
-                // Parse the axis.
-                size_t axis = (*c >= 'X' && *c <= 'Z') ? (*c - 'X') :
-                              (*c == extrusion_axis) ? 3 : (*c == 'F') ? 4 : size_t(-1);
-                if (axis != size_t(-1)) {
-                    new_pos[axis] = float(atof(++c));
-                    if (axis == 4) {
-                        // Convert mm/min to mm/sec.
-                        new_pos[4] /= 60.f;
-                        if ((line.type & CoolingLine::TYPE_G92) == 0)
-                            // This is G0 or G1 line and it sets the feedrate. This mark is used for reducing the duplicate F calls.
-                            line.type |= CoolingLine::TYPE_HAS_F;
-                    }
-                }
-                // Skip this word.
-                for (; *c != ' ' && *c != '\t' && *c != 0; ++ c);
-            }
+            float new_pos[5];
+            memcpy(new_pos, current_pos, sizeof(new_pos));
+            if ((parse_axes(sline.data() + 3, extrusion_axis, new_pos) & (1 << 4)) && (line.type & CoolingLine::TYPE_G92) == 0)
+                // This is G0 or G1 line and it sets the feedrate. This mark is used for reducing the duplicate F calls.
+                line.type |= CoolingLine::TYPE_HAS_F;
             bool external_perimeter = boost::contains(sline, ";_EXTERNAL_PERIMETER");
             bool wipe               = boost::contains(sline, ";_WIPE");
             if (external_perimeter)
@@ -410,14 +475,14 @@ std::vector<PerExtruderAdjustments> CoolingBuffer::parse_layer_gcode(const std::
                     line.type = 0;
                 }
             }
-            current_pos = std::move(new_pos);
+            memcpy(current_pos, new_pos, sizeof(current_pos));
         } else if (boost::starts_with(sline, ";_EXTRUDE_END")) {
             line.type = CoolingLine::TYPE_EXTRUDE_END;
             active_speed_modifier = size_t(-1);
         } else if (boost::starts_with(sline, toolchange_prefix)) {
             // Switch the tool.
             line.type = CoolingLine::TYPE_SET_TOOL;
-            unsigned int new_extruder = (unsigned int)atoi(sline.c_str() + toolchange_prefix.size());
+            unsigned int new_extruder = (unsigned int)atoi(sline.data() + toolchange_prefix.size());
             if (new_extruder != current_extruder) {
                 current_extruder = new_extruder;
                 adjustment         = &per_extruder_adjustments[map_extruder_to_per_extruder_adjustment[current_extruder]];
@@ -432,8 +497,8 @@ std::vector<PerExtruderAdjustments> CoolingBuffer::parse_layer_gcode(const std::
             size_t pos_S = sline.find('S', 3);
             size_t pos_P = sline.find('P', 3);
             line.time = line.time_max = float(
-                (pos_S > 0) ? atof(sline.c_str() + pos_S + 1) :
-                (pos_P > 0) ? atof(sline.c_str() + pos_P + 1) * 0.001 : 0.);
+                (pos_S > 0) ? atof(sline.data() + pos_S + 1) :
+                (pos_P > 0) ? atof(sline.data() + pos_P + 1) * 0.001 : 0.);
         }
         if (line.type != 0)
             adjustment->lines.emplace_back(std::move(line));
@@ -578,7 +643,7 @@ static inline void extruder_range_slow_down_non_proportional(
 }
 
 // Calculate slow down for all the extruders.
-float CoolingBuffer::calculate_layer_slowdown(std::vector<PerExtruderAdjustments> &per_extruder_adjustments)
+float CoolingBuffer::calculate_layer_slowdown(std::vector<PerExtruderAdjustments> &per_extruder_adjustments) const
 {
     // Sort the extruders by an increasing slowdown_below_layer_time.
     // The layers with a lower slowdown_below_layer_time are slowed down
@@ -643,11 +708,12 @@ std::string CoolingBuffer::apply_layer_cooldown(
     // Source G-code for the current layer.
     const std::string                      &gcode,
     // ID of the current layer, used to disable fan for the first n layers.
-    size_t                                  layer_id, 
+    // The extruder at the start of the layer is taken from layer.start, the fan speeds set are stored into the layer.
+    Layer                                  &layer, 
     // Total time of this layer after slow down, used to control the fan.
     float                                   layer_time,
     // Per extruder list of G-code lines and their cool down attributes.
-    std::vector<PerExtruderAdjustments>    &per_extruder_adjustments)
+    std::vector<PerExtruderAdjustments>    &per_extruder_adjustments) const
 {
     // First sort the adjustment lines by of multiple extruders by their position in the source G-code.
     std::vector<const CoolingLine*> lines;
@@ -667,9 +733,12 @@ std::string CoolingBuffer::apply_layer_cooldown(
     int  fan_speed          = -1;
     bool bridge_fan_control = false;
     int  bridge_fan_speed   = 0;
-    auto change_extruder_set_fan = [ this, layer_id, layer_time, &new_gcode, &fan_speed, &bridge_fan_control, &bridge_fan_speed ]() {
+    const GCodeWriter  &writer           = m_gcodegen.writer();
+    unsigned int        current_extruder = layer.start.extruder;
+    size_t              layer_id         = layer.layer_id;
+    auto change_extruder_set_fan = [ this, &writer, &current_extruder, layer_id, layer_time, &new_gcode, &fan_speed, &bridge_fan_control, &bridge_fan_speed ]() {
         const FullPrintConfig &config = m_gcodegen.config();
-#define EXTRUDER_CONFIG(OPT) config.OPT.get_at(m_current_extruder)
+#define EXTRUDER_CONFIG(OPT) config.OPT.get_at(current_extruder)
         int min_fan_speed = EXTRUDER_CONFIG(min_fan_speed);
         int fan_speed_new = EXTRUDER_CONFIG(fan_always_on) ? min_fan_speed : 0;
         if (layer_id >= (size_t)EXTRUDER_CONFIG(disable_fan_first_layers)) {
@@ -696,15 +765,18 @@ std::string CoolingBuffer::apply_layer_cooldown(
             fan_speed_new      = 0;
         }
         if (fan_speed_new != fan_speed) {
+            // The fan speed at the start of the layer is set by commit_layer(), only if it differs from the fan speed of the previous layer.
+            if (fan_speed != -1)
+                new_gcode += writer.fan_gcode(fan_speed_new);
             fan_speed = fan_speed_new;
-            new_gcode += m_gcodegen.writer().set_fan(fan_speed);
         }
     };
 
     const char         *pos               = gcode.c_str();
     int                 current_feedrate  = 0;
-    const std::string   toolchange_prefix = m_gcodegen.writer().toolchange_prefix();
+    const std::string   toolchange_prefix = writer.toolchange_prefix();
     change_extruder_set_fan();
+    layer.fan_speed_start = fan_speed;
     for (const CoolingLine *line : lines) {
         const char *line_start  = gcode.c_str() + line->line_start;
         const char *line_end    = gcode.c_str() + line->line_end;
@@ -712,17 +784,17 @@ std::string CoolingBuffer::apply_layer_cooldown(
             new_gcode.append(pos, line_start - pos);
         if (line->type & CoolingLine::TYPE_SET_TOOL) {
             unsigned int new_extruder = (unsigned int)atoi(line_start + toolchange_prefix.size());
-            if (new_extruder != m_current_extruder) {
-                m_current_extruder = new_extruder;
+            if (new_extruder != current_extruder) {
+                current_extruder = new_extruder;
                 change_extruder_set_fan();
             }
             new_gcode.append(line_start, line_end - line_start);
         } else if (line->type & CoolingLine::TYPE_BRIDGE_FAN_START) {
             if (bridge_fan_control)
-                new_gcode += m_gcodegen.writer().set_fan(bridge_fan_speed, true);
+                new_gcode += writer.fan_gcode(bridge_fan_speed);
         } else if (line->type & CoolingLine::TYPE_BRIDGE_FAN_END) {
             if (bridge_fan_control)
-                new_gcode += m_gcodegen.writer().set_fan(fan_speed, true);
+                new_gcode += writer.fan_gcode(fan_speed);
         } else if (line->type & CoolingLine::TYPE_EXTRUDE_END) {
             // Just remove this comment.
         } else if (line->type & (CoolingLine::TYPE_ADJUSTABLE | CoolingLine::TYPE_EXTERNAL_PERIMETER | CoolingLine::TYPE_WIPE | CoolingLine::TYPE_HAS_F)) {
@@ -799,6 +871,7 @@ std::string CoolingBuffer::apply_layer_cooldown(
     const char *gcode_end = gcode.c_str() + gcode.size();
     if (pos < gcode_end)
         new_gcode.append(pos, gcode_end - pos);
+    layer.fan_speed_end = fan_speed;
 
     return new_gcode;
 }
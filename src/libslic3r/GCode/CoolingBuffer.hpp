@@ -24,25 +24,55 @@ class CoolingBuffer {
 public:
     CoolingBuffer(GCode &gcodegen);
     void        reset();
-    void        set_current_extruder(unsigned int extruder_id) { m_current_extruder = extruder_id; }
+    void        set_current_extruder(unsigned int extruder_id) { m_current.extruder = extruder_id; }
+    // Process a layer at once: scan_layer(), begin_layer(), adjust_layer() and commit_layer() called in a row.
     std::string process_layer(const std::string &gcode, size_t layer_id);
     GCode* 	    gcodegen() { return &m_gcodegen; }
 
+    // The processing of a layer split into steps, so that the slow down of multiple layers may be calculated concurrently.
+    // The cooling of a layer depends on the previous layers only through the print head position, the extruder
+    // and the fan speed at the start of the layer. scan_layer() and adjust_layer() do not modify the CoolingBuffer,
+    // they may be called for multiple layers concurrently. begin_layer() and commit_layer() pass the state
+    // from layer to layer, they are cheap and they have to be called for one layer after the other in the print order.
+    struct State {
+        // X,Y,Z,E,F
+        float           pos[5];
+        unsigned int    extruder;
+    };
+    struct Layer {
+        size_t          layer_id        = 0;
+        // Mask of the axes (bits 0 to 4) and of the extruder (bit 5) set by the G-code of this layer,
+        // and their values at the end of the layer. Filled in by scan_layer().
+        unsigned int    set_mask        = 0;
+        State           set;
+        // State at the start of this layer. Filled in by begin_layer().
+        State           start;
+        // Fan speed set at the start and at the end of this layer. Filled in by adjust_layer().
+        int             fan_speed_start = -1;
+        int             fan_speed_end   = -1;
+    };
+    // Collect the axes and the extruder set by the layer.
+    void        scan_layer(const std::string &gcode, Layer &layer) const;
+    // Assign the state at the start of the layer, advance the state to the end of the layer.
+    void        begin_layer(Layer &layer);
+    // Adjust the feedrates and the fan of the layer starting with layer.start. Returns the adjusted G-code
+    // without the fan speed setting at its start, which depends on the fan speed set by the previous layer.
+    std::string adjust_layer(const std::string &gcode, Layer &layer) const;
+    // Prepend the fan speed setting to the adjusted G-code if the fan speed changes, remember the fan speed at the end of the layer.
+    void        commit_layer(const Layer &layer, std::string &gcode);
+
 private:
 	CoolingBuffer& operator=(const CoolingBuffer&) = delete;
-    std::vector<PerExtruderAdjustments> parse_layer_gcode(const std::string &gcode, std::vector<float> &current_pos) const;
-    float       calculate_layer_slowdown(std::vector<PerExtruderAdjustments> &per_extruder_adjustments);
+    std::vector<PerExtruderAdjustments> parse_layer_gcode(const std::string &gcode, const State &start) const;
+    float       calculate_layer_slowdown(std::vector<PerExtruderAdjustments> &per_extruder_adjustments) const;
     // Apply slow down over G-code lines stored in per_extruder_adjustments, enable fan if needed.
     // Returns the adjusted G-code.
-    std::string apply_layer_cooldown(const std::string &gcode, size_t layer_id, float layer_time, std::vector<PerExtruderAdjustments> &per_extruder_adjustments);
+    std::string apply_layer_cooldown(const std::string &gcode, Layer &layer, float layer_time, std::vector<PerExtruderAdjustments> &per_extruder_adjustments) const;
 
     GCode&              m_gcodegen;
-    std::string         m_gcode;
     // Internal data.
-    // X,Y,Z,E,F
-    std::vector<char>   m_axis;
-    std::vector<float>  m_current_pos;
-    unsigned int        m_current_extruder;
+    // Position and extruder at the start of the next layer.
+    State               m_current;
 
     // Old logic: proportional.
     bool                m_cooling_logic_proportional = false;
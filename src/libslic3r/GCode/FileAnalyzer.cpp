@@ -0,0 +1,282 @@
+#include "FileAnalyzer.hpp"
+
+#include "../GCodeReader.hpp"
+#include "../GCodeTimeEstimator.hpp"
+#include "Analyzer.hpp"
+#include "PreviewData.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <stdexcept>
+
+#include <boost/filesystem/operations.hpp>
+
+namespace Slic3r {
+
+// Z difference of two layers to be considered different layers.
+static const float LAYER_Z_EPSILON = 0.001f;
+// Minimum layer height for the G-codes without the layer change markers, if the configuration does not set it.
+static const float DEFAULT_MIN_LAYER_HEIGHT = 0.05f;
+
+void GCodeFileAnalyzer::analyze(const std::string &path, const DynamicPrintConfig &config)
+{
+    PrintConfig print_config;
+    print_config.apply(config, true);
+
+    *this = GCodeFileAnalyzer();
+    this->path         = path;
+    this->gcode_flavor = print_config.gcode_flavor.value;
+    boost::system::error_code ec;
+    this->file_size    = boost::filesystem::file_size(path, ec);
+    if (ec)
+        throw std::runtime_error(std::string("Failed to read the G-code file ") + path + ": " + ec.message());
+
+    // Time estimators configured the same way GCode::_do_export() configures them.
+    GCodeTimeEstimator normal_time_estimator(GCodeTimeEstimator::Normal);
+    GCodeTimeEstimator silent_time_estimator(GCodeTimeEstimator::Silent);
+    this->silent_time_valid = print_config.gcode_flavor.value == gcfMarlin && print_config.silent_mode.value;
+    for (GCodeTimeEstimator *estimator : { &normal_time_estimator, &silent_time_estimator }) {
+        estimator->set_dialect(print_config.gcode_flavor.value);
+        if (print_config.gcode_flavor.value == gcfMarlin)
+            estimator->set_machine_limits(print_config);
+        if (print_config.single_extruder_multi_material.value) {
+            estimator->set_filament_load_times(print_config.filament_load_time.values);
+            estimator->set_filament_unload_times(print_config.filament_unload_time.values);
+        }
+        // The times are accumulated while parsing, the blocks are not retained.
+        estimator->set_keep_blocks(false);
+    }
+
+    GCodeAnalyzer analyzer;
+    analyzer.set_gcode_flavor(print_config.gcode_flavor.value);
+    GCodeAnalyzer::ExtruderOffsetsMap extruder_offsets;
+    for (size_t extruder_id = 0; extruder_id < print_config.extruder_offset.values.size(); ++ extruder_id) {
+        Vec2d offset = print_config.extruder_offset.values[extruder_id];
+        if (! offset.isApprox(Vec2d::Zero()))
+            extruder_offsets[(unsigned int)extruder_id] = offset;
+    }
+    analyzer.set_extruder_offsets(extruder_offsets);
+
+    // The layers are kept sorted by Z. An extrusion returning to the Z of an existing layer
+    // (the next object printed sequentially) is accumulated into that layer.
+    auto layer_at = [this](float z) -> size_t {
+        auto it = std::lower_bound(this->layers.begin(), this->layers.end(), z - LAYER_Z_EPSILON,
+            [](const LayerStats &layer, float z) { return layer.z < z; });
+        if (it == this->layers.end() || it->z > z + LAYER_Z_EPSILON) {
+            it = this->layers.emplace(it);
+            it->z = z;
+        }
+        return size_t(it - this->layers.begin());
+    };
+
+    // PrusaSlicer marks the layer changes with ";LAYER_CHANGE" and ";Z:<z>", Cura with ";LAYER:<n>".
+    // Once a marker was seen, a layer starts with the first extrusion after a marker, so that the continuously
+    // rising Z of a spiral vase or the Z of a Z-hop does not start new layers. Without the markers, a layer starts
+    // with an extrusion at least the minimum layer height above or below the current layer.
+    bool   layer_markers   = false;
+    bool   layer_change    = false;
+    bool   layer_z_valid   = false;
+    float  layer_z         = 0.f;
+    float  min_layer_height = print_config.min_layer_height.values.empty() ? 0.f :
+        float(*std::min_element(print_config.min_layer_height.values.begin(), print_config.min_layer_height.values.end()));
+    if (min_layer_height < DEFAULT_MIN_LAYER_HEIGHT * 0.5f)
+        min_layer_height = DEFAULT_MIN_LAYER_HEIGHT;
+
+    // Summarize the moves instead of storing them.
+    // Index of the layer of the last extrusion.
+    size_t layer_id = size_t(-1);
+    analyzer.set_move_callback([this, &layer_at, &layer_id, &layer_markers, &layer_change, &layer_z_valid, &layer_z, min_layer_height]
+        (const GCodeAnalyzer::GCodeMove &move) {
+        switch (move.type) {
+        case GCodeAnalyzer::GCodeMove::Retract:
+            ++ this->retractions;
+            if (layer_id != size_t(-1))
+                ++ this->layers[layer_id].retractions;
+            return;
+        case GCodeAnalyzer::GCodeMove::Tool_change:
+            ++ this->tool_changes;
+            return;
+        case GCodeAnalyzer::GCodeMove::Move:
+        case GCodeAnalyzer::GCodeMove::Extrude:
+            break;
+        default:
+            return;
+        }
+        double length = (move.end_position - move.start_position).norm();
+        // The GCodeAnalyzer classifies the extrusions without the extrusion role, width and height annotations
+        // of a PrusaSlicer G-code as moves.
+        if (move.delta_extruder > 0.f && (move.end_position.x() != move.start_position.x() || move.end_position.y() != move.start_position.y())) {
+            float z = float(move.end_position.z());
+            if (layer_id == size_t(-1) || layer_change ||
+                (! layer_markers && std::abs(z - this->layers[layer_id].z) > min_layer_height - LAYER_Z_EPSILON)) {
+                layer_id = layer_at((layer_change && layer_z_valid) ? layer_z : z);
+                layer_change = false;
+            }
+            LayerStats &layer = this->layers[layer_id];
+            ++ layer.extrusions;
+            layer.extrusion_length += length;
+            layer.filament_length  += move.delta_extruder;
+            unsigned int extruder_id = move.data.extruder_id;
+            if (extruder_id >= this->extruders.size())
+                this->extruders.resize(extruder_id + 1);
+            this->extruders[extruder_id].filament_length += move.delta_extruder;
+            ExtrusionRole role = (move.data.extrusion_role < erCount) ? move.data.extrusion_role : erNone;
+            this->roles[role].extrusion_length += length;
+            this->roles[role].filament_length  += move.delta_extruder;
+            this->extrusion_bbox.merge(move.start_position);
+            this->extrusion_bbox.merge(move.end_position);
+        } else if (length > 0.) {
+            ++ this->travels;
+            this->travel_length += length;
+            if (layer_id != size_t(-1)) {
+                ++ this->layers[layer_id].travels;
+                this->layers[layer_id].travel_length += length;
+            }
+        }
+    });
+
+    GCodeReader reader;
+    reader.apply_config(print_config);
+    bool silent = this->silent_time_valid;
+    if (! reader.parse_file(path, [this, &analyzer, &normal_time_estimator, &silent_time_estimator, silent, &layer_markers, &layer_change, &layer_z_valid, &layer_z]
+            (GCodeReader&, const GCodeReader::GCodeLine &line) {
+            ++ this->lines;
+            boost::string_view comment = line.comment();
+            if (comment.size() >= 2 && line.cmd().empty()) {
+                if (comment.substr(0, 12) == "LAYER_CHANGE" || comment.substr(0, 6) == "LAYER:") {
+                    layer_markers = layer_change = true;
+                    layer_z_valid = false;
+                } else if (comment.substr(0, 2) == "Z:") {
+                    layer_markers = layer_change = layer_z_valid = true;
+                    layer_z = float(strtod(comment.data() + 2, nullptr));
+                }
+            }
+            analyzer.process_gcode_line(line);
+            normal_time_estimator.add_gcode_line(line);
+            if (silent)
+                silent_time_estimator.add_gcode_line(line);
+        }))
+        throw std::runtime_error(std::string("Failed to read the G-code file ") + path);
+
+    for (size_t i = 0; i < this->layers.size(); ++ i)
+        this->layers[i].height = this->layers[i].z - ((i == 0) ? 0.f : this->layers[i - 1].z);
+
+    normal_time_estimator.calculate_time(false);
+    this->normal_time.time        = normal_time_estimator.get_time();
+    this->normal_time.time_dhms   = normal_time_estimator.get_time_dhms();
+    this->normal_time.color_times = normal_time_estimator.get_color_times();
+    if (silent) {
+        silent_time_estimator.calculate_time(false);
+        this->silent_time.time        = silent_time_estimator.get_time();
+        this->silent_time.time_dhms   = silent_time_estimator.get_time_dhms();
+        this->silent_time.color_times = silent_time_estimator.get_color_times();
+    }
+
+    // Same as the print statistics of a G-code export.
+    for (size_t extruder_id = 0; extruder_id < this->extruders.size(); ++ extruder_id) {
+        ExtruderStats &stats = this->extruders[extruder_id];
+        double diameter = print_config.filament_diameter.get_at(extruder_id);
+        stats.filament_volume = stats.filament_length * 0.25 * PI * diameter * diameter;
+        stats.filament_weight = stats.filament_volume * print_config.filament_density.get_at(extruder_id) * 0.001;
+        stats.filament_cost   = stats.filament_weight * print_config.filament_cost.get_at(extruder_id) * 0.001;
+    }
+}
+
+// Write a string as a JSON string literal.
+static void export_json_string(std::ostream &out, const std::string &str)
+{
+    out << '"';
+    for (char c : str) {
+        switch (c) {
+        case '"':  out << "\\\""; break;
+        case '\\': out << "\\\\"; break;
+        case '\n': out << "\\n"; break;
+        case '\r': out << "\\r"; break;
+        case '\t': out << "\\t"; break;
+        default:
+            if ((unsigned char)c < 0x20)
+                out << "\\u" << std::hex << std::setw(4) << std::setfill('0') << int(c) << std::dec << std::setfill(' ');
+            else
+                out << c;
+        }
+    }
+    out << '"';
+}
+
+static void export_json_time(std::ostream &out, const GCodeFileAnalyzer::TimeStats &stats)
+{
+    out << "{ \"seconds\": " << stats.time << ", \"dhms\": ";
+    export_json_string(out, stats.time_dhms);
+    out << ", \"color_times\": [";
+    for (size_t i = 0; i < stats.color_times.size(); ++ i)
+        out << (i == 0 ? "" : ", ") << stats.color_times[i];
+    out << "] }";
+}
+
+void GCodeFileAnalyzer::export_json(std::ostream &out) const
+{
+    std::ios_base::fmtflags flags = out.flags();
+    std::streamsize         precision = out.precision();
+    out << std::fixed << std::setprecision(3);
+
+    out << "{\n\"file\": ";
+    export_json_string(out, this->path);
+    out << ",\n\"file_size\": " << this->file_size;
+    out << ",\n\"lines\": " << this->lines;
+    out << ",\n\"gcode_flavor\": ";
+    export_json_string(out, ConfigOptionEnum<GCodeFlavor>(this->gcode_flavor).serialize());
+
+    out << ",\n\"estimated_printing_time\": {\n  \"normal\": ";
+    export_json_time(out, this->normal_time);
+    if (this->silent_time_valid) {
+        out << ",\n  \"silent\": ";
+        export_json_time(out, this->silent_time);
+    }
+    out << "\n}";
+
+    out << ",\n\"extruders\": [";
+    for (size_t extruder_id = 0; extruder_id < this->extruders.size(); ++ extruder_id) {
+        const ExtruderStats &stats = this->extruders[extruder_id];
+        out << (extruder_id == 0 ? "\n" : ",\n") << "  { \"id\": " << extruder_id <<
+            ", \"filament_length_mm\": " << stats.filament_length << ", \"filament_volume_mm3\": " << stats.filament_volume <<
+            ", \"filament_weight_g\": " << stats.filament_weight << ", \"filament_cost\": " << stats.filament_cost << " }";
+    }
+    out << "\n]";
+
+    out << ",\n\"extrusion_roles\": [";
+    bool first = true;
+    for (size_t role = 0; role < size_t(erCount); ++ role)
+        if (this->roles[role].filament_length > 0.) {
+            out << (first ? "\n" : ",\n") << "  { \"role\": ";
+            export_json_string(out, GCodePreviewData::Extrusion::Default_Extrusion_Role_Names[role]);
+            out << ", \"extrusion_length_mm\": " << this->roles[role].extrusion_length <<
+                ", \"filament_length_mm\": " << this->roles[role].filament_length << " }";
+            first = false;
+        }
+    out << "\n]";
+
+    out << ",\n\"travels\": " << this->travels << ", \"travel_length_mm\": " << this->travel_length;
+    out << ",\n\"retractions\": " << this->retractions << ", \"tool_changes\": " << this->tool_changes;
+    if (this->extrusion_bbox.defined)
+        out << ",\n\"extrusion_bounding_box\": { \"min\": [" <<
+            this->extrusion_bbox.min.x() << ", " << this->extrusion_bbox.min.y() << ", " << this->extrusion_bbox.min.z() << "], \"max\": [" <<
+            this->extrusion_bbox.max.x() << ", " << this->extrusion_bbox.max.y() << ", " << this->extrusion_bbox.max.z() << "] }";
+
+    // One line per layer.
+    out << ",\n\"layers\": [";
+    for (size_t i = 0; i < this->layers.size(); ++ i) {
+        const LayerStats &layer = this->layers[i];
+        out << (i == 0 ? "\n" : ",\n") << "  { \"z\": " << layer.z << ", \"height\": " << layer.height <<
+            ", \"extrusions\": " << layer.extrusions << ", \"extrusion_length_mm\": " << layer.extrusion_length <<
+            ", \"filament_length_mm\": " << layer.filament_length << ", \"travels\": " << layer.travels <<
+            ", \"travel_length_mm\": " << layer.travel_length << ", \"retractions\": " << layer.retractions << " }";
+    }
+    out << "\n]\n}\n";
+
+    out.flags(flags);
+    out.precision(precision);
+}
+
+} // namespace Slic3r
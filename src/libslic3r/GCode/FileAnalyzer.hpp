@@ -0,0 +1,95 @@
+#ifndef slic3r_GCode_FileAnalyzer_hpp_
+#define slic3r_GCode_FileAnalyzer_hpp_
+
+#include "../libslic3r.h"
+#include "../BoundingBox.hpp"
+#include "../ExtrusionEntity.hpp"
+#include "../PrintConfig.hpp"
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace Slic3r {
+
+// Analysis of an existing G-code file, possibly exported by a third party slicer.
+// The file is parsed by the GCodeReader once and the lines are passed to the GCodeAnalyzer and to the time estimators,
+// none of them retaining the moves, so that a G-code of any size is analyzed in bounded memory.
+// The GCodePreviewData for the visualization are not produced, as their size is proportional to the G-code size,
+// the extrusions are summarized per extrusion role and per layer instead.
+class GCodeFileAnalyzer
+{
+public:
+    struct ExtruderStats
+    {
+        // Length of the filament extruded, in mm.
+        double filament_length = 0.;
+        // Volume of the filament extruded, in mm^3.
+        double filament_volume = 0.;
+        // Weight of the filament extruded, in grams.
+        double filament_weight = 0.;
+        double filament_cost   = 0.;
+    };
+
+    struct RoleStats
+    {
+        // Length of the extrusion paths, in mm.
+        double extrusion_length = 0.;
+        // Length of the filament extruded, in mm.
+        double filament_length  = 0.;
+    };
+
+    // A layer starts with the first extrusion after a layer change marker of the G-code, or with the first extrusion
+    // at a new Z if the G-code has no markers. The layers are sorted by Z, the objects printed sequentially
+    // share the layers of the same Z.
+    struct LayerStats
+    {
+        float  z                = 0.f;
+        float  height           = 0.f;
+        size_t extrusions       = 0;
+        double extrusion_length = 0.;
+        double filament_length  = 0.;
+        size_t travels          = 0;
+        double travel_length    = 0.;
+        size_t retractions      = 0;
+    };
+
+    struct TimeStats
+    {
+        float               time = 0.f;
+        std::string         time_dhms;
+        std::vector<float>  color_times;
+    };
+
+    // Analyze the G-code file with the printer and filament parameters of the configuration
+    // (the firmware flavor, the machine limits, the filament diameters, densities and costs).
+    // Throws std::runtime_error if the file could not be read.
+    void analyze(const std::string &path, const DynamicPrintConfig &config);
+
+    // Write the statistics as a JSON document.
+    void export_json(std::ostream &out) const;
+
+    std::string                 path;
+    uintmax_t                   file_size   = 0;
+    size_t                      lines       = 0;
+    GCodeFlavor                 gcode_flavor = gcfRepRap;
+    TimeStats                   normal_time;
+    // Valid for the Marlin flavor with the silent mode enabled only.
+    bool                        silent_time_valid = false;
+    TimeStats                   silent_time;
+    // Indexed by the extruder ID.
+    std::vector<ExtruderStats>  extruders;
+    RoleStats                   roles[erCount];
+    std::vector<LayerStats>     layers;
+    size_t                      travels     = 0;
+    double                      travel_length = 0.;
+    size_t                      retractions = 0;
+    size_t                      tool_changes = 0;
+    // Bounding box of the extrusions.
+    BoundingBoxf3               extrusion_bbox;
+};
+
+} // namespace Slic3r
+
+#endif /* slic3r_GCode_FileAnalyzer_hpp_ */
@@ -1,6 +1,9 @@
 #include "GCodeReader.hpp"
 #include <boost/algorithm/string/classification.hpp>
 #include <boost/algorithm/string/split.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
 #include <fstream>
 #include <iostream>
 #include <iomanip>
@@ -75,10 +78,16 @@ const char* GCodeReader::parse_line_internal(const char *ptr, GCodeLine &gline,
     // Skip the rest of the line.
     for (; ! is_end_of_line(*c); ++ c);
 
-    // Copy the raw string including the comment, without the trailing newlines.
-    if (c > ptr) {
-        PROFILE_BLOCK(copy_raw_string);
-        gline.m_raw.assign(ptr, c);
+    // Reference the raw string including the comment, without the trailing newlines.
+    gline.m_raw = boost::string_view(ptr, c - ptr);
+
+    // Split the command to its letter and number.
+    if (command.second - command.first > 1) {
+        gline.m_cmd_letter = char(::toupper(*command.first));
+        gline.m_cmd_number = ::atoi(command.first + 1);
+    } else {
+        gline.m_cmd_letter = 0;
+        gline.m_cmd_number = 0;
     }
 
     // Skip the trailing newlines.
@@ -107,17 +116,67 @@ void GCodeReader::update_coordinates(GCodeLine &gline, std::pair<const char*, co
     }
 }
 
-void GCodeReader::parse_file(const std::string &file, callback_t callback)
+bool GCodeReader::parse_file(const std::string &file, callback_t callback)
 {
-    std::ifstream f(file);
-    std::string line;
-    while (std::getline(f, line))
-        this->parse_line(line, callback);
+    namespace bip = boost::interprocess;
+    // Size of the window of the file mapped into memory at once.
+    size_t window_size = 64 * 1024 * 1024;
+
+    boost::system::error_code ec;
+    uintmax_t file_size = boost::filesystem::file_size(file, ec);
+    if (ec)
+        return false;
+    try {
+        // The first character not parsed yet.
+        uintmax_t offset = 0;
+        bip::file_mapping mapping(file.c_str(), bip::read_only);
+        while (offset < file_size) {
+            size_t size = size_t(std::min<uintmax_t>(window_size, file_size - offset));
+            bip::mapped_region region(mapping, bip::read_only, bip::offset_t(offset), size);
+            region.advise(bip::mapped_region::advice_sequential);
+            const char *begin = static_cast<const char*>(region.get_address());
+            const char *end   = begin + size;
+            // Parse the window up to its last new line, the rest will be parsed with the next window.
+            while (end > begin && end[-1] != '\n')
+                -- end;
+            if (end == begin) {
+                if (offset + size < file_size) {
+                    // A line longer than the window.
+                    window_size *= 2;
+                    continue;
+                }
+                // The last line of the file is not terminated by a new line. Terminate a copy of it.
+                std::string last_line(begin, begin + size);
+                last_line += '\n';
+                this->parse_lines(last_line.data(), last_line.data() + last_line.size(), callback);
+                break;
+            }
+            this->parse_lines(begin, end, callback);
+            offset += end - begin;
+        }
+    } catch (const bip::interprocess_exception &) {
+        return false;
+    }
+    return true;
+}
+
+GCodeReader::GCodeLine& GCodeReader::GCodeLine::operator=(const GCodeLine &rhs)
+{
+    if (this != &rhs) {
+        m_raw_storage = rhs.m_raw_storage;
+        // Reference the own storage if the line was modified, otherwise reference the same buffer.
+        m_raw         = (rhs.m_raw.data() == rhs.m_raw_storage.data()) ? boost::string_view(m_raw_storage) : rhs.m_raw;
+        memcpy(m_axis, rhs.m_axis, sizeof(m_axis));
+        m_mask        = rhs.m_mask;
+        m_cmd_letter  = rhs.m_cmd_letter;
+        m_cmd_number  = rhs.m_cmd_number;
+    }
+    return *this;
 }
 
 bool GCodeReader::GCodeLine::has(char axis) const
 {
-    const char *c = m_raw.c_str();
+    const char *c = m_raw.data();
     // Skip the whitespaces.
     c = skip_whitespaces(c);
     // Skip the command.
@@ -139,7 +198,7 @@ bool GCodeReader::GCodeLine::has(char axis) const
 
 bool GCodeReader::GCodeLine::has_value(char axis, float &value) const
 {
-    const char *c = m_raw.c_str();
+    const char *c = m_raw.data();
     // Skip the whitespaces.
     c = skip_whitespaces(c);
     // Skip the command.
@@ -182,17 +241,21 @@ void GCodeReader::GCodeLine::set(const GCodeReader &reader, const Axis axis, con
         match[1] = reader.extrusion_axis();
     }
 
+    // Copy the line referencing the parsed buffer to the storage of this line before modifying it.
+    if (m_raw.data() != m_raw_storage.data())
+        m_raw_storage.assign(m_raw.data(), m_raw.size());
     if (this->has(axis)) {
-        size_t pos = m_raw.find(match)+2;
-        size_t end = m_raw.find(' ', pos+1);
-        m_raw = m_raw.replace(pos, end-pos, ss.str());
+        size_t pos = m_raw_storage.find(match)+2;
+        size_t end = m_raw_storage.find(' ', pos+1);
+        m_raw_storage.replace(pos, end-pos, ss.str());
     } else {
-        size_t pos = m_raw.find(' ');
+        size_t pos = m_raw_storage.find(' ');
         if (pos == std::string::npos)
-            m_raw += std::string(match) + ss.str();
+            m_raw_storage += std::string(match) + ss.str();
         else
-            m_raw = m_raw.replace(pos, 0, std::string(match) + ss.str());
+            m_raw_storage.replace(pos, 0, std::string(match) + ss.str());
     }
+    m_raw = boost::string_view(m_raw_storage);
     m_axis[axis] = new_value;
     m_mask |= 1 << int(axis);
 }
@@ -6,6 +6,7 @@
 #include <cstdlib>
 #include <functional>
 #include <string>
+#include <boost/utility/string_view.hpp>
 #include "PrintConfig.hpp"
 
 namespace Slic3r {
@@ -15,15 +16,27 @@ public:
     class GCodeLine {
     public:
         GCodeLine() { reset(); }
-        void reset() { m_mask = 0; memset(m_axis, 0, sizeof(m_axis)); m_raw.clear(); }
-
-        const std::string&  raw() const { return m_raw; }
-        const std::string   cmd() const { 
-            const char *cmd = GCodeReader::skip_whitespaces(m_raw.c_str());
-            return std::string(cmd, GCodeReader::skip_word(cmd));
+        GCodeLine(const GCodeLine &rhs) { *this = rhs; }
+        GCodeLine& operator=(const GCodeLine &rhs);
+        void reset() { m_mask = 0; memset(m_axis, 0, sizeof(m_axis)); m_raw = boost::string_view("", 0); m_raw_storage.clear(); m_cmd_letter = 0; m_cmd_number = 0; }
+
+        // The raw line including the comment, without the trailing new line. The line references the buffer being parsed
+        // (or its own storage once modified by set()), it is valid until the buffer is released or until this GCodeLine is reset.
+        // The raw line is always followed by a new line or by a zero character, therefore the numbers may be parsed by strtod().
+        const boost::string_view& raw() const { return m_raw; }
+        boost::string_view  cmd() const { 
+            const char *cmd = GCodeReader::skip_whitespaces(m_raw.data());
+            return boost::string_view(cmd, GCodeReader::skip_word(cmd) - cmd);
         }
-        const std::string   comment() const
-            { size_t pos = m_raw.find(';'); return (pos == std::string::npos) ? "" : m_raw.substr(pos + 1); }
+        boost::string_view  comment() const
+            { size_t pos = m_raw.find(';'); return (pos == boost::string_view::npos) ? boost::string_view() : m_raw.substr(pos + 1); }
+
+        // The command is split into its letter and number while parsing, so that the consumers may dispatch on them
+        // without extracting the command. The letter is converted to upper case and it is zero if the command
+        // is shorter than two characters. The number is parsed by atoi().
+        char     cmd_letter() const { return m_cmd_letter; }
+        int      cmd_number() const { return m_cmd_number; }
+        uint32_t cmd_code()   const { return GCodeReader::cmd_code(m_cmd_letter, m_cmd_number); }
 
         bool  has(Axis axis) const { return (m_mask & (1 << int(axis))) != 0; }
         float value(Axis axis) const { return m_axis[axis]; }
@@ -42,7 +55,7 @@ public:
             return sqrt(x*x + y*y);
         }
         bool cmd_is(const char *cmd_test) const {
-            const char *cmd = GCodeReader::skip_whitespaces(m_raw.c_str());
+            const char *cmd = GCodeReader::skip_whitespaces(m_raw.data());
             size_t len = strlen(cmd_test); 
             return strncmp(cmd, cmd_test, len) == 0 && GCodeReader::is_end_of_word(cmd[len]);
         }
@@ -63,12 +76,20 @@ public:
         float f() const { return m_axis[F]; }
 
     private:
-        std::string      m_raw;
-        float            m_axis[NUM_AXES];
-        uint32_t         m_mask;
+        boost::string_view  m_raw;
+        // Storage of a line modified by set().
+        std::string         m_raw_storage;
+        float               m_axis[NUM_AXES];
+        uint32_t            m_mask;
+        char                m_cmd_letter;
+        int                 m_cmd_number;
         friend class GCodeReader;
     };
 
+    // Command letter and number packed into a single integer, to be compared with GCodeLine::cmd_code(),
+    // for example line.cmd_code() == GCodeReader::cmd_code('M', 204).
+    static constexpr uint32_t cmd_code(char letter, int number) { return (uint32_t((unsigned char)letter) << 24) | (uint32_t(number) & 0xffffff); }
+
     typedef std::function<void(GCodeReader&, const GCodeLine&)> callback_t;
     
     GCodeReader() : m_verbose(false), m_extrusion_axis('E') { memset(m_position, 0, sizeof(m_position)); }
@@ -89,6 +110,20 @@ public:
     void parse_buffer(const std::string &buffer)
         { this->parse_buffer(buffer, [](GCodeReader&, const GCodeReader::GCodeLine&){}); }
 
+    // Parse the lines of a buffer, which does not need to be zero terminated, but its last line has to be terminated by a new line.
+    // A single GCodeLine is reused for all the lines, so that the parser does not allocate memory per line.
+    template<typename Callback>
+    void parse_lines(const char *begin, const char *end, Callback callback)
+    {
+        GCodeLine gline;
+        for (const char *ptr = begin; ptr < end;) {
+            gline.reset();
+            const char *next = this->parse_line(ptr, gline, callback);
+            // A zero character terminates a line, but it is not consumed by parse_line().
+            ptr = (next == ptr) ? ptr + 1 : next;
+        }
+    }
+
     template<typename Callback>
     const char* parse_line(const char *ptr, GCodeLine &gline, Callback &callback)
     {
@@ -103,7 +138,9 @@ public:
     void parse_line(const std::string &line, Callback callback)
         { GCodeLine gline; this->parse_line(line.c_str(), gline, callback); }
 
-    void parse_file(const std::string &file, callback_t callback);
+    // Parse a G-code file of any size: The file is mapped into memory by windows of a limited size and parsed by parse_lines().
+    // Returns false if the file could not be read.
+    bool parse_file(const std::string &file, callback_t callback);
 
     float& x()       { return m_position[X]; }
     float  x() const { return m_position[X]; }
@@ -1,4 +1,5 @@
 #include "GCodeTimeEstimator.hpp"
+#include "Profiler.hpp"
 #include "Utils.hpp"
 #include <boost/bind.hpp>
 #include <cmath>
@@ -9,6 +10,8 @@
 #include <boost/nowide/cstdio.hpp>
 #include <boost/algorithm/string/predicate.hpp>
 
+#include <tbb/parallel_for.h>
+
 static const float MMMIN_TO_MMSEC = 1.0f / 60.0f;
 static const float MILLISEC_TO_SEC = 0.001f;
 static const float INCHES_TO_MM = 25.4f;
@@ -25,6 +28,11 @@ static const float DEFAULT_EXTRUDE_FACTOR_OVERRIDE_PERCENTAGE = 1.0f; // 100 per
 
 static const float PREVIOUS_FEEDRATE_THRESHOLD = 0.0001f;
 
+// Minimum number of blocks planned by a single thread.
+static const size_t PLANNER_SEGMENT_MIN_BLOCKS = 4096;
+// If the blocks are not kept, the planned blocks are released whenever this number of blocks has been added.
+static const size_t RELEASE_BLOCKS_INTERVAL = 65536;
+
 #if ENABLE_MOVE_STATS
 static const std::string MOVE_TYPE_STR[Slic3r::GCodeTimeEstimator::Block::Num_Types] =
 {
@@ -179,6 +187,7 @@ namespace Slic3r {
 
     GCodeTimeEstimator::GCodeTimeEstimator(EMode mode)
         : m_mode(mode)
+        , m_keep_blocks(true)
     {
         reset();
         set_default();
@@ -207,6 +216,7 @@ namespace Slic3r {
     void GCodeTimeEstimator::calculate_time(bool start_from_beginning)
     {
         PROFILE_FUNC();
+        SLIC3R_PROFILE_ZONE("GCodeTimeEstimator::calculate_time");
         if (start_from_beginning)
         {
             _reset_time();
@@ -275,124 +285,173 @@ namespace Slic3r {
 
     bool GCodeTimeEstimator::post_process_remaining_times(const std::string& filename, float interval)
     {
-        boost::nowide::ifstream in(filename);
-        if (!in.good())
+        return post_process_remaining_times(filename, interval, { this });
+    }
+
+    // Is the line a G1 command? Mirrors GCodeReader::GCodeLine::cmd_is("G1") without parsing the line.
+    static inline bool is_G1_line(const char *begin, const char *end)
+    {
+        for (; begin != end && (*begin == ' ' || *begin == '\t'); ++ begin) ;
+        if (end - begin < 2 || begin[0] != 'G' || begin[1] != '1')
+            return false;
+        if (end - begin == 2)
+            return true;
+        char c = begin[2];
+        return c == ' ' || c == '\t' || c == ';' || c == '\r';
+    }
+
+    bool GCodeTimeEstimator::post_process_remaining_times(const std::string& filename, float interval, const std::vector<const GCodeTimeEstimator*>& estimators)
+    {
+        SLIC3R_PROFILE_ZONE("GCodeTimeEstimator::post_process_remaining_times");
+        FILE* in = boost::nowide::fopen(filename.c_str(), "rb");
+        if (in == nullptr)
             throw std::runtime_error(std::string("Remaining times export failed.\nCannot open file for reading.\n"));
 
         std::string path_tmp = filename + ".times";
 
         FILE* out = boost::nowide::fopen(path_tmp.c_str(), "wb");
-        if (out == nullptr)
+        if (out == nullptr) {
+            fclose(in);
             throw std::runtime_error(std::string("Remaining times export failed.\nCannot open file for writing.\n"));
-
-        std::string time_mask;
-        switch (m_mode)
-        {
-        default:
-        case Normal:
-        {
-            time_mask = "M73 P%s R%s\n";
-            break;
         }
-        case Silent:
+
+        // All the estimators are served by a single pass over the file, so that the file is read and written just once.
+        struct EstimatorState
         {
-            time_mask = "M73 Q%s S%s\n";
-            break;
-        }
+            const GCodeTimeEstimator                *estimator;
+            const char                              *time_mask;
+            const std::string                       *first_placeholder;
+            const std::string                       *last_placeholder;
+            G1LineIdToBlockIdMap::const_iterator     it_line_id;
+            float                                    last_recorded_time = 0.0f;
+        };
+        std::vector<EstimatorState> states;
+        // The M73 lines of the estimators are inserted after a G1 line in the reverse order, which reproduces
+        // the output of post-processing the file by the estimators one after the other.
+        for (auto it = estimators.rbegin(); it != estimators.rend(); ++ it) {
+            EstimatorState state;
+            state.estimator         = *it;
+            bool normal             = state.estimator->m_mode != Silent;
+            state.time_mask         = normal ? "M73 P%s R%s\n" : "M73 Q%s S%s\n";
+            state.first_placeholder = normal ? &Normal_First_M73_Output_Placeholder_Tag : &Silent_First_M73_Output_Placeholder_Tag;
+            state.last_placeholder  = normal ? &Normal_Last_M73_Output_Placeholder_Tag  : &Silent_Last_M73_Output_Placeholder_Tag;
+            state.it_line_id        = state.estimator->m_g1_line_ids.begin();
+            states.emplace_back(state);
         }
 
+        // Only the G1 lines with a block assigned are parsed, to find out whether they extrude.
+        GCodeReader parser;
         unsigned int g1_lines_count = 0;
-        float last_recorded_time = 0.0f;
         std::string gcode_line;
         // buffer line to export only when greater than 64K to reduce writing calls
         std::string export_line;
         char time_line[64];
-		G1LineIdToBlockIdMap::const_iterator it_line_id = m_g1_line_ids.begin();
-		while (std::getline(in, gcode_line))
-        {
-            if (!in.good())
-            {
-                fclose(out);
-                throw std::runtime_error(std::string("Remaining times export failed.\nError while reading from file.\n"));
-            }
 
-            // replaces placeholders for initial line M73 with the real lines
-            if (((m_mode == Normal) && (gcode_line == Normal_First_M73_Output_Placeholder_Tag)) ||
-                ((m_mode == Silent) && (gcode_line == Silent_First_M73_Output_Placeholder_Tag)))
+        auto write_export_line = [&export_line, in, out, &path_tmp]() {
+            fwrite((const void*)export_line.c_str(), 1, export_line.length(), out);
+            if (ferror(out))
             {
-                sprintf(time_line, time_mask.c_str(), "0", _get_time_minutes(m_time).c_str());
-                gcode_line = time_line;
+                fclose(in);
+                fclose(out);
+                boost::nowide::remove(path_tmp.c_str());
+                throw std::runtime_error(std::string("Remaining times export failed.\nIs the disk full?\n"));
             }
-            // replaces placeholders for final line M73 with the real lines
-            else if (((m_mode == Normal) && (gcode_line == Normal_Last_M73_Output_Placeholder_Tag)) ||
-                     ((m_mode == Silent) && (gcode_line == Silent_Last_M73_Output_Placeholder_Tag)))
-            {
-                sprintf(time_line, time_mask.c_str(), "100", "0");
-                gcode_line = time_line;
+            export_line.clear();
+        };
+
+        auto process_line = [&](const char *begin, const char *end) {
+            gcode_line.assign(begin, end);
+            bool replaced = false;
+            for (EstimatorState &state : states) {
+                // replaces placeholders for initial line M73 with the real lines
+                if (gcode_line == *state.first_placeholder) {
+                    sprintf(time_line, state.time_mask, "0", _get_time_minutes(state.estimator->m_time).c_str());
+                    export_line += time_line;
+                    replaced = true;
+                    break;
+                }
+                // replaces placeholders for final line M73 with the real lines
+                if (gcode_line == *state.last_placeholder) {
+                    sprintf(time_line, state.time_mask, "100", "0");
+                    export_line += time_line;
+                    replaced = true;
+                    break;
+                }
             }
-            else
-               gcode_line += "\n";
+            if (replaced)
+                return;
 
+            export_line += gcode_line;
+            export_line += '\n';
 
             // add remaining time lines where needed
-            m_parser.parse_line(gcode_line,
-                [this, &it_line_id, &g1_lines_count, &last_recorded_time, &time_line, &gcode_line, time_mask, interval](GCodeReader& reader, const GCodeReader::GCodeLine& line)
-            {
-                if (line.cmd_is("G1"))
-                {
-                    ++g1_lines_count;
-
-					assert(it_line_id == m_g1_line_ids.end() || it_line_id->first >= g1_lines_count);
-
-					const Block *block = nullptr;
-					if (it_line_id != m_g1_line_ids.end() && it_line_id->first == g1_lines_count) {
-						if (line.has_e() && it_line_id->second < (unsigned int)m_blocks.size())
-							block = &m_blocks[it_line_id->second];
-						++it_line_id;
-					}
+            if (! is_G1_line(begin, end))
+                return;
+            ++ g1_lines_count;
+            int has_e = -1;
+            for (EstimatorState &state : states) {
+                const GCodeTimeEstimator &estimator = *state.estimator;
+                assert(state.it_line_id == estimator.m_g1_line_ids.end() || state.it_line_id->first >= g1_lines_count);
+
+                const Block *block = nullptr;
+                if (state.it_line_id != estimator.m_g1_line_ids.end() && state.it_line_id->first == g1_lines_count) {
+                    if (has_e == -1)
+                        parser.parse_line(gcode_line, [&has_e](GCodeReader&, const GCodeReader::GCodeLine& line) { has_e = line.has_e(); });
+                    if (has_e && state.it_line_id->second < (unsigned int)estimator.m_blocks.size())
+                        block = &estimator.m_blocks[state.it_line_id->second];
+                    ++ state.it_line_id;
+                }
 
-					if (block != nullptr && block->elapsed_time != -1.0f) {
-                        float block_remaining_time = m_time - block->elapsed_time;
-                        if (std::abs(last_recorded_time - block_remaining_time) > interval)
-                        {
-                            sprintf(time_line, time_mask.c_str(), std::to_string((int)(100.0f * block->elapsed_time / m_time)).c_str(), _get_time_minutes(block_remaining_time).c_str());
-                            gcode_line += time_line;
+                if (block != nullptr && block->elapsed_time != -1.0f) {
+                    float block_remaining_time = estimator.m_time - block->elapsed_time;
+                    if (std::abs(state.last_recorded_time - block_remaining_time) > interval)
+                    {
+                        sprintf(time_line, state.time_mask, std::to_string((int)(100.0f * block->elapsed_time / estimator.m_time)).c_str(), _get_time_minutes(block_remaining_time).c_str());
+                        export_line += time_line;
 
-                            last_recorded_time = block_remaining_time;
-                        }
+                        state.last_recorded_time = block_remaining_time;
                     }
                 }
-            });
-
-            export_line += gcode_line;
-            if (export_line.length() > 65535)
-            {
-                fwrite((const void*)export_line.c_str(), 1, export_line.length(), out);
-                if (ferror(out))
-                {
-                    in.close();
-                    fclose(out);
-                    boost::nowide::remove(path_tmp.c_str());
-                    throw std::runtime_error(std::string("Remaining times export failed.\nIs the disk full?\n"));
-                }
-                export_line.clear();
             }
-        }
-
-        if (export_line.length() > 0)
-        {
-            fwrite((const void*)export_line.c_str(), 1, export_line.length(), out);
-            if (ferror(out))
+        };
+
+        // Read the file in large blocks, a line crossing the block boundary is carried over to the next block.
+        std::vector<char> buffer(65536);
+        size_t            carry = 0;
+        for (;;) {
+            size_t num_read = fread(buffer.data() + carry, 1, buffer.size() - carry, in);
+            if (ferror(in))
             {
-                in.close();
+                fclose(in);
                 fclose(out);
                 boost::nowide::remove(path_tmp.c_str());
-                throw std::runtime_error(std::string("Remaining times export failed.\nIs the disk full?\n"));
+                throw std::runtime_error(std::string("Remaining times export failed.\nError while reading from file.\n"));
+            }
+            const char *begin = buffer.data();
+            const char *end   = begin + carry + num_read;
+            for (const char *eol; (eol = (const char*)memchr(begin, '\n', end - begin)) != nullptr; begin = eol + 1)
+                process_line(begin, eol);
+            carry = end - begin;
+            if (num_read == 0) {
+                // The last line is not terminated by a newline.
+                if (carry > 0)
+                    process_line(begin, end);
+                break;
             }
+            if (carry == buffer.size())
+                // A single line does not fit the buffer, grow it.
+                buffer.resize(buffer.size() * 2);
+            else if (carry > 0)
+                memmove(buffer.data(), begin, carry);
+            if (export_line.length() > 65535)
+                write_export_line();
         }
 
+        if (export_line.length() > 0)
+            write_export_line();
+
         fclose(out);
-        in.close();
+        fclose(in);
 
         if (rename_file(path_tmp, filename))
             throw std::runtime_error(std::string("Failed to rename the output G-code file from ") + path_tmp + " to " + filename + '\n' +
@@ -506,6 +565,27 @@ namespace Slic3r {
         return m_state.minimum_travel_feedrate;
     }
 
+    void GCodeTimeEstimator::set_machine_limits(const MachineEnvelopeConfig &config)
+    {
+        size_t idx = (m_mode == Silent) ? 1 : 0;
+        set_max_acceleration((float)config.machine_max_acceleration_extruding.get_at(idx));
+        set_retract_acceleration((float)config.machine_max_acceleration_retracting.get_at(idx));
+        set_minimum_feedrate((float)config.machine_min_extruding_rate.get_at(idx));
+        set_minimum_travel_feedrate((float)config.machine_min_travel_rate.get_at(idx));
+        set_axis_max_acceleration(X, (float)config.machine_max_acceleration_x.get_at(idx));
+        set_axis_max_acceleration(Y, (float)config.machine_max_acceleration_y.get_at(idx));
+        set_axis_max_acceleration(Z, (float)config.machine_max_acceleration_z.get_at(idx));
+        set_axis_max_acceleration(E, (float)config.machine_max_acceleration_e.get_at(idx));
+        set_axis_max_feedrate(X, (float)config.machine_max_feedrate_x.get_at(idx));
+        set_axis_max_feedrate(Y, (float)config.machine_max_feedrate_y.get_at(idx));
+        set_axis_max_feedrate(Z, (float)config.machine_max_feedrate_z.get_at(idx));
+        set_axis_max_feedrate(E, (float)config.machine_max_feedrate_e.get_at(idx));
+        set_axis_max_jerk(X, (float)config.machine_max_jerk_x.get_at(idx));
+        set_axis_max_jerk(Y, (float)config.machine_max_jerk_y.get_at(idx));
+        set_axis_max_jerk(Z, (float)config.machine_max_jerk_z.get_at(idx));
+        set_axis_max_jerk(E, (float)config.machine_max_jerk_e.get_at(idx));
+    }
+
     void GCodeTimeEstimator::set_filament_load_times(const std::vector<double> &filament_load_times)
     {
         m_state.filament_load_times.clear();
@@ -781,20 +861,61 @@ namespace Slic3r {
     void GCodeTimeEstimator::_calculate_time()
     {
         PROFILE_FUNC();
-        _forward_pass();
-        _reverse_pass();
+        _plan(m_blocks.size());
         _recalculate_trapezoids();
+        _accumulate_time(m_blocks.size());
+        m_last_st_synchronized_block_id = (int)m_blocks.size() - 1;
+    }
+
+    // The forward and reverse passes over the blocks up to a block of nominal length do not depend on the blocks following it,
+    // see _planner_segments(), therefore the blocks before the last block of nominal length may be timed and released
+    // with the very same result as if they were timed at the next st_synchronize().
+    // The block of nominal length is kept, as its trapezoid depends on the entry speed of the block following it.
+    void GCodeTimeEstimator::_release_planned_blocks()
+    {
+        PROFILE_FUNC();
+        size_t begin = size_t(m_last_st_synchronized_block_id + 1);
+        // The newest block has not been reverse planned against its successor yet, don't consider it.
+        size_t last = m_blocks.size() - 1;
+        while (last > begin && ! m_blocks[-- last].flags.nominal_length) ;
+        if (last <= begin)
+            return;
+
+        _plan(last + 1);
+        _recalculate_trapezoids(last);
+        _accumulate_time(last);
+
+        // The block of nominal length becomes the first block after a st_synchronize(), it is not replanned by the reverse pass,
+        // which would just reset its entry speed to the maximum entry speed again.
+        m_blocks.erase(m_blocks.begin(), m_blocks.begin() + last);
+        m_last_st_synchronized_block_id = -1;
+    }
 
+    void GCodeTimeEstimator::_accumulate_time(size_t end)
+    {
         m_time += get_additional_time();
         m_color_time_cache += get_additional_time();
+        // The additional time has been consumed (added to the total time), reset it to zero.
+        set_additional_time(0.);
+
+        // Calculate the times of the blocks in parallel, store them into elapsed_time to be accumulated below.
+        tbb::parallel_for(tbb::blocked_range<size_t>(size_t(m_last_st_synchronized_block_id + 1), end, PLANNER_SEGMENT_MIN_BLOCKS),
+            [this](const tbb::blocked_range<size_t> &range) {
+                for (size_t i = range.begin(); i < range.end(); ++ i) {
+                    Block& block = m_blocks[i];
+                    float block_time = 0.0f;
+                    block_time += block.acceleration_time();
+                    block_time += block.cruise_time();
+                    block_time += block.deceleration_time();
+                    block.elapsed_time = block_time;
+                }
+            });
 
-        for (int i = m_last_st_synchronized_block_id + 1; i < (int)m_blocks.size(); ++i)
+        // Accumulate the times in the order of the blocks, so that the result does not depend on the number of threads.
+        for (int i = m_last_st_synchronized_block_id + 1; i < (int)end; ++i)
         {
             Block& block = m_blocks[i];
-            float block_time = 0.0f;
-            block_time += block.acceleration_time();
-            block_time += block.cruise_time();
-            block_time += block.deceleration_time();
+            float block_time = block.elapsed_time;
             m_time += block_time;
             block.elapsed_time = m_time;
 
@@ -809,10 +930,6 @@ namespace Slic3r {
 
             m_color_time_cache += block_time;
         }
-
-        m_last_st_synchronized_block_id = (int)m_blocks.size() - 1;
-        // The additional time has been consumed (added to the total time), reset it to zero.
-        set_additional_time(0.);
     }
 
     void GCodeTimeEstimator::_process_gcode_line(GCodeReader&, const GCodeReader::GCodeLine& line)
@@ -823,14 +940,13 @@ namespace Slic3r {
         if (_process_tags(line))
             return;
 
-        std::string cmd = line.cmd();
-        if (cmd.length() > 1)
+        if (line.cmd_letter() != 0)
         {
-            switch (::toupper(cmd[0]))
+            switch (line.cmd_letter())
             {
             case 'G':
                 {
-                    switch (::atoi(&cmd[1]))
+                    switch (line.cmd_number())
                     {
                     case 1: // Move
                         {
@@ -878,7 +994,7 @@ namespace Slic3r {
                 }
             case 'M':
                 {
-                    switch (::atoi(&cmd[1]))
+                    switch (line.cmd_number())
                     {
                     case 1: // Sleep or Conditional stop
                         {
@@ -1156,7 +1272,10 @@ namespace Slic3r {
 
         // adds block to blocks list
         m_blocks.emplace_back(block);
-        m_g1_line_ids.emplace_back(G1LineIdToBlockIdMap::value_type(get_g1_line_id(), (unsigned int)m_blocks.size() - 1));
+        if (m_keep_blocks)
+            m_g1_line_ids.emplace_back(G1LineIdToBlockIdMap::value_type(get_g1_line_id(), (unsigned int)m_blocks.size() - 1));
+        else if (m_blocks.size() % RELEASE_BLOCKS_INTERVAL == 0)
+            _release_planned_blocks();
     }
 
     void GCodeTimeEstimator::_processG4(const GCodeReader::GCodeLine& line)
@@ -1415,10 +1534,9 @@ namespace Slic3r {
 
     void GCodeTimeEstimator::_processT(const GCodeReader::GCodeLine& line)
     {
-        std::string cmd = line.cmd();
-        if (cmd.length() > 1)
+        if (line.cmd_letter() != 0)
         {
-            unsigned int id = (unsigned int)::strtol(cmd.substr(1).c_str(), nullptr, 10);
+            unsigned int id = (unsigned int)line.cmd_number();
             if (get_extruder_id() != id)
             {
                 // Specific to the MK3 MMU2: The initial extruder ID is set to -1 indicating
@@ -1433,7 +1551,7 @@ namespace Slic3r {
 
     bool GCodeTimeEstimator::_process_tags(const GCodeReader::GCodeLine& line)
     {
-        std::string comment = line.comment();
+        boost::string_view comment = line.comment();
 
         // color change tag
         size_t pos = comment.find(Color_Change_Tag);
@@ -1464,27 +1582,56 @@ namespace Slic3r {
         _calculate_time();
     }
 
-    void GCodeTimeEstimator::_forward_pass()
+    // The forward pass kernel does not modify the block following a block of nominal length, and the reverse pass kernel
+    // does not read the block following a block of nominal length. Therefore the planner passes over segments
+    // ending with a block of nominal length are independent of each other, and planning the segments one by one
+    // gives the very same result as planning all the blocks at once.
+    std::vector<size_t> GCodeTimeEstimator::_planner_segments(size_t end) const
     {
-        PROFILE_FUNC();
-        if (m_blocks.size() > 1)
+        std::vector<size_t> segments;
+        size_t begin = size_t(m_last_st_synchronized_block_id + 1);
+        segments.emplace_back(begin);
+        for (size_t i = begin + PLANNER_SEGMENT_MIN_BLOCKS; i < end; ++i)
         {
-            for (int i = m_last_st_synchronized_block_id + 1; i < (int)m_blocks.size() - 1; ++i)
+            if (m_blocks[i - 1].flags.nominal_length)
             {
-                _planner_forward_pass_kernel(m_blocks[i], m_blocks[i + 1]);
+                segments.emplace_back(i);
+                i += PLANNER_SEGMENT_MIN_BLOCKS - 1;
             }
         }
+        segments.emplace_back(std::max(begin, end));
+        return segments;
     }
 
-    void GCodeTimeEstimator::_reverse_pass()
+    void GCodeTimeEstimator::_plan(size_t end)
+    {
+        // The segments are planned in parallel, each of them by the forward pass followed by the reverse pass.
+        std::vector<size_t> segments = _planner_segments(end);
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, segments.size() - 1),
+            [this, &segments](const tbb::blocked_range<size_t> &range) {
+                for (size_t i = range.begin(); i < range.end(); ++ i) {
+                    _forward_pass(segments[i], segments[i + 1]);
+                    _reverse_pass(segments[i], segments[i + 1]);
+                }
+            });
+    }
+
+    void GCodeTimeEstimator::_forward_pass(size_t begin, size_t end)
     {
         PROFILE_FUNC();
-        if (m_blocks.size() > 1)
+        for (size_t i = begin; i + 1 < end; ++i)
         {
-            for (int i = (int)m_blocks.size() - 1; i >= m_last_st_synchronized_block_id + 2; --i)
-            {
-                _planner_reverse_pass_kernel(m_blocks[i - 1], m_blocks[i]);
-            }
+            _planner_forward_pass_kernel(m_blocks[i], m_blocks[i + 1]);
+        }
+    }
+
+    void GCodeTimeEstimator::_reverse_pass(size_t begin, size_t end)
+    {
+        PROFILE_FUNC();
+        // The last block of the segment is planned against the first block of the next segment, which is not accessed.
+        for (size_t i = std::min(end, m_blocks.size() - 1); i > begin; --i)
+        {
+            _planner_reverse_pass_kernel(m_blocks[i - 1], m_blocks[i]);
         }
     }
 
@@ -1532,40 +1679,43 @@ namespace Slic3r {
     void GCodeTimeEstimator::_recalculate_trapezoids()
     {
         PROFILE_FUNC();
-        Block* curr = nullptr;
-        Block* next = nullptr;
+        if (size_t(m_last_st_synchronized_block_id + 1) >= m_blocks.size())
+            return;
 
-        for (int i = m_last_st_synchronized_block_id + 1; i < (int)m_blocks.size(); ++i)
-        {
-            Block& b = m_blocks[i];
+        _recalculate_trapezoids(m_blocks.size() - 1);
 
-            curr = next;
-            next = &b;
+        // Last/newest block in buffer. Always recalculated.
+        Block& last = m_blocks.back();
+        Block block = last;
+        block.feedrate.exit = last.safe_feedrate;
+        block.calculate_trapezoid();
+        last.trapezoid = block.trapezoid;
+        last.flags.recalculate = false;
+    }
 
-            if (curr != nullptr)
-            {
-                // Recalculate if current block entry or exit junction speed has changed.
-                if (curr->flags.recalculate || next->flags.recalculate)
+    void GCodeTimeEstimator::_recalculate_trapezoids(size_t end)
+    {
+        size_t begin = size_t(m_last_st_synchronized_block_id + 1);
+        // The flags are only read by the parallel loop, they are reset afterwards.
+        tbb::parallel_for(tbb::blocked_range<size_t>(begin, end, PLANNER_SEGMENT_MIN_BLOCKS),
+            [this](const tbb::blocked_range<size_t> &range) {
+                for (size_t i = range.begin(); i < range.end(); ++i)
                 {
-                    // NOTE: Entry and exit factors always > 0 by all previous logic operations.
-                    Block block = *curr;
-                    block.feedrate.exit = next->feedrate.entry;
-                    block.calculate_trapezoid();
-                    curr->trapezoid = block.trapezoid;
-                    curr->flags.recalculate = false; // Reset current only to ensure next trapezoid is computed
+                    Block* curr = &m_blocks[i];
+                    Block* next = &m_blocks[i + 1];
+                    // Recalculate if current block entry or exit junction speed has changed.
+                    if (curr->flags.recalculate || next->flags.recalculate)
+                    {
+                        // NOTE: Entry and exit factors always > 0 by all previous logic operations.
+                        Block block = *curr;
+                        block.feedrate.exit = next->feedrate.entry;
+                        block.calculate_trapezoid();
+                        curr->trapezoid = block.trapezoid;
+                    }
                 }
-            }
-        }
-
-        // Last/newest block in buffer. Always recalculated.
-        if (next != nullptr)
-        {
-            Block block = *next;
-            block.feedrate.exit = next->safe_feedrate;
-            block.calculate_trapezoid();
-            next->trapezoid = block.trapezoid;
-            next->flags.recalculate = false;
-        }
+            });
+        for (size_t i = begin; i < end; ++i)
+            m_blocks[i].flags.recalculate = false;
     }
 
     std::string GCodeTimeEstimator::_get_time_dhms(float time_in_secs)
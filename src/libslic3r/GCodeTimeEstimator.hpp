@@ -228,6 +228,8 @@ namespace Slic3r {
         // Index of the last block already st_synchronized
         int m_last_st_synchronized_block_id;
         float m_time; // s
+        // If false, the blocks are released as soon as their times are known, see set_keep_blocks().
+        bool m_keep_blocks;
 
         // data to calculate color print times
         bool m_needs_color_times;
@@ -243,6 +245,8 @@ namespace Slic3r {
 
         // Adds the given gcode line
         void add_gcode_line(const std::string& gcode_line);
+        // Adds the given gcode line, already parsed by the caller
+        void add_gcode_line(const GCodeReader::GCodeLine& gcode_line) { this->_process_gcode_line(m_parser, gcode_line); }
 
         void add_gcode_block(const char *ptr);
         void add_gcode_block(const std::string &str) { this->add_gcode_block(str.c_str()); }
@@ -262,6 +266,11 @@ namespace Slic3r {
         // Calculates the time estimate from the gcode contained in given list of gcode lines
         void calculate_time_from_lines(const std::vector<std::string>& gcode_lines);
 
+        // If set to false, the blocks are released as soon as their times are known, so that a G-code of any length
+        // is processed in bounded memory. The estimated times are the same, but calculate_time(true)
+        // and post_process_remaining_times() cannot be used then. True by default.
+        void set_keep_blocks(bool keep) { m_keep_blocks = keep; }
+
         // Process the gcode contained in the file with the given filename, 
         // placing in it new lines (M73) containing the remaining time, at the given interval in seconds
         // and saving the result back in the same file
@@ -269,6 +278,10 @@ namespace Slic3r {
         // contained in the given file before to call this method
         bool post_process_remaining_times(const std::string& filename, float interval_sec);
 
+        // Same as above for multiple estimators (for example the normal and the silent mode ones) at once,
+        // so that the file is read and rewritten just once
+        static bool post_process_remaining_times(const std::string& filename, float interval_sec, const std::vector<const GCodeTimeEstimator*>& estimators);
+
         // Set current position on the given axis with the given value
         void set_axis_position(EAxis axis, float position);
 
@@ -302,6 +315,9 @@ namespace Slic3r {
         void set_minimum_travel_feedrate(float feedrate_mm_sec);
         float get_minimum_travel_feedrate() const;
 
+        // Sets the machine limits from the configuration, the first values for the normal mode, the second values for the silent mode.
+        void set_machine_limits(const MachineEnvelopeConfig &config);
+
         void set_filament_load_times(const std::vector<double> &filament_load_times);
         void set_filament_unload_times(const std::vector<double> &filament_unload_times);
         float get_filament_load_time(unsigned int id_extruder);
@@ -369,6 +385,10 @@ namespace Slic3r {
 
         // Calculates the time estimate
         void _calculate_time();
+        // Plans, times and releases the blocks up to the last block of nominal length.
+        void _release_planned_blocks();
+        // Adds the times of the planned blocks up to end to the time estimate.
+        void _accumulate_time(size_t end);
 
         // Processes the given gcode line
         void _process_gcode_line(GCodeReader&, const GCodeReader::GCodeLine& line);
@@ -443,13 +463,21 @@ namespace Slic3r {
         // Simulates firmware st_synchronize() call
         void _simulate_st_synchronize();
 
-        void _forward_pass();
-        void _reverse_pass();
+        // Splits the blocks not planned yet up to end into segments, which are planned independently of each other.
+        // Returns the indices of the first blocks of the segments, followed by end.
+        std::vector<size_t> _planner_segments(size_t end) const;
+        // Plans the blocks not planned yet up to end by the forward and reverse passes.
+        void _plan(size_t end);
+        // Forward and reverse planner passes over a segment of blocks [begin, end).
+        void _forward_pass(size_t begin, size_t end);
+        void _reverse_pass(size_t begin, size_t end);
 
         void _planner_forward_pass_kernel(Block& prev, Block& curr);
         void _planner_reverse_pass_kernel(Block& curr, Block& next);
 
         void _recalculate_trapezoids();
+        // Recalculates the trapezoids of the blocks up to end, which are followed by a block already planned.
+        void _recalculate_trapezoids(size_t end);
 
         // Returns the given time is seconds in format DDd HHh MMm SSs
         static std::string _get_time_dhms(float time_in_secs);
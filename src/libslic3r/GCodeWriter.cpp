@@ -137,35 +137,41 @@ std::string GCodeWriter::set_bed_temperature(unsigned int temperature, bool wait
 
 std::string GCodeWriter::set_fan(unsigned int speed, bool dont_save)
 {
-    std::ostringstream gcode;
+    std::string gcode;
     if (m_last_fan_speed != speed || dont_save) {
         if (!dont_save) m_last_fan_speed = speed;
-        
-        if (speed == 0) {
-            if (FLAVOR_IS(gcfTeacup)) {
-                gcode << "M106 S0";
-            } else if (FLAVOR_IS(gcfMakerWare) || FLAVOR_IS(gcfSailfish)) {
-                gcode << "M127";
-            } else {
-                gcode << "M107";
-            }
-            if (this->config.gcode_comments) gcode << " ; disable fan";
-            gcode << "\n";
+        gcode = this->fan_gcode(speed);
+    }
+    return gcode;
+}
+
+std::string GCodeWriter::fan_gcode(unsigned int speed) const
+{
+    std::ostringstream gcode;
+    if (speed == 0) {
+        if (FLAVOR_IS(gcfTeacup)) {
+            gcode << "M106 S0";
+        } else if (FLAVOR_IS(gcfMakerWare) || FLAVOR_IS(gcfSailfish)) {
+            gcode << "M127";
         } else {
-            if (FLAVOR_IS(gcfMakerWare) || FLAVOR_IS(gcfSailfish)) {
-                gcode << "M126";
+            gcode << "M107";
+        }
+        if (this->config.gcode_comments) gcode << " ; disable fan";
+        gcode << "\n";
+    } else {
+        if (FLAVOR_IS(gcfMakerWare) || FLAVOR_IS(gcfSailfish)) {
+            gcode << "M126";
+        } else {
+            gcode << "M106 ";
+            if (FLAVOR_IS(gcfMach3) || FLAVOR_IS(gcfMachinekit)) {
+                gcode << "P";
             } else {
-                gcode << "M106 ";
-                if (FLAVOR_IS(gcfMach3) || FLAVOR_IS(gcfMachinekit)) {
-                    gcode << "P";
-                } else {
-                    gcode << "S";
-                }
-                gcode << (255.0 * speed / 100.0);
+                gcode << "S";
             }
-            if (this->config.gcode_comments) gcode << " ; enable fan";
-            gcode << "\n";
+            gcode << (255.0 * speed / 100.0);
         }
+        if (this->config.gcode_comments) gcode << " ; enable fan";
+        gcode << "\n";
     }
     return gcode.str();
 }
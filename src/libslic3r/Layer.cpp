@@ -33,9 +33,32 @@ LayerRegion* Layer::add_region(PrintRegion* print_region)
     return m_regions.back();
 }
 
+const EdgeGrid::Grid& Layer::slices_edge_grid() const
+{
+    tbb::mutex::scoped_lock lock(m_slices_edge_grid_mutex);
+    if (! m_slices_edge_grid) {
+        // Create the distance field with 1mm resolution.
+        const coord_t distance_field_resolution = coord_t(scale_(1.) + 0.5);
+        std::unique_ptr<EdgeGrid::Grid> grid(new EdgeGrid::Grid());
+        grid->create(this->slices, distance_field_resolution);
+        grid->calculate_sdf();
+        m_slices_edge_grid = std::move(grid);
+    }
+    return *m_slices_edge_grid;
+}
+
+void Layer::clear_slices_edge_grid()
+{
+    tbb::mutex::scoped_lock lock(m_slices_edge_grid_mutex);
+    m_slices_edge_grid.reset();
+}
+
 // merge all regions' slices to get islands
 void Layer::make_slices()
 {
+    // The edge grid is calculated over the slices, which are being replaced.
+    this->clear_slices_edge_grid();
+
     ExPolygons slices;
     if (m_regions.size() == 1) {
         // optimization: if we only have one region, take its slices
@@ -103,6 +126,7 @@ ExPolygons Layer::merged(float offset_scaled) const
 void Layer::make_perimeters()
 {
     BOOST_LOG_TRIVIAL(trace) << "Generating perimeters for layer " << this->id();
+    ExtrusionEntityArena::Scope arena_scope(m_extrusion_arena);
     
     // keep track of regions whose perimeters we have already generated
     std::vector<unsigned char> done(m_regions.size(), false);
@@ -139,7 +163,8 @@ void Layer::make_perimeters()
         if (layerms.size() == 1) {  // optimization
             (*layerm)->fill_surfaces.surfaces.clear();
             (*layerm)->make_perimeters((*layerm)->slices, &(*layerm)->fill_surfaces);
-            (*layerm)->fill_expolygons = to_expolygons((*layerm)->fill_surfaces.surfaces);
+            (*layerm)->fill_expolygons.clear();
+            (*layerm)->fill_expolygons.append((*layerm)->fill_surfaces.surfaces);
         } else {
             SurfaceCollection new_slices;
             {
@@ -176,6 +201,7 @@ void Layer::make_fills()
     #ifdef SLIC3R_DEBUG
     printf("Making fills for layer " PRINTF_ZU "\n", this->id());
     #endif
+    ExtrusionEntityArena::Scope arena_scope(m_extrusion_arena);
     for (LayerRegion *layerm : m_regions) {
         layerm->fills.clear();
         make_fill(*layerm, layerm->fills);
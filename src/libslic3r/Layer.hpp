@@ -7,7 +7,16 @@
 #include "ExtrusionEntityCollection.hpp"
 #include "ExPolygonCollection.hpp"
 #include "PolylineCollection.hpp"
+#include "PolygonSet.hpp"
+#include "EdgeGrid.hpp"
 
+#include <memory>
+
+// tbb/mutex.h includes Windows, which in turn defines min/max macros. Convince Windows.h to not define these min/max macros.
+#ifndef NOMINMAX
+    #define NOMINMAX
+#endif
+#include "tbb/mutex.h"
 
 namespace Slic3r {
 
@@ -33,8 +42,8 @@ public:
     ExtrusionEntityCollection   thin_fills;
 
     // Unspecified fill polygons, used for overhang detection ("ensure vertical wall thickness feature")
-    // and for re-starting of infills.
-    ExPolygons                  fill_expolygons;
+    // and for re-starting of infills. Stored compactly, as they are kept for the life time of the layer.
+    PolygonSet                  fill_expolygons;
     // collection of surfaces for infill generation
     SurfaceCollection           fill_surfaces;
 
@@ -136,6 +145,13 @@ public:
     }
     void                    make_perimeters();
     void                    make_fills();
+    // Memory of the extrusion entities of this layer, see ExtrusionEntityArena::Scope.
+    ExtrusionEntityArena&   extrusion_arena() { return m_extrusion_arena; }
+    // Edge grid with a signed distance field over this->slices, used by the G-code generator to penalize seams
+    // at the overhangs of the layer above. Calculated on the first call, thread safe. The grid is kept with the layer
+    // to be reused by subsequent G-code exports, it is dropped by make_slices() and by clear_slices_edge_grid().
+    const EdgeGrid::Grid&   slices_edge_grid() const;
+    void                    clear_slices_edge_grid();
 
     void                    export_region_slices_to_svg(const char *path) const;
     void                    export_region_fill_surfaces_to_svg(const char *path) const;
@@ -160,6 +176,11 @@ private:
     size_t              m_id;
     PrintObject        *m_object;
     LayerRegionPtrs     m_regions;
+    // Destroyed after the regions and their extrusion entities.
+    ExtrusionEntityArena m_extrusion_arena;
+    // Cache of slices_edge_grid().
+    mutable std::unique_ptr<EdgeGrid::Grid> m_slices_edge_grid;
+    mutable tbb::mutex                      m_slices_edge_grid_mutex;
 };
 
 class SupportLayer : public Layer 
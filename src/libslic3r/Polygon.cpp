@@ -110,7 +110,8 @@ double Polygon::area() const
 bool
 Polygon::is_counter_clockwise() const
 {
-    return ClipperLib::Orientation(Slic3rMultiPoint_to_ClipperPath(*this));
+    // Same as ClipperLib::Orientation(), which evaluates the same signed area, without converting to ClipperLib::Path.
+    return this->area() >= 0;
 }
 
 bool
@@ -0,0 +1,183 @@
+#include "PolygonSet.hpp"
+
+namespace Slic3r {
+
+double PolygonSet::PolygonView::area() const
+{
+    size_t n = this->size();
+    if (n < 3)
+        return 0.;
+
+    double a = 0.;
+    for (size_t i = 0, j = n - 1; i < n; ++ i) {
+        a += ((double)m_begin[j](0) + (double)m_begin[i](0)) * ((double)m_begin[i](1) - (double)m_begin[j](1));
+        j = i;
+    }
+    return 0.5 * a;
+}
+
+bool PolygonSet::PolygonView::contains(const Point &point) const
+{
+    // http://www.ecse.rpi.edu/Homepages/wrf/Research/Short_Notes/pnpoly.html
+    bool result = false;
+    if (this->empty())
+        return result;
+    for (const Point *i = m_begin, *j = m_end - 1; i != m_end; j = i ++)
+        if ( (((*i)(1) > point(1)) != ((*j)(1) > point(1)))
+            && ((double)point(0) < (double)((*j)(0) - (*i)(0)) * (double)(point(1) - (*i)(1)) / (double)((*j)(1) - (*i)(1)) + (double)(*i)(0)) )
+            result = ! result;
+    return result;
+}
+
+void PolygonSet::clear()
+{
+    m_points.clear();
+    m_polygon_begin.assign(1, 0);
+    m_expolygon_begin.assign(1, 0);
+}
+
+void PolygonSet::reserve(size_t num_expolygons, size_t num_polygons, size_t num_points)
+{
+    m_points.reserve(num_points);
+    m_polygon_begin.reserve(num_polygons + 1);
+    m_expolygon_begin.reserve(num_expolygons + 1);
+}
+
+void PolygonSet::shrink_to_fit()
+{
+    m_points.shrink_to_fit();
+    m_polygon_begin.shrink_to_fit();
+    m_expolygon_begin.shrink_to_fit();
+}
+
+ExPolygon PolygonSet::expolygon(size_t expolygon_idx) const
+{
+    ExPolygon out;
+    out.contour = this->contour(expolygon_idx).polygon();
+    size_t num_holes = this->num_holes(expolygon_idx);
+    out.holes.reserve(num_holes);
+    for (size_t i = 0; i < num_holes; ++ i)
+        out.holes.emplace_back(this->hole(expolygon_idx, i).polygon());
+    return out;
+}
+
+void PolygonSet::append(const Polygon &polygon)
+{
+    this->append_polygon_points(polygon.points);
+    m_expolygon_begin.emplace_back(this->num_polygons());
+}
+
+void PolygonSet::append(const Polygons &polygons)
+{
+    size_t num_points = m_points.size();
+    for (const Polygon &polygon : polygons)
+        num_points += polygon.points.size();
+    this->reserve(this->num_expolygons() + polygons.size(), this->num_polygons() + polygons.size(), num_points);
+    for (const Polygon &polygon : polygons)
+        this->append(polygon);
+}
+
+void PolygonSet::append(const ExPolygon &expolygon)
+{
+    this->append_polygon_points(expolygon.contour.points);
+    for (const Polygon &hole : expolygon.holes)
+        this->append_polygon_points(hole.points);
+    m_expolygon_begin.emplace_back(this->num_polygons());
+}
+
+void PolygonSet::append(const ExPolygons &expolygons)
+{
+    size_t num_polygons = this->num_polygons();
+    size_t num_points   = m_points.size();
+    for (const ExPolygon &expolygon : expolygons) {
+        num_polygons += expolygon.holes.size() + 1;
+        num_points   += expolygon.contour.points.size();
+        for (const Polygon &hole : expolygon.holes)
+            num_points += hole.points.size();
+    }
+    this->reserve(this->num_expolygons() + expolygons.size(), num_polygons, num_points);
+    for (const ExPolygon &expolygon : expolygons)
+        this->append(expolygon);
+}
+
+void PolygonSet::append(const Surfaces &surfaces)
+{
+    size_t num_polygons = this->num_polygons();
+    size_t num_points   = m_points.size();
+    for (const Surface &surface : surfaces) {
+        num_polygons += surface.expolygon.holes.size() + 1;
+        num_points   += surface.expolygon.contour.points.size();
+        for (const Polygon &hole : surface.expolygon.holes)
+            num_points += hole.points.size();
+    }
+    this->reserve(this->num_expolygons() + surfaces.size(), num_polygons, num_points);
+    for (const Surface &surface : surfaces)
+        this->append(surface.expolygon);
+}
+
+void PolygonSet::append(const PolygonSet &other)
+{
+    size_t point_offset   = m_points.size();
+    size_t polygon_offset = this->num_polygons();
+    m_points.insert(m_points.end(), other.m_points.begin(), other.m_points.end());
+    for (auto it = other.m_polygon_begin.begin() + 1; it != other.m_polygon_begin.end(); ++ it)
+        m_polygon_begin.emplace_back(*it + point_offset);
+    for (auto it = other.m_expolygon_begin.begin() + 1; it != other.m_expolygon_begin.end(); ++ it)
+        m_expolygon_begin.emplace_back(*it + polygon_offset);
+}
+
+BoundingBox PolygonSet::bounding_box() const
+{
+    return m_points.empty() ? BoundingBox() : BoundingBox(m_points);
+}
+
+double PolygonSet::area() const
+{
+    double a = 0.;
+    for (size_t i = 0; i < this->num_polygons(); ++ i)
+        a += this->polygon(i).area();
+    return a;
+}
+
+bool PolygonSet::contains(const Point &point) const
+{
+    for (size_t i = 0; i < this->num_expolygons(); ++ i)
+        if (this->contour(i).contains(point)) {
+            bool in_hole = false;
+            for (size_t j = 0; j < this->num_holes(i) && ! in_hole; ++ j)
+                in_hole = this->hole(i, j).contains(point);
+            if (! in_hole)
+                return true;
+        }
+    return false;
+}
+
+size_t PolygonSet::memory_used() const
+{
+    return m_points.capacity() * sizeof(Point) + (m_polygon_begin.capacity() + m_expolygon_begin.capacity()) * sizeof(size_t);
+}
+
+Polygons to_polygons(const PolygonSet &src)
+{
+    Polygons polygons;
+    polygons_append(polygons, src);
+    return polygons;
+}
+
+ExPolygons to_expolygons(const PolygonSet &src)
+{
+    ExPolygons expolygons;
+    expolygons.reserve(src.num_expolygons());
+    for (size_t i = 0; i < src.num_expolygons(); ++ i)
+        expolygons.emplace_back(src.expolygon(i));
+    return expolygons;
+}
+
+void polygons_append(Polygons &dst, const PolygonSet &src)
+{
+    dst.reserve(dst.size() + src.num_polygons());
+    for (size_t i = 0; i < src.num_polygons(); ++ i)
+        dst.emplace_back(src.polygon(i).polygon());
+}
+
+} // namespace Slic3r
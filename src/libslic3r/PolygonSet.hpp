@@ -0,0 +1,109 @@
+#ifndef slic3r_PolygonSet_hpp_
+#define slic3r_PolygonSet_hpp_
+
+#include "libslic3r.h"
+#include "BoundingBox.hpp"
+#include "ExPolygon.hpp"
+#include "Polygon.hpp"
+#include "Surface.hpp"
+
+namespace Slic3r {
+
+// Compact storage of a set of polygons, grouped into ExPolygons (a contour followed by its holes).
+// Polygons / ExPolygons allocate a vector of points for each polygon and a vector of holes for each ExPolygon.
+// A PolygonSet stores the points of all its polygons in a single buffer in the order of the polygons,
+// and the polygons and ExPolygons are indexed by offset tables. A PolygonSet is intended for the long lived
+// per layer data, which is filled in at once and read many times, for example by the Clipper operations
+// in ClipperUtils, which accept a PolygonSet directly.
+class PolygonSet
+{
+public:
+    // Read only view of a single polygon of a PolygonSet. Invalidated by modification of the PolygonSet.
+    class PolygonView
+    {
+    public:
+        PolygonView(const Point *begin, const Point *end) : m_begin(begin), m_end(end) {}
+
+        const Point*    begin() const { return m_begin; }
+        const Point*    end()   const { return m_end; }
+        size_t          size()  const { return m_end - m_begin; }
+        bool            empty() const { return m_begin == m_end; }
+        const Point&    operator[](size_t idx) const { return m_begin[idx]; }
+        const Point&    front() const { return *m_begin; }
+        const Point&    back()  const { return *(m_end - 1); }
+
+        Polygon         polygon() const { return Polygon(Points(m_begin, m_end)); }
+        // Signed area, positive for a counter-clockwise polygon.
+        double          area() const;
+        // Same as Polygon::contains().
+        bool            contains(const Point &point) const;
+
+    private:
+        const Point    *m_begin;
+        const Point    *m_end;
+    };
+
+    PolygonSet() : m_polygon_begin(1, 0), m_expolygon_begin(1, 0) {}
+    // Each polygon is stored as an ExPolygon without holes.
+    explicit PolygonSet(const Polygons &polygons) : PolygonSet() { this->append(polygons); }
+    explicit PolygonSet(const ExPolygons &expolygons) : PolygonSet() { this->append(expolygons); }
+
+    PolygonSet& operator=(const Polygons &polygons) { this->clear(); this->append(polygons); return *this; }
+    PolygonSet& operator=(const ExPolygons &expolygons) { this->clear(); this->append(expolygons); return *this; }
+
+    void            clear();
+    void            reserve(size_t num_expolygons, size_t num_polygons, size_t num_points);
+    // Release the memory reserved above the current size.
+    void            shrink_to_fit();
+
+    bool            empty() const { return m_polygon_begin.size() == 1; }
+    size_t          num_points() const { return m_points.size(); }
+    size_t          num_polygons() const { return m_polygon_begin.size() - 1; }
+    size_t          num_expolygons() const { return m_expolygon_begin.size() - 1; }
+    // Points of all the polygons, in the order of the polygons.
+    const Points&   points() const { return m_points; }
+
+    // Polygons in the order they were appended, contours and holes of the ExPolygons.
+    PolygonView     polygon(size_t idx) const
+        { return PolygonView(m_points.data() + m_polygon_begin[idx], m_points.data() + m_polygon_begin[idx + 1]); }
+    // Contour and holes of an ExPolygon.
+    PolygonView     contour(size_t expolygon_idx) const { return this->polygon(m_expolygon_begin[expolygon_idx]); }
+    size_t          num_holes(size_t expolygon_idx) const { return m_expolygon_begin[expolygon_idx + 1] - m_expolygon_begin[expolygon_idx] - 1; }
+    PolygonView     hole(size_t expolygon_idx, size_t hole_idx) const { return this->polygon(m_expolygon_begin[expolygon_idx] + 1 + hole_idx); }
+    ExPolygon       expolygon(size_t expolygon_idx) const;
+
+    // Append a polygon as an ExPolygon without holes.
+    void            append(const Polygon &polygon);
+    void            append(const Polygons &polygons);
+    void            append(const ExPolygon &expolygon);
+    void            append(const ExPolygons &expolygons);
+    void            append(const Surfaces &surfaces);
+    void            append(const PolygonSet &other);
+
+    BoundingBox     bounding_box() const;
+    // Sum of the signed areas of all the polygons.
+    double          area() const;
+    // Is the point inside any of the ExPolygons?
+    bool            contains(const Point &point) const;
+    // Heap memory occupied by this PolygonSet.
+    size_t          memory_used() const;
+
+private:
+    void            append_polygon_points(const Points &points)
+        { m_points.insert(m_points.end(), points.begin(), points.end()); m_polygon_begin.emplace_back(m_points.size()); }
+
+    Points                  m_points;
+    // Index of the first point of each polygon in m_points, followed by the number of points.
+    std::vector<size_t>     m_polygon_begin;
+    // Index of the contour of each ExPolygon in m_polygon_begin, followed by the number of polygons.
+    std::vector<size_t>     m_expolygon_begin;
+};
+
+Polygons        to_polygons(const PolygonSet &src);
+ExPolygons      to_expolygons(const PolygonSet &src);
+void            polygons_append(Polygons &dst, const PolygonSet &src);
+inline BoundingBox get_extents(const PolygonSet &src) { return src.bounding_box(); }
+
+} // namespace Slic3r
+
+#endif /* slic3r_PolygonSet_hpp_ */
@@ -8,6 +8,7 @@
 #include "SupportMaterial.hpp"
 #include "GCode.hpp"
 #include "GCode/WipeTower.hpp"
+#include "Profiler.hpp"
 #include "Utils.hpp"
 
 //#include "PrintExport.hpp"
@@ -15,12 +16,15 @@
 #include <float.h>
 
 #include <algorithm>
+#include <exception>
 #include <limits>
 #include <unordered_set>
 #include <boost/filesystem/path.hpp>
 #include <boost/format.hpp>
 #include <boost/log/trivial.hpp>
 
+#include <tbb/parallel_for.h>
+
 //! macro used to mark string used at localization,
 //! return same string
 #define L(s) Slic3r::I18N::translate(s)
@@ -805,10 +809,9 @@ Print::ApplyStatus Print::apply(const Model &model, DynamicPrintConfig new_full_
         bool modifiers_differ           = model_volume_list_changed(model_object, model_object_new, ModelVolumeType::PARAMETER_MODIFIER);
         bool support_blockers_differ    = model_volume_list_changed(model_object, model_object_new, ModelVolumeType::SUPPORT_BLOCKER);
         bool support_enforcers_differ   = model_volume_list_changed(model_object, model_object_new, ModelVolumeType::SUPPORT_ENFORCER);
-        if (model_parts_differ || modifiers_differ || 
-            model_object.origin_translation         != model_object_new.origin_translation   ||
-            model_object.layer_height_profile       != model_object_new.layer_height_profile ||
-            ! layer_height_ranges_equal(model_object.layer_config_ranges, model_object_new.layer_config_ranges, model_object_new.layer_height_profile.empty())) {
+        bool layer_height_ranges_differ = ! layer_height_ranges_equal(model_object.layer_config_ranges, model_object_new.layer_config_ranges, model_object_new.layer_height_profile.empty());
+        if (model_parts_differ || modifiers_differ || layer_height_ranges_differ ||
+            model_object.origin_translation         != model_object_new.origin_translation) {
             // The very first step (the slicing step) is invalidated. One may freely remove all associated PrintObjects.
             auto range = print_object_status.equal_range(PrintObjectStatus(model_object.id()));
             for (auto it = range.first; it != range.second; ++ it) {
@@ -817,6 +820,21 @@ Print::ApplyStatus Print::apply(const Model &model, DynamicPrintConfig new_full_
             }
             // Copy content of the ModelObject including its ID, do not change the parent.
             model_object.assign_copy(model_object_new);
+        } else if (model_object.layer_height_profile != model_object_new.layer_height_profile) {
+            // Just the layer height profile changed, for example by the variable layer height tool.
+            // Keep the PrintObjects and their slices, so that just the layers with a changed Z span will be sliced again.
+            // First stop background processing before changing the layer height profile, which is read by PrintObject::slice().
+            this->call_cancel_callback();
+            update_apply_status(false);
+            auto range = print_object_status.equal_range(PrintObjectStatus(model_object.id()));
+            for (auto it = range.first; it != range.second; ++ it)
+                update_apply_status(it->print_object->invalidate_layer_height_profile());
+            model_object.layer_height_profile = model_object_new.layer_height_profile;
+            if (support_blockers_differ || support_enforcers_differ) {
+                for (auto it = range.first; it != range.second; ++ it)
+                    update_apply_status(it->print_object->invalidate_step(posSupportMaterial));
+                model_volume_list_update_supports(model_object, model_object_new);
+            }
         } else if (support_blockers_differ || support_enforcers_differ) {
             // First stop background processing before shuffling or deleting the ModelVolumes in the ModelObject's list.
             this->call_cancel_callback();
@@ -1486,18 +1504,44 @@ void Print::auto_assign_extruders(ModelObject* model_object) const
 // Slicing process, running at a background thread.
 void Print::process()
 {
+    SLIC3R_PROFILE_ZONE("Print::process");
     BOOST_LOG_TRIVIAL(info) << "Staring the slicing process." << log_memory_info();
-    for (PrintObject *obj : m_objects)
-        obj->make_perimeters();
+    // The steps of a single PrintObject depend on each other (slices -> perimeters -> infill -> support material),
+    // while the PrintObjects are independent of each other. Process the PrintObjects concurrently, so that
+    // the next step of a PrintObject is started as soon as its previous step finished, without waiting for the other
+    // PrintObjects. The layer parallel loops of the individual steps are nested into the PrintObject tasks,
+    // therefore a plate of many small objects saturates the worker threads as well as a single large object.
+    // An exception thrown by a step must not escape a PrintObject task: TBB would cancel the nested layer loops
+    // of the other PrintObjects silently, and their steps would be marked as done with incomplete data.
+    // The first exception is captured and rethrown once all the PrintObject tasks finished.
+    // The objects are perimetered and infilled concurrently, the status of the infill step is reported once for all of them.
     this->set_status(70, L("Infilling layers"));
-    for (PrintObject *obj : m_objects)
-        obj->infill();
-    for (PrintObject *obj : m_objects)
-        obj->generate_support_material();
+    std::exception_ptr  exception;
+    tbb::mutex          exception_mutex;
+    tbb::parallel_for(
+        tbb::blocked_range<size_t>(0, m_objects.size(), 1),
+        [this, &exception, &exception_mutex](const tbb::blocked_range<size_t> &range) {
+            for (size_t idx_object = range.begin(); idx_object < range.end(); ++ idx_object) {
+                PrintObject *obj = m_objects[idx_object];
+                SLIC3R_PROFILE_ZONE("Print::process_object");
+                try {
+                    obj->make_perimeters();
+                    obj->infill();
+                    obj->generate_support_material();
+                } catch (...) {
+                    tbb::mutex::scoped_lock lock(exception_mutex);
+                    if (! exception)
+                        exception = std::current_exception();
+                }
+            }
+        });
+    if (exception)
+        std::rethrow_exception(exception);
     if (this->set_started(psSkirt)) {
         m_skirt.clear();
         if (this->has_skirt()) {
             this->set_status(88, L("Generating skirt"));
+            SLIC3R_PROFILE_ZONE("Print::make_skirt");
             this->_make_skirt();
         }
         this->set_done(psSkirt);
@@ -1506,6 +1550,7 @@ void Print::process()
         m_brim.clear();
         if (m_config.brim_width > 0) {
             this->set_status(88, L("Generating brim"));
+            SLIC3R_PROFILE_ZONE("Print::make_brim");
             this->_make_brim();
         }
        this->set_done(psBrim);
@@ -1514,6 +1559,7 @@ void Print::process()
         m_wipe_tower_data.clear();
         if (this->has_wipe_tower()) {
             //this->set_status(95, L("Generating wipe tower"));
+            SLIC3R_PROFILE_ZONE("Print::make_wipe_tower");
             this->_make_wipe_tower();
         }
        this->set_done(psWipeTower);
@@ -1525,7 +1571,7 @@ void Print::process()
 // The export_gcode may die for various reasons (fails to process output_filename_format,
 // write error into the G-code, cannot execute post-processing scripts).
 // It is up to the caller to show an error message.
-std::string Print::export_gcode(const std::string &path_template, GCodePreviewData *preview_data)
+std::string Print::export_gcode(const std::string &path_template, GCodePreviewData *preview_data, bool pipelined)
 {
     // output everything to a G-code file
     // The following call may die if the output_filename_format template substitution fails.
@@ -1542,6 +1588,7 @@ std::string Print::export_gcode(const std::string &path_template, GCodePreviewDa
 
     // The following line may die for multiple reasons.
     GCode gcode;
+    gcode.set_pipelined_export(pipelined);
     gcode.do_export(this, path.c_str(), preview_data);
     return path.c_str();
 }
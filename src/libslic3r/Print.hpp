@@ -160,6 +160,9 @@ protected:
     bool                    invalidate_step(PrintObjectStep step);
     // Invalidates all PrintObject and Print steps.
     bool                    invalidate_all_steps();
+    // Invalidates the slicing step after a change of the layer height profile. Contrary to invalidate_step(posSlice),
+    // the slices of the layers are retained, so that only the layers with a changed Z span will be sliced again by _slice().
+    bool                    invalidate_layer_height_profile();
     // Invalidate steps based on a set of parameters changed.
     bool                    invalidate_state_by_config_options(const std::vector<t_config_option_key> &opt_keys);
     // If ! m_slicing_params.valid, recalculate.
@@ -202,6 +205,16 @@ private:
     LayerPtrs                               m_layers;
     SupportLayerPtrs                        m_support_layers;
 
+    // Slices of the regions of a single layer as produced by slicing the meshes, before the XY compensation.
+    struct LayerSlices {
+        float                               slice_z;
+        std::vector<ExPolygons>             region_slices;
+        bool operator<(float z) const { return this->slice_z < z; }
+    };
+    // Slices of all layers sorted by slice_z, retained by invalidate_layer_height_profile() and reused by _slice().
+    // Filled only if Print::layer_slices_cache_enabled() and the object has a variable layer height profile.
+    std::vector<LayerSlices>                m_layer_slices_cache;
+
     std::vector<ExPolygons> slice_region(size_t region_id, const std::vector<float> &z) const;
     std::vector<ExPolygons> slice_modifiers(size_t region_id, const std::vector<float> &z) const;
     std::vector<ExPolygons> slice_volumes(const std::vector<float> &z, const std::vector<const ModelVolume*> &volumes) const;
@@ -301,7 +314,8 @@ public:
     void                process() override;
     // Exports G-code into a file name based on the path_template, returns the file path of the generated G-code file.
     // If preview_data is not null, the preview_data is filled in for the G-code visualization (not used by the command line Slic3r).
-    std::string         export_gcode(const std::string &path_template, GCodePreviewData *preview_data);
+    // If pipelined is false, the layers are generated and post-processed on the calling thread only (for comparison and debugging).
+    std::string         export_gcode(const std::string &path_template, GCodePreviewData *preview_data, bool pipelined = true);
 
     // methods for handling state
     bool                is_step_done(PrintStep step) const { return Inherited::is_step_done(step); }
@@ -329,6 +343,10 @@ public:
     bool                has_support_material() const;
     // Make sure the background processing has no access to this model_object during this call!
     void                auto_assign_extruders(ModelObject* model_object) const;
+    // Retain the slices of the objects with a variable layer height profile, so that an edit of the profile slices
+    // just the layers with a changed Z span. The retained slices take as much memory as the slices, only the GUI enables it.
+    void                enable_layer_slices_cache(bool enable) { m_layer_slices_cache_enabled = enable; }
+    bool                layer_slices_cache_enabled() const { return m_layer_slices_cache_enabled; }
 
     const PrintConfig&          config() const { return m_config; }
     const PrintObjectConfig&    default_object_config() const { return m_default_object_config; }
@@ -401,6 +419,8 @@ private:
     // Estimated print time, filament consumed.
     PrintStatistics                         m_print_statistics;
 
+    bool                                    m_layer_slices_cache_enabled = false;
+
     // To allow GCode to set the Print's GCodeExport step status.
     friend class GCode;
     // Allow PrintObject to access m_mutex and m_cancel_callback.
@@ -285,7 +285,9 @@ public:
     // Register a custom status callback.
     void                    set_status_callback(status_callback_type cb) { m_status_callback = cb; }
     // Calls a registered callback to update the status, or print out the default message.
+    // The steps of multiple PrintObjects are processed concurrently, the calls are serialized.
     void                    set_status(int percent, const std::string &message, unsigned int flags = SlicingStatus::DEFAULT) {
+        tbb::mutex::scoped_lock lock(m_status_mutex);
 		if (m_status_callback) m_status_callback(SlicingStatus(percent, message, flags));
         else printf("%d => %s\n", percent, message.c_str());
     }
@@ -348,6 +350,8 @@ private:
     tbb::atomic<CancelStatus>               m_cancel_status;
     // Callback to be evoked regularly to update state of the UI thread.
     status_callback_type                    m_status_callback;
+    // Serializes the calls of m_status_callback.
+    tbb::mutex                              m_status_mutex;
 
     // Callback to be evoked to stop the background processing before a state is updated.
     cancel_callback_type                    m_cancel_callback = [](){};
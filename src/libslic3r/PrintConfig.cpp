@@ -3187,6 +3187,14 @@ CLIActionsConfigDef::CLIActionsConfigDef()
     def->tooltip = L("Show the full list of SLA print configuration options.");
     def->set_default_value(new ConfigOptionBool(false));
 
+    def = this->add("analyze_gcode", coString);
+    def->label = L("Analyze G-code");
+    def->tooltip = L("Analyze an existing G-code file and write the estimated printing times, the filament usage "
+                     "and the per layer statistics as JSON to the file given by --output, or to the standard output. "
+                     "The firmware flavor, the machine limits and the filament parameters are taken from the loaded configuration, "
+                     "the configuration of a PrusaSlicer G-code is loaded by --load <file.gcode>.");
+    def->set_default_value(new ConfigOptionString());
+
     def = this->add("info", coBool);
     def->label = L("Output Model Info");
     def->tooltip = L("Write information about the model to the console.");
@@ -3314,6 +3322,17 @@ CLIMiscConfigDef::CLIMiscConfigDef()
     def->label = L("Data directory");
     def->tooltip = L("Load and store settings at the given directory. This is useful for maintaining different profiles or including configurations from a network storage.");
 
+    def = this->add("serial_gcode_export", coBool);
+    def->label = L("Serial G-code export");
+    def->tooltip = L("Generate and post-process the G-code layer by layer on a single thread instead of in a pipeline. "
+                     "The output is identical, this option is meant for comparison and debugging.");
+
+    def = this->add("profile_trace", coString);
+    def->label = L("Profile trace");
+    def->tooltip = L("Record the time spent in the individual slicing and G-code export steps on all threads "
+                     "and save it to the given file as a JSON timeline in the Chrome Trace Event format "
+                     "(to be viewed by chrome://tracing or https://ui.perfetto.dev).");
+
     def = this->add("loglevel", coInt);
     def->label = L("Logging level");
     def->tooltip = L("Messages with severity lower or eqal to the loglevel will be printed out. 0:trace, 1:debug, 2:info, 3:warning, 4:error, 5:fatal");
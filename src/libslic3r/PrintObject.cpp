@@ -3,6 +3,7 @@
 #include "ClipperUtils.hpp"
 #include "Geometry.hpp"
 #include "I18N.hpp"
+#include "Profiler.hpp"
 #include "SupportMaterial.hpp"
 #include "Surface.hpp"
 #include "Slicing.hpp"
@@ -107,6 +108,7 @@ void PrintObject::slice()
 {
     if (! this->set_started(posSlice))
         return;
+    SLIC3R_PROFILE_ZONE("PrintObject::slice");
     m_print->set_status(10, L("Processing triangulated mesh"));
     std::vector<coordf_t> layer_height_profile;
     this->update_layer_height_profile(*this->model_object(), m_slicing_params, layer_height_profile);
@@ -137,6 +139,7 @@ void PrintObject::make_perimeters()
 
     if (! this->set_started(posPerimeters))
         return;
+    SLIC3R_PROFILE_ZONE("PrintObject::make_perimeters");
 
     m_print->set_status(20, L("Generating perimeters"));
     BOOST_LOG_TRIVIAL(info) << "Generating perimeters..." << log_memory_info();
@@ -226,6 +229,7 @@ void PrintObject::make_perimeters()
         [this](const tbb::blocked_range<size_t>& range) {
             for (size_t layer_idx = range.begin(); layer_idx < range.end(); ++ layer_idx) {
                 m_print->throw_if_canceled();
+                SLIC3R_PROFILE_ZONE("Layer::make_perimeters");
                 m_layers[layer_idx]->make_perimeters();
             }
         }
@@ -247,6 +251,7 @@ void PrintObject::prepare_infill()
 {
     if (! this->set_started(posPrepareInfill))
         return;
+    SLIC3R_PROFILE_ZONE("PrintObject::prepare_infill");
 
     m_print->set_status(30, L("Preparing infill"));
 
@@ -364,12 +369,14 @@ void PrintObject::infill()
     this->prepare_infill();
 
     if (this->set_started(posInfill)) {
+        SLIC3R_PROFILE_ZONE("PrintObject::infill");
         BOOST_LOG_TRIVIAL(debug) << "Filling layers in parallel - start";
         tbb::parallel_for(
             tbb::blocked_range<size_t>(0, m_layers.size()),
             [this](const tbb::blocked_range<size_t>& range) {
                 for (size_t layer_idx = range.begin(); layer_idx < range.end(); ++ layer_idx) {
                     m_print->throw_if_canceled();
+                    SLIC3R_PROFILE_ZONE("Layer::make_fills");
                     m_layers[layer_idx]->make_fills();
                 }
             }
@@ -386,6 +393,7 @@ void PrintObject::infill()
 void PrintObject::generate_support_material()
 {
     if (this->set_started(posSupportMaterial)) {
+        SLIC3R_PROFILE_ZONE("PrintObject::generate_support_material");
         this->clear_support_layers();
         if ((m_config.support_material || m_config.raft_layers > 0) && m_layers.size() > 1) {
             m_print->set_status(85, L("Generating support material"));    
@@ -574,6 +582,11 @@ bool PrintObject::invalidate_step(PrintObjectStep step)
 		invalidated |= this->invalidate_steps({ posPerimeters, posPrepareInfill, posInfill, posSupportMaterial });
 		invalidated |= m_print->invalidate_steps({ psSkirt, psBrim });
         this->m_slicing_params.valid = false;
+        // The slicing step may have been invalidated by a change of a parameter affecting the slices.
+        this->m_layer_slices_cache.clear();
+        // Release the edge grids calculated over the layer slices by the G-code export.
+        for (Layer *layer : m_layers)
+            layer->clear_slices_edge_grid();
     } else if (step == posSupportMaterial) {
         invalidated |= m_print->invalidate_steps({ psSkirt, psBrim });
         this->m_slicing_params.valid = false;
@@ -595,9 +608,19 @@ bool PrintObject::invalidate_all_steps()
 	// Then reset some of the depending values.
 	this->m_slicing_params.valid = false;
 	this->region_volumes.clear();
+	this->m_layer_slices_cache.clear();
 	return result;
 }
 
+bool PrintObject::invalidate_layer_height_profile()
+{
+	// invalidate_step(posSlice) drops the cached slices, retain them.
+	std::vector<LayerSlices> layer_slices_cache = std::move(m_layer_slices_cache);
+	bool invalidated = this->invalidate_step(posSlice);
+	m_layer_slices_cache = std::move(layer_slices_cache);
+	return invalidated;
+}
+
 bool PrintObject::has_support_material() const
 {
     return m_config.support_material
@@ -616,6 +639,7 @@ bool PrintObject::has_support_material() const
 // If a part of a region is of stBottom and stTop, the stBottom wins.
 void PrintObject::detect_surfaces_type()
 {
+    SLIC3R_PROFILE_ZONE("PrintObject::detect_surfaces_type");
     BOOST_LOG_TRIVIAL(info) << "Detecting solid surfaces..." << log_memory_info();
 
     // Interface shells: the intersecting parts are treated as self standing objects supporting each other.
@@ -808,6 +832,7 @@ void PrintObject::detect_surfaces_type()
 
 void PrintObject::process_external_surfaces()
 {
+    SLIC3R_PROFILE_ZONE("PrintObject::process_external_surfaces");
     BOOST_LOG_TRIVIAL(info) << "Processing external surfaces..." << log_memory_info();
 
 	for (size_t region_id = 0; region_id < this->region_volumes.size(); ++region_id) {
@@ -830,15 +855,16 @@ void PrintObject::process_external_surfaces()
 void PrintObject::discover_vertical_shells()
 {
     PROFILE_FUNC();
+    SLIC3R_PROFILE_ZONE("PrintObject::discover_vertical_shells");
 
     BOOST_LOG_TRIVIAL(info) << "Discovering vertical shells..." << log_memory_info();
 
     struct DiscoverVerticalShellsCacheEntry
     {
         // Collected polygons, offsetted
-        Polygons    top_surfaces;
-        Polygons    bottom_surfaces;
-        Polygons    holes;
+        PolygonSet  top_surfaces;
+        PolygonSet  bottom_surfaces;
+        PolygonSet  holes;
     };
     std::vector<DiscoverVerticalShellsCacheEntry> cache_top_botom_regions(m_layers.size(), DiscoverVerticalShellsCacheEntry());
     bool top_bottom_surfaces_all_regions = this->region_volumes.size() > 1 && ! m_config.interface_shells.value;
@@ -869,6 +895,9 @@ void PrintObject::discover_vertical_shells()
                     m_print->throw_if_canceled();
                     const Layer                      &layer = *m_layers[idx_layer];
                     DiscoverVerticalShellsCacheEntry &cache = cache_top_botom_regions[idx_layer];
+                    Polygons                          top_surfaces;
+                    Polygons                          bottom_surfaces;
+                    Polygons                          holes;
                     // Simulate single set of perimeters over all merged regions.
                     float                             perimeter_offset = 0.f;
                     float                             perimeter_min_spacing = FLT_MAX;
@@ -880,11 +909,11 @@ void PrintObject::discover_vertical_shells()
                         LayerRegion &layerm                       = *layer.m_regions[idx_region];
                         float        min_perimeter_infill_spacing = float(layerm.flow(frSolidInfill).scaled_spacing()) * 1.05f;
                         // Top surfaces.
-                        append(cache.top_surfaces, offset(to_expolygons(layerm.slices.filter_by_type(stTop)), min_perimeter_infill_spacing));
-                        append(cache.top_surfaces, offset(to_expolygons(layerm.fill_surfaces.filter_by_type(stTop)), min_perimeter_infill_spacing));
+                        append(top_surfaces, offset(to_expolygons(layerm.slices.filter_by_type(stTop)), min_perimeter_infill_spacing));
+                        append(top_surfaces, offset(to_expolygons(layerm.fill_surfaces.filter_by_type(stTop)), min_perimeter_infill_spacing));
                         // Bottom surfaces.
-                        append(cache.bottom_surfaces, offset(to_expolygons(layerm.slices.filter_by_types(surfaces_bottom, 2)), min_perimeter_infill_spacing));
-                        append(cache.bottom_surfaces, offset(to_expolygons(layerm.fill_surfaces.filter_by_types(surfaces_bottom, 2)), min_perimeter_infill_spacing));
+                        append(bottom_surfaces, offset(to_expolygons(layerm.slices.filter_by_types(surfaces_bottom, 2)), min_perimeter_infill_spacing));
+                        append(bottom_surfaces, offset(to_expolygons(layerm.fill_surfaces.filter_by_types(surfaces_bottom, 2)), min_perimeter_infill_spacing));
                         // Calculate the maximum perimeter offset as if the slice was extruded with a single extruder only.
                         // First find the maxium number of perimeters per region slice.
                         unsigned int perimeters = 0;
@@ -899,26 +928,26 @@ void PrintObject::discover_vertical_shells()
                                 0.5f * float(extflow.scaled_width() + extflow.scaled_spacing()) + (float(perimeters) - 1.f) * flow.scaled_spacing());
                             perimeter_min_spacing = std::min(perimeter_min_spacing, float(std::min(extflow.scaled_spacing(), flow.scaled_spacing())));
                         }
-                        polygons_append(cache.holes, to_polygons(layerm.fill_expolygons));
+                        polygons_append(holes, layerm.fill_expolygons);
                     }
                     // Save some computing time by reducing the number of polygons.
-                    cache.top_surfaces    = union_(cache.top_surfaces,    false);
-                    cache.bottom_surfaces = union_(cache.bottom_surfaces, false);
+                    cache.top_surfaces    = union_(top_surfaces,    false);
+                    cache.bottom_surfaces = union_(bottom_surfaces, false);
                     // For a multi-material print, simulate perimeter / infill split as if only a single extruder has been used for the whole print.
                     if (perimeter_offset > 0.) {
                         // The layer.slices are forced to merge by expanding them first.
-                        polygons_append(cache.holes, offset(offset_ex(layer.slices, 0.3f * perimeter_min_spacing), - perimeter_offset - 0.3f * perimeter_min_spacing));
+                        polygons_append(holes, offset(offset_ex(layer.slices, 0.3f * perimeter_min_spacing), - perimeter_offset - 0.3f * perimeter_min_spacing));
 #ifdef SLIC3R_DEBUG_SLICE_PROCESSING
                         {
                             Slic3r::SVG svg(debug_out_path("discover_vertical_shells-extra-holes-%d.svg", debug_idx), get_extents(layer.slices.expolygons));
                             svg.draw(layer.slices.expolygons, "blue");
-                            svg.draw(union_ex(cache.holes), "red");
-                            svg.draw_outline(union_ex(cache.holes), "black", "blue", scale_(0.05));
+                            svg.draw(union_ex(holes), "red");
+                            svg.draw_outline(union_ex(holes), "black", "blue", scale_(0.05));
                             svg.Close(); 
                         }
 #endif /* SLIC3R_DEBUG_SLICE_PROCESSING */
                     }
-                    cache.holes = union_(cache.holes, false);
+                    cache.holes = union_(holes, false);
                 }
             });
         m_print->throw_if_canceled();
@@ -957,14 +986,14 @@ void PrintObject::discover_vertical_shells()
                         // Top surfaces.
                         auto &cache = cache_top_botom_regions[idx_layer];
                         cache.top_surfaces = offset(to_expolygons(layerm.slices.filter_by_type(stTop)), min_perimeter_infill_spacing);
-                        append(cache.top_surfaces, offset(to_expolygons(layerm.fill_surfaces.filter_by_type(stTop)), min_perimeter_infill_spacing));
+                        cache.top_surfaces.append(offset(to_expolygons(layerm.fill_surfaces.filter_by_type(stTop)), min_perimeter_infill_spacing));
                         // Bottom surfaces.
                         cache.bottom_surfaces = offset(to_expolygons(layerm.slices.filter_by_types(surfaces_bottom, 2)), min_perimeter_infill_spacing);
-                        append(cache.bottom_surfaces, offset(to_expolygons(layerm.fill_surfaces.filter_by_types(surfaces_bottom, 2)), min_perimeter_infill_spacing));
+                        cache.bottom_surfaces.append(offset(to_expolygons(layerm.fill_surfaces.filter_by_types(surfaces_bottom, 2)), min_perimeter_infill_spacing));
                         // Holes over all regions. Only collect them once, they are valid for all idx_region iterations.
                         if (cache.holes.empty()) {
                             for (size_t idx_region = 0; idx_region < layer.regions().size(); ++ idx_region)
-                                polygons_append(cache.holes, to_polygons(layer.regions()[idx_region]->fill_expolygons));
+                                cache.holes.append(layer.regions()[idx_region]->fill_expolygons);
                         }
                     }
                 });
@@ -1214,6 +1243,7 @@ void PrintObject::discover_vertical_shells()
    sparse infill */
 void PrintObject::bridge_over_infill()
 {
+    SLIC3R_PROFILE_ZONE("PrintObject::bridge_over_infill");
     BOOST_LOG_TRIVIAL(info) << "Bridge over infill..." << log_memory_info();
 
     for (size_t region_id = 0; region_id < this->region_volumes.size(); ++ region_id) {
@@ -1464,6 +1494,7 @@ bool PrintObject::update_layer_height_profile(const ModelObject &model_object, c
 // this should be idempotent
 void PrintObject::_slice(const std::vector<coordf_t> &layer_height_profile)
 {
+    SLIC3R_PROFILE_ZONE("PrintObject::_slice");
     BOOST_LOG_TRIVIAL(info) << "Slicing objects..." << log_memory_info();
 
     this->typed_slices = false;
@@ -1476,6 +1507,8 @@ void PrintObject::_slice(const std::vector<coordf_t> &layer_height_profile)
 
     // 1) Initialize layers and their slice heights.
     std::vector<float> slice_zs;
+    // Indices of layers to be sliced, one for each slice_zs.
+    std::vector<size_t> slice_layer_ids;
     {
         this->clear_layers();
         // Object layers (pairs of bottom/top Z coordinate), without the raft.
@@ -1499,6 +1532,25 @@ void PrintObject::_slice(const std::vector<coordf_t> &layer_height_profile)
                 layer->add_region(this->print()->regions()[region_id]);
             prev = layer;
         }
+        // Reuse the slices retained from the previous slicing for the layers of the same slice_z,
+        // slice just the layers with a changed Z span.
+        size_t num_reused = 0;
+        slice_layer_ids.reserve(slice_zs.size());
+        for (size_t layer_id = 0; layer_id < slice_zs.size(); ++ layer_id) {
+            float slice_z = slice_zs[layer_id];
+            auto  it      = std::lower_bound(m_layer_slices_cache.begin(), m_layer_slices_cache.end(), slice_z);
+            if (it != m_layer_slices_cache.end() && it->slice_z == slice_z && it->region_slices.size() == this->region_volumes.size()) {
+                for (size_t region_id = 0; region_id < it->region_slices.size(); ++ region_id)
+                    m_layers[layer_id]->regions()[region_id]->slices.append(it->region_slices[region_id], stInternal);
+                ++ num_reused;
+            } else {
+                slice_zs[layer_id - num_reused] = slice_z;
+                slice_layer_ids.emplace_back(layer_id);
+            }
+        }
+        slice_zs.erase(slice_zs.end() - num_reused, slice_zs.end());
+        if (num_reused > 0)
+            BOOST_LOG_TRIVIAL(info) << "Slicing objects - reusing slices of " << num_reused << " layers, slicing " << slice_zs.size() << " layers";
     }
 
     // Count model parts and modifier meshes, check whether the model parts are of the same region.
@@ -1542,8 +1594,8 @@ void PrintObject::_slice(const std::vector<coordf_t> &layer_height_profile)
             std::vector<ExPolygons> expolygons_by_layer = this->slice_region(region_id, slice_zs);
             m_print->throw_if_canceled();
             BOOST_LOG_TRIVIAL(debug) << "Slicing objects - append slices " << region_id << " start";
-            for (size_t layer_id = 0; layer_id < expolygons_by_layer.size(); ++ layer_id)
-                m_layers[layer_id]->regions()[region_id]->slices.append(std::move(expolygons_by_layer[layer_id]), stInternal);
+            for (size_t i = 0; i < expolygons_by_layer.size(); ++ i)
+                m_layers[slice_layer_ids[i]]->regions()[region_id]->slices.append(std::move(expolygons_by_layer[i]), stInternal);
             m_print->throw_if_canceled();
             BOOST_LOG_TRIVIAL(debug) << "Slicing objects - append slices " << region_id << " end";
         }
@@ -1587,7 +1639,7 @@ void PrintObject::_slice(const std::vector<coordf_t> &layer_height_profile)
         BOOST_LOG_TRIVIAL(debug) << "Slicing objects - parallel clipping - start";
         tbb::parallel_for(
             tbb::blocked_range<size_t>(0, slice_zs.size()),
-            [this, &sliced_volumes, num_modifiers](const tbb::blocked_range<size_t>& range) {
+            [this, &sliced_volumes, &slice_layer_ids, num_modifiers](const tbb::blocked_range<size_t>& range) {
                 float delta   = float(scale_(m_config.xy_size_compensation.value));
                 // Only upscale together with clipping if there are no modifiers, as the modifiers shall be applied before upscaling
                 // (upscaling may grow the object outside of the modifier mesh).
@@ -1622,7 +1674,7 @@ void PrintObject::_slice(const std::vector<coordf_t> &layer_height_profile)
                         if (num_volumes > 1)
                             // Merge the islands using a positive / negative offset.
                             expolygons = offset_ex(offset_ex(expolygons, float(scale_(EPSILON))), -float(scale_(EPSILON)));
-                        m_layers[layer_id]->regions()[region_id]->slices.append(std::move(expolygons), stInternal);
+                        m_layers[slice_layer_ids[layer_id]]->regions()[region_id]->slices.append(std::move(expolygons), stInternal);
                     }
                 }
             });
@@ -1643,13 +1695,13 @@ void PrintObject::_slice(const std::vector<coordf_t> &layer_height_profile)
             // loop through the other regions and 'steal' the slices belonging to this one
             BOOST_LOG_TRIVIAL(debug) << "Slicing modifier volumes - stealing " << region_id << " start";
             tbb::parallel_for(
-                tbb::blocked_range<size_t>(0, m_layers.size()),
-				[this, &expolygons_by_layer, region_id](const tbb::blocked_range<size_t>& range) {
+                tbb::blocked_range<size_t>(0, expolygons_by_layer.size()),
+				[this, &expolygons_by_layer, &slice_layer_ids, region_id](const tbb::blocked_range<size_t>& range) {
                     for (size_t layer_id = range.begin(); layer_id < range.end(); ++ layer_id) {
                         for (size_t other_region_id = 0; other_region_id < this->region_volumes.size(); ++ other_region_id) {
                             if (region_id == other_region_id)
                                 continue;
-                            Layer       *layer = m_layers[layer_id];
+                            Layer       *layer = m_layers[slice_layer_ids[layer_id]];
                             LayerRegion *layerm = layer->m_regions[region_id];
                             LayerRegion *other_layerm = layer->m_regions[other_region_id];
                             if (layerm == nullptr || other_layerm == nullptr || other_layerm->slices.empty() || expolygons_by_layer[layer_id].empty())
@@ -1670,6 +1722,27 @@ void PrintObject::_slice(const std::vector<coordf_t> &layer_height_profile)
         }
     }
     
+    // Retain the slices before the XY compensation is applied, to be reused by the next slicing
+    // if just the layer height profile changes. Otherwise release the slices reused by this slicing.
+    if (! m_print->layer_slices_cache_enabled() || this->model_object()->layer_height_profile.empty())
+        std::vector<LayerSlices>().swap(m_layer_slices_cache);
+    else {
+        m_layer_slices_cache.assign(m_layers.size(), LayerSlices());
+        tbb::parallel_for(
+            tbb::blocked_range<size_t>(0, m_layers.size()),
+            [this](const tbb::blocked_range<size_t>& range) {
+                for (size_t layer_id = range.begin(); layer_id < range.end(); ++ layer_id) {
+                    const Layer *layer       = m_layers[layer_id];
+                    LayerSlices &layer_slices = m_layer_slices_cache[layer_id];
+                    layer_slices.slice_z = float(layer->slice_z);
+                    layer_slices.region_slices.reserve(layer->regions().size());
+                    for (const LayerRegion *layerm : layer->regions())
+                        layer_slices.region_slices.emplace_back(to_expolygons(layerm->slices.surfaces));
+                }
+            });
+        m_print->throw_if_canceled();
+    }
+
     BOOST_LOG_TRIVIAL(debug) << "Slicing objects - removing top empty layers";
     while (! m_layers.empty()) {
         const Layer *layer = m_layers.back();
@@ -1908,7 +1981,7 @@ std::vector<ExPolygons> PrintObject::slice_support_volumes(const ModelVolumeType
 std::vector<ExPolygons> PrintObject::slice_volumes(const std::vector<float> &z, const std::vector<const ModelVolume*> &volumes) const
 {
     std::vector<ExPolygons> layers;
-    if (! volumes.empty()) {
+    if (! volumes.empty() && ! z.empty()) {
         // Compose mesh.
         //FIXME better to perform slicing over each volume separately and then to use a Boolean operation to merge them.
 		TriangleMesh mesh(volumes.front()->mesh());
@@ -2223,6 +2296,7 @@ void PrintObject::_make_perimeters()
 // fill_surfaces but we only turn them into VOID surfaces, thus preserving the boundaries.
 void PrintObject::clip_fill_surfaces()
 {
+    SLIC3R_PROFILE_ZONE("PrintObject::clip_fill_surfaces");
     if (! m_config.infill_only_where_needed.value ||
         ! std::any_of(this->print()->regions().begin(), this->print()->regions().end(), 
             [](const PrintRegion *region) { return region->config().fill_density > 0; }))
@@ -2302,6 +2376,7 @@ void PrintObject::clip_fill_surfaces()
 
 void PrintObject::discover_horizontal_shells()
 {
+    SLIC3R_PROFILE_ZONE("PrintObject::discover_horizontal_shells");
     BOOST_LOG_TRIVIAL(trace) << "discover_horizontal_shells()";
     
     for (size_t region_id = 0; region_id < this->region_volumes.size(); ++ region_id) {
@@ -2493,6 +2568,7 @@ void PrintObject::discover_horizontal_shells()
 // fill_surfaces but we only turn them into VOID surfaces, thus preserving the boundaries.
 void PrintObject::combine_infill()
 {
+    SLIC3R_PROFILE_ZONE("PrintObject::combine_infill");
     // Work on each region separately.
     for (size_t region_id = 0; region_id < this->region_volumes.size(); ++ region_id) {
         const PrintRegion *region = this->print()->regions()[region_id];
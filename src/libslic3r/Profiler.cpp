@@ -0,0 +1,145 @@
+#include "Profiler.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <map>
+
+#include <boost/nowide/cstdio.hpp>
+
+#include <tbb/enumerable_thread_specific.h>
+
+namespace Slic3r {
+namespace Profiler {
+
+namespace detail {
+
+std::atomic<bool> g_recording(false);
+
+struct Event
+{
+    const char *name;
+    int64_t     begin;
+    int64_t     end;
+};
+
+// Each thread records into its own vector, no locking is needed while recording.
+static tbb::enumerable_thread_specific<std::vector<Event>> g_events;
+// Time of the start() call, the exported timestamps are relative to it.
+static int64_t g_time_start = 0;
+
+int64_t now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void record(const char *name, int64_t begin, int64_t end)
+{
+    std::vector<Event> &events = g_events.local();
+    events.push_back({ name, begin, end });
+}
+
+} // namespace detail
+
+void start()
+{
+    detail::g_events.clear();
+    detail::g_time_start = detail::now();
+    detail::g_recording.store(true);
+}
+
+void stop()
+{
+    detail::g_recording.store(false);
+}
+
+std::vector<ZoneStats> summarize()
+{
+    // Intervals of the zones grouped by name. The same name may be stored at different addresses by different compilation units.
+    std::map<std::string, std::vector<std::pair<int64_t, int64_t>>> intervals_by_name;
+    for (const std::vector<detail::Event> &events : detail::g_events)
+        for (const detail::Event &event : events)
+            intervals_by_name[event.name].emplace_back(event.begin, event.end);
+
+    std::vector<std::pair<int64_t, ZoneStats>> stats;
+    stats.reserve(intervals_by_name.size());
+    for (auto &name_and_intervals : intervals_by_name) {
+        std::vector<std::pair<int64_t, int64_t>> &intervals = name_and_intervals.second;
+        std::sort(intervals.begin(), intervals.end());
+        ZoneStats zone_stats;
+        zone_stats.name  = name_and_intervals.first;
+        zone_stats.count = intervals.size();
+        int64_t total = 0;
+        int64_t wall  = 0;
+        // Merge the overlapping intervals to get the wall clock time.
+        int64_t begin = intervals.front().first;
+        int64_t end   = intervals.front().second;
+        for (const std::pair<int64_t, int64_t> &interval : intervals) {
+            total += interval.second - interval.first;
+            if (interval.first > end) {
+                wall += end - begin;
+                begin = interval.first;
+                end   = interval.second;
+            } else
+                end = std::max(end, interval.second);
+        }
+        wall += end - begin;
+        zone_stats.total = double(total) * 1e-9;
+        zone_stats.wall  = double(wall) * 1e-9;
+        stats.emplace_back(intervals.front().first, std::move(zone_stats));
+    }
+    std::sort(stats.begin(), stats.end(), [](const std::pair<int64_t, ZoneStats> &l, const std::pair<int64_t, ZoneStats> &r) { return l.first < r.first; });
+
+    std::vector<ZoneStats> out;
+    out.reserve(stats.size());
+    for (std::pair<int64_t, ZoneStats> &s : stats)
+        out.emplace_back(std::move(s.second));
+    return out;
+}
+
+// Write a string as a JSON string literal.
+static void write_json_string(FILE *file, const char *str)
+{
+    fputc('"', file);
+    for (const char *c = str; *c != 0; ++ c) {
+        if (*c == '"' || *c == '\\')
+            fputc('\\', file);
+        if ((unsigned char)*c < 0x20)
+            fprintf(file, "\\u%04x", (unsigned int)(unsigned char)*c);
+        else
+            fputc(*c, file);
+    }
+    fputc('"', file);
+}
+
+bool export_chrome_trace(const std::string &path)
+{
+    FILE *file = boost::nowide::fopen(path.c_str(), "wb");
+    if (file == nullptr)
+        return false;
+
+    fprintf(file, "{\"traceEvents\":[\n");
+    bool first = true;
+    int  tid   = 0;
+    for (const std::vector<detail::Event> &events : detail::g_events) {
+        if (events.empty())
+            continue;
+        ++ tid;
+        fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"Thread %d\"}}", first ? "" : ",\n", tid, tid);
+        first = false;
+        for (const detail::Event &event : events) {
+            fprintf(file, ",\n{\"name\":");
+            write_json_string(file, event.name);
+            // Chrome trace timestamps and durations are in microseconds.
+            fprintf(file, ",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3lf,\"dur\":%.3lf}",
+                tid, double(event.begin - detail::g_time_start) * 0.001, double(event.end - event.begin) * 0.001);
+        }
+    }
+    fprintf(file, "\n],\"displayTimeUnit\":\"ms\"}\n");
+    bool ok = ferror(file) == 0;
+    ok &= fclose(file) == 0;
+    return ok;
+}
+
+} // namespace Profiler
+} // namespace Slic3r
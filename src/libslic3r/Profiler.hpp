@@ -0,0 +1,77 @@
+#ifndef slic3r_Profiler_hpp_
+#define slic3r_Profiler_hpp_
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Thread aware profiler of the slicing pipeline.
+// Contrary to the Shiny profiler (compiled in with SLIC3R_PROFILE), this profiler does not require
+// the parallelization to be disabled: Each thread records the profiled zones into its own buffer,
+// and the recorded zones are exported as a timeline of all the threads.
+// The profiler is always compiled in. While not recording, entering a profiled zone costs
+// a single relaxed atomic load.
+
+namespace Slic3r {
+namespace Profiler {
+
+namespace detail {
+    extern std::atomic<bool> g_recording;
+    // Monotonic time in nanoseconds.
+    int64_t now();
+    // Record a zone to the buffer of the calling thread.
+    void    record(const char *name, int64_t begin, int64_t end);
+} // namespace detail
+
+// Is the profiler recording?
+inline bool recording() { return detail::g_recording.load(std::memory_order_relaxed); }
+
+// Clear the recorded zones and start recording.
+// Neither start() nor stop() nor export_chrome_trace() shall be called while the profiled code is running.
+void start();
+// Stop recording. The recorded zones are retained for export.
+void stop();
+// Statistics of the recorded zones of the same name.
+struct ZoneStats
+{
+    std::string name;
+    // Number of the recorded zones.
+    size_t      count;
+    // Sum of the durations of the zones in seconds. Zones running concurrently on multiple threads are summed up.
+    double      total;
+    // Wall clock time in seconds, during which at least one of the zones was running.
+    double      wall;
+};
+// Summarize the recorded zones by their names. Sorted by the start time of the first zone of each name.
+std::vector<ZoneStats> summarize();
+
+// Export the recorded zones in the Chrome Trace Event format, to be viewed by chrome://tracing or https://ui.perfetto.dev
+// Returns false if the file could not be written.
+bool export_chrome_trace(const std::string &path);
+
+// Profiled zone, recorded from its construction till its destruction.
+// The name is stored by pointer, therefore it must be a string literal or otherwise outlive the export.
+class Zone
+{
+public:
+    explicit Zone(const char *name) : m_name(name), m_begin(recording() ? detail::now() : -1) {}
+    ~Zone() { if (m_begin != -1 && recording()) detail::record(m_name, m_begin, detail::now()); }
+
+    Zone(const Zone&) = delete;
+    Zone& operator=(const Zone&) = delete;
+
+private:
+    const char *m_name;
+    int64_t     m_begin;
+};
+
+} // namespace Profiler
+} // namespace Slic3r
+
+#define SLIC3R_PROFILE_ZONE_CAT2(a, b) a##b
+#define SLIC3R_PROFILE_ZONE_CAT(a, b) SLIC3R_PROFILE_ZONE_CAT2(a, b)
+// Profile the rest of the enclosing scope as a zone of the given name (a string literal).
+#define SLIC3R_PROFILE_ZONE(name) ::Slic3r::Profiler::Zone SLIC3R_PROFILE_ZONE_CAT(slic3r_profile_zone_, __LINE__)(name)
+
+#endif /* slic3r_Profiler_hpp_ */
@@ -13,6 +13,7 @@
 #include "libslic3r.h"
 
 #include <iostream>
+#include <numeric>
 #include <random>
 
 namespace Slic3r {
@@ -183,6 +184,25 @@ static std::vector<SLAAutoSupports::MyLayer> make_layers(
     return layers;
 }
 
+// Flag the islands of a layer closer to another island of the layer than distance (in mm), by their bounding boxes.
+static std::vector<char> islands_closer_than(const std::vector<SLAAutoSupports::Structure> &islands, float distance)
+{
+    std::vector<char> out(islands.size(), false);
+    const coord_t dist = coord_t(scale_(distance)) + SCALED_EPSILON;
+    // Sweep the bounding boxes sorted by their left side.
+    std::vector<size_t> order(islands.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&islands](size_t i, size_t j) { return islands[i].bbox.min.x() < islands[j].bbox.min.x(); });
+    for (size_t i = 0; i < order.size(); ++ i) {
+        BoundingBox bbox = islands[order[i]].bbox;
+        bbox.offset(dist);
+        for (size_t j = i + 1; j < order.size() && islands[order[j]].bbox.min.x() <= bbox.max.x(); ++ j)
+            if (bbox.overlap(islands[order[j]].bbox))
+                out[order[i]] = out[order[j]] = true;
+    }
+    return out;
+}
+
 void SLAAutoSupports::process(const std::vector<ExPolygons>& slices, const std::vector<float>& heights)
 {
 #ifdef SLA_AUTOSUPPORTS_DEBUG
@@ -193,6 +213,8 @@ void SLAAutoSupports::process(const std::vector<ExPolygons>& slices, const std::
 
     PointGrid3D point_grid;
     point_grid.cell_size = Vec3f(10.f, 10.f, 10.f);
+    // Support points of a layer closer than this may collide.
+    const float min_spacing = this->initial_poisson_radius();
 
     double increment = 100.0 / layers.size();
     double status    = 0;
@@ -230,24 +252,28 @@ void SLAAutoSupports::process(const std::vector<ExPolygons>& slices, const std::
                     above_link.island->supports_force_inherited += below_support_force * above_link.overlap_area / above_overlap_area;
             }
         }
-        // Now iterate over all polygons and append new points if needed.
-        for (Structure &s : layer_top->islands) {
+        for (Structure &s : layer_top->islands)
             // Penalization resulting from large diff from the last layer:
 //            s.supports_force_inherited /= std::max(1.f, (layer_height / 0.3f) * e_area / s.area);
             s.supports_force_inherited /= std::max(1.f, 0.17f * (s.overhangs_area) / s.area);
 
-            //float force_deficit = s.support_force_deficit(m_config.tear_pressure());
-            if (s.islands_below.empty()) { // completely new island - needs support no doubt
-                uniformly_cover({ *s.polygon }, s, point_grid, true);
-            } else if (! s.dangling_areas.empty()) {
-                // Let's see if there's anything that overlaps enough to need supports:
-                // What we now have in polygons needs support, regardless of what the forces are, so we can add them.
-                //FIXME is it an island point or not? Vojtech thinks it is.
-                uniformly_cover(s.dangling_areas, s, point_grid);
-            } else if (! s.overhangs_slopes.empty()) {
-                //FIXME add the support force deficit as a parameter, only cover until the defficiency is covered.
-                uniformly_cover(s.overhangs_slopes, s, point_grid);
-            }
+        // Now iterate over all polygons and append new points if needed.
+        // The islands are sampled in parallel, except for the islands closer to each other than the spacing
+        // of the support points, whose points are sampled one island after the other, as they collide.
+        std::vector<char>               sampled_sequentially = islands_closer_than(layer_top->islands, min_spacing);
+        std::vector<std::vector<Vec2f>> island_points(layer_top->islands.size());
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, layer_top->islands.size()),
+            [this, layer_top, &sampled_sequentially, &island_points, &point_grid](const tbb::blocked_range<size_t>& range) {
+                for (size_t island_id = range.begin(); island_id < range.end(); ++ island_id)
+                    if (! sampled_sequentially[island_id])
+                        island_points[island_id] = cover_island(layer_top->islands[island_id], point_grid);
+            });
+        for (size_t island_id = 0; island_id < layer_top->islands.size(); ++ island_id) {
+            Structure &s = layer_top->islands[island_id];
+            if (sampled_sequentially[island_id])
+                island_points[island_id] = cover_island(s, point_grid);
+            // A completely new island needs support no doubt, its points are island points.
+            add_support_points(island_points[island_id], s, point_grid, s.islands_below.empty());
         }
 
         m_throw_on_cancel();
@@ -441,20 +467,42 @@ static inline std::vector<Vec2f> poisson_disk_from_samples(const std::vector<Vec
     return out;
 }
 
-void SLAAutoSupports::uniformly_cover(const ExPolygons& islands, Structure& structure, PointGrid3D &grid3d, bool is_new_island, bool just_one)
+std::vector<Vec2f> SLAAutoSupports::cover_island(const Structure& s, const PointGrid3D &grid3d) const
+{
+    //float force_deficit = s.support_force_deficit(m_config.tear_pressure());
+    if (s.islands_below.empty()) { // completely new island - needs support no doubt
+        return uniformly_cover({ *s.polygon }, s, grid3d);
+    } else if (! s.dangling_areas.empty()) {
+        // Let's see if there's anything that overlaps enough to need supports:
+        // What we now have in polygons needs support, regardless of what the forces are, so we can add them.
+        //FIXME is it an island point or not? Vojtech thinks it is.
+        return uniformly_cover(s.dangling_areas, s, grid3d);
+    } else if (! s.overhangs_slopes.empty()) {
+        //FIXME add the support force deficit as a parameter, only cover until the defficiency is covered.
+        return uniformly_cover(s.overhangs_slopes, s, grid3d);
+    }
+    return std::vector<Vec2f>();
+}
+
+float SLAAutoSupports::initial_poisson_radius() const
+{
+    const float density_horizontal = m_config.tear_pressure() / m_config.support_force();
+    //FIXME why?
+    return std::max(m_config.minimal_distance, 1.f / (5.f * density_horizontal));
+}
+
+std::vector<Vec2f> SLAAutoSupports::uniformly_cover(const ExPolygons& islands, const Structure& structure, const PointGrid3D &grid3d) const
 {
     //int num_of_points = std::max(1, (int)((island.area()*pow(SCALING_FACTOR, 2) * m_config.tear_pressure)/m_config.support_force));
 
     const float support_force_deficit = structure.support_force_deficit(m_config.tear_pressure());
     if (support_force_deficit < 0)
-        return;
+        return std::vector<Vec2f>();
 
     // Number of newly added points.
     const size_t poisson_samples_target = size_t(ceil(support_force_deficit / m_config.support_force()));
 
-    const float density_horizontal = m_config.tear_pressure() / m_config.support_force();
-    //FIXME why?
-    float poisson_radius		= std::max(m_config.minimal_distance, 1.f / (5.f * density_horizontal));
+    float poisson_radius		= this->initial_poisson_radius();
 //    const float poisson_radius     = 1.f / (15.f * density_horizontal);
     const float samples_per_mm2 = 30.f / (float(M_PI) * poisson_radius * poisson_radius);
     // Minimum distance between samples, in 3D space.
@@ -498,7 +546,12 @@ void SLAAutoSupports::uniformly_cover(const ExPolygons& islands, Structure& stru
         std::shuffle(poisson_samples.begin(), poisson_samples.end(), rng);
         poisson_samples.erase(poisson_samples.begin() + poisson_samples_target, poisson_samples.end());
     }
-    for (const Vec2f &pt : poisson_samples) {
+    return poisson_samples;
+}
+
+void SLAAutoSupports::add_support_points(const std::vector<Vec2f>& points, Structure& structure, PointGrid3D &grid3d, bool is_new_island)
+{
+    for (const Vec2f &pt : points) {
         m_output.emplace_back(float(pt(0)), float(pt(1)), structure.height, m_config.head_diameter/2.f, is_new_island);
         structure.supports_force_this_layer += m_config.support_force();
         grid3d.insert(pt, &structure);
@@ -138,7 +138,7 @@ public:
         Vec3f   cell_size;
         Grid    grid;
 
-        Vec3i cell_id(const Vec3f &pos) {
+        Vec3i cell_id(const Vec3f &pos) const {
             return Vec3i(int(floor(pos.x() / cell_size.x())),
                          int(floor(pos.y() / cell_size.y())),
                          int(floor(pos.z() / cell_size.z())));
@@ -151,7 +151,7 @@ public:
             grid.emplace(cell_id(pt.position), pt);
         }
 
-        bool collides_with(const Vec2f &pos, Structure *island, float radius) {
+        bool collides_with(const Vec2f &pos, const Structure *island, float radius) const {
             Vec3f pos3d(pos.x(), pos.y(), float(island->layer->print_z));
             Vec3i cell = cell_id(pos3d);
             std::pair<Grid::const_iterator, Grid::const_iterator> it_pair = grid.equal_range(cell);
@@ -170,7 +170,7 @@ public:
         }
 
     private:
-        bool collides_with(const Vec3f &pos, float radius, Grid::const_iterator it_begin, Grid::const_iterator it_end) {
+        bool collides_with(const Vec3f &pos, float radius, Grid::const_iterator it_begin, Grid::const_iterator it_end) const {
             for (Grid::const_iterator it = it_begin; it != it_end; ++ it) {
 				float dist2 = (it->second.position - pos).squaredNorm();
                 if (dist2 < radius * radius)
@@ -188,7 +188,15 @@ private:
     float m_supports_force_total = 0.f;
 
     void process(const std::vector<ExPolygons>& slices, const std::vector<float>& heights);
-    void uniformly_cover(const ExPolygons& islands, Structure& structure, PointGrid3D &grid3d, bool is_new_island = false, bool just_one = false);
+    // Initial radius of the Poisson disc sampling, the maximum distance of the support points of a layer tested for collisions.
+    float initial_poisson_radius() const;
+    // Sample the support points of a structure depending on how it is supported by the structures below.
+    std::vector<Vec2f> cover_island(const Structure& structure, const PointGrid3D &grid3d) const;
+    // Sample the support points covering the islands of a structure, not colliding with the points already in grid3d.
+    // Called for multiple structures of a layer concurrently, the grid is not modified.
+    std::vector<Vec2f> uniformly_cover(const ExPolygons& islands, const Structure& structure, const PointGrid3D &grid3d) const;
+    // Add the sampled support points of a structure to the output and to grid3d.
+    void add_support_points(const std::vector<Vec2f>& points, Structure& structure, PointGrid3D &grid3d, bool is_new_island);
     void project_onto_mesh(std::vector<sla::SupportPoint>& points) const;
 
 #ifdef SLA_AUTOSUPPORTS_DEBUG
@@ -3,6 +3,7 @@
 
 #include <Eigen/Geometry>
 #include <memory>
+#include <vector>
 
 // #define SLIC3R_SLA_NEEDS_WINDTREE
 
@@ -141,6 +142,13 @@ public:
     // Casting a ray on the mesh, returns the distance where the hit occures.
     hit_result query_ray_hit(const Vec3d &s, const Vec3d &dir) const;
 
+    // Casting a batch of rays on the mesh, returns the same hits as
+    // query_ray_hit() would for each ray. Rays next to each other in the batch
+    // are traversed together, they should start close to each other and point
+    // in similar directions. The rays are cast in parallel.
+    std::vector<hit_result> query_ray_hits(const std::vector<Vec3d> &sources,
+                                           const std::vector<Vec3d> &dirs) const;
+
     class si_result {
         double m_value;
         int m_fidx;
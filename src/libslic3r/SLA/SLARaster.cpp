@@ -32,14 +32,67 @@ inline const ClipperLib::Paths& holes(const ClipperLib::Polygon& p) { return p.H
 
 namespace sla {
 
+// Rendering buffer of the agg pixel format allocating the rows on demand,
+// when they are drawn into for the first time. The rows not allocated are
+// black. Most of an SLA layer is black, so only the rows crossing the slices
+// take memory, and the black rows are not touched by the PNG compression.
+class SparseRowBuffer {
+public:
+    using row_data = agg::row_info<agg::int8u>;
+
+    SparseRowBuffer(unsigned width, unsigned height):
+        m_width(width), m_rows(height) {}
+
+    unsigned width()  const { return m_width; }
+    unsigned height() const { return unsigned(m_rows.size()); }
+    int      stride() const { return int(m_width); }
+
+    // Row to be drawn into, allocated if it is not allocated yet.
+    agg::int8u* row_ptr(int, int y, unsigned)
+    {
+        std::vector<agg::int8u> &row = m_rows[size_t(y)];
+        if(row.empty()) row.assign(m_width, 0);
+        return row.data();
+    }
+
+    // Row to be read, nullptr if the row is black.
+    agg::int8u* row_ptr(int y)
+    {
+        std::vector<agg::int8u> &row = m_rows[size_t(y)];
+        return row.empty() ? nullptr : row.data();
+    }
+
+    const agg::int8u* row_ptr(int y) const
+    {
+        const std::vector<agg::int8u> &row = m_rows[size_t(y)];
+        return row.empty() ? nullptr : row.data();
+    }
+
+    row_data row(int y) const
+    {
+        const agg::int8u *ptr = row_ptr(y);
+        return ptr == nullptr ? row_data(0, -1, nullptr) :
+                                row_data(0, int(m_width) - 1, const_cast<agg::int8u*>(ptr));
+    }
+
+    // Make all the rows black by releasing them.
+    void clear()
+    {
+        for(std::vector<agg::int8u> &row : m_rows)
+            std::vector<agg::int8u>().swap(row);
+    }
+
+private:
+    unsigned                             m_width;
+    std::vector<std::vector<agg::int8u>> m_rows;
+};
+
 class Raster::Impl {
 public:
-    using TPixelRenderer = agg::pixfmt_gray8; // agg::pixfmt_rgb24;
+    using TBuffer = SparseRowBuffer;
+    using TPixelRenderer = agg::pixfmt_alpha_blend_gray<agg::blender_gray8, TBuffer>;
     using TRawRenderer = agg::renderer_base<TPixelRenderer>;
     using TPixel = TPixelRenderer::color_type;
-    using TRawBuffer = agg::rendering_buffer;
-
-    using TBuffer = std::vector<TPixelRenderer::pixel_type>;
 
     using TRendererAA = agg::renderer_scanline_aa_solid<TRawRenderer>;
 
@@ -53,7 +106,6 @@ private:
 //    Raster::PixelDim m_pxdim;
     Raster::PixelDim m_pxdim_scaled;    // used for scaled coordinate polygons
     TBuffer m_buf;
-    TRawBuffer m_rbuf;
     TPixelRenderer m_pixfmt;
     TRawRenderer m_raw_renderer;
     TRendererAA m_renderer;
@@ -77,11 +129,8 @@ public:
         m_resolution(res), 
 //        m_pxdim(pd), 
         m_pxdim_scaled(SCALING_FACTOR / pd.w_mm, SCALING_FACTOR / pd.h_mm),
-        m_buf(res.pixels()),
-        m_rbuf(reinterpret_cast<TPixelRenderer::value_type*>(m_buf.data()),
-              res.width_px, res.height_px,
-              int(res.width_px*TPixelRenderer::num_components)),
-        m_pixfmt(m_rbuf),
+        m_buf(res.width_px, res.height_px),
+        m_pixfmt(m_buf),
         m_raw_renderer(m_pixfmt),
         m_renderer(m_raw_renderer),
         m_mirror(mirror)
@@ -131,10 +180,10 @@ public:
     }
 
     inline void clear() {
-        m_raw_renderer.clear(ColorBlack);
+        m_buf.clear();
     }
 
-    inline TBuffer& buffer()  { return m_buf; }
+    inline const TBuffer& buffer() const { return m_buf; }
     
     inline Format format() const { return m_fmt; }
 
@@ -235,40 +284,94 @@ void Raster::draw(const ClipperLib::Polygon &poly)
     m_impl->draw(poly);
 }
 
+// PNG compression of the raster, producing the same output as
+// tdefl_write_image_to_png_file_in_memory() with the default compression
+// level does for a dense frame. The black rows are not allocated, they are
+// passed to the compressor from a single row of zeros.
+static std::vector<std::uint8_t> encode_png(const SparseRowBuffer &buf)
+{
+    // Number of the match probes of the miniz PNG writer at the level 6.
+    static const int PNG_NUM_PROBES = 128;
+    // Signature, IHDR chunk and the length and type of the IDAT chunk.
+    static const size_t PNG_HEADER_SIZE = 41;
+
+    std::vector<std::uint8_t> out(PNG_HEADER_SIZE, 0);
+    std::unique_ptr<tdefl_compressor, void(*)(tdefl_compressor*)>
+        comp(tdefl_compressor_alloc(), tdefl_compressor_free);
+    if(! comp) return {};
+
+    auto putter = [](const void *data, int len, void *user) -> mz_bool {
+        auto  out = static_cast<std::vector<std::uint8_t>*>(user);
+        auto  ptr = static_cast<const std::uint8_t*>(data);
+        out->insert(out->end(), ptr, ptr + len);
+        return MZ_TRUE;
+    };
+    tdefl_init(comp.get(), putter, &out, PNG_NUM_PROBES | TDEFL_WRITE_ZLIB_HEADER);
+
+    unsigned w = buf.width(), h = buf.height();
+    const std::vector<std::uint8_t> black(w, 0);
+    const std::uint8_t filter = 0;
+    for(unsigned y = 0; y < h; ++y) {
+        const std::uint8_t *row = buf.row_ptr(int(y));
+        tdefl_compress_buffer(comp.get(), &filter, 1, TDEFL_NO_FLUSH);
+        tdefl_compress_buffer(comp.get(), row ? row : black.data(), w, TDEFL_NO_FLUSH);
+    }
+    if(tdefl_compress_buffer(comp.get(), nullptr, 0, TDEFL_FINISH) != TDEFL_STATUS_DONE)
+        return {};
+
+    size_t idat_len = out.size() - PNG_HEADER_SIZE;
+    std::uint8_t header[PNG_HEADER_SIZE] = {
+        0x89, 0x50, 0x4e, 0x47, 0x0d, 0x0a, 0x1a, 0x0a, 0x00, 0x00,
+        0x00, 0x0d, 0x49, 0x48, 0x44, 0x52, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x49, 0x44, 0x41,
+        0x54 };
+    header[18] = std::uint8_t(w >> 8);
+    header[19] = std::uint8_t(w);
+    header[22] = std::uint8_t(h >> 8);
+    header[23] = std::uint8_t(h);
+    header[33] = std::uint8_t(idat_len >> 24);
+    header[34] = std::uint8_t(idat_len >> 16);
+    header[35] = std::uint8_t(idat_len >> 8);
+    header[36] = std::uint8_t(idat_len);
+    mz_uint32 c = mz_uint32(mz_crc32(MZ_CRC32_INIT, header + 12, 17));
+    for(int i = 0; i < 4; ++i, c <<= 8) header[29 + i] = std::uint8_t(c >> 24);
+    std::copy(header, header + PNG_HEADER_SIZE, out.begin());
+
+    // IDAT CRC-32 followed by the IEND chunk.
+    c = mz_uint32(mz_crc32(MZ_CRC32_INIT, out.data() + PNG_HEADER_SIZE - 4, idat_len + 4));
+    for(int i = 0; i < 4; ++i, c <<= 8) out.emplace_back(std::uint8_t(c >> 24));
+    static const std::uint8_t iend[] = { 0x00, 0x00, 0x00, 0x00, 0x49, 0x45, 0x4e, 0x44, 0xae, 0x42, 0x60, 0x82 };
+    out.insert(out.end(), iend, iend + sizeof(iend));
+    return out;
+}
+
+// Binary PGM of the raster.
+static std::vector<std::uint8_t> encode_pgm(const SparseRowBuffer &buf)
+{
+    auto header = std::string("P5 ") +
+            std::to_string(buf.width()) + " " +
+            std::to_string(buf.height()) + " " + "255 ";
+
+    std::vector<std::uint8_t> out;
+    out.reserve(header.size() + size_t(buf.width()) * buf.height());
+    out.insert(out.end(), header.begin(), header.end());
+    for(unsigned y = 0; y < buf.height(); ++y) {
+        const std::uint8_t *row = buf.row_ptr(int(y));
+        if(row) out.insert(out.end(), row, row + buf.width());
+        else out.resize(out.size() + buf.width(), 0);
+    }
+    return out;
+}
+
 void Raster::save(std::ostream& stream, Format fmt)
 {
     assert(m_impl);
     if(!stream.good()) return;
 
-    switch(fmt) {
-    case Format::PNG: {
-        auto& b = m_impl->buffer();
-        size_t out_len = 0;
-        void * rawdata = tdefl_write_image_to_png_file_in_memory(
-                    b.data(),
-                    int(resolution().width_px),
-                    int(resolution().height_px), 1, &out_len);
-
-        if(rawdata == nullptr) break;
-
-        stream.write(static_cast<const char*>(rawdata),
-                     std::streamsize(out_len));
-
-        MZ_FREE(rawdata);
-
-        break;
-    }
-    case Format::RAW: {
-        stream << "P5 "
-               << m_impl->resolution().width_px << " "
-               << m_impl->resolution().height_px << " "
-               << "255 ";
-
-        auto sz = m_impl->buffer().size()*sizeof(Impl::TBuffer::value_type);
-        stream.write(reinterpret_cast<const char*>(m_impl->buffer().data()),
-                     std::streamsize(sz));
-    }
-    }
+    RawBytes data = save(fmt);
+    stream.write(reinterpret_cast<const char*>(data.data()),
+                 std::streamsize(data.size()));
 }
 
 void Raster::save(std::ostream &stream)
@@ -280,42 +383,12 @@ RawBytes Raster::save(Format fmt)
 {
     assert(m_impl);
 
-    std::vector<std::uint8_t> data; size_t s = 0;
-
     switch(fmt) {
-    case Format::PNG: {
-        void *rawdata = tdefl_write_image_to_png_file_in_memory(
-                    m_impl->buffer().data(),
-                    int(resolution().width_px),
-                    int(resolution().height_px), 1, &s);
-
-        if(rawdata == nullptr) break;
-        auto ptr = static_cast<std::uint8_t*>(rawdata);
-        
-        data.reserve(s); std::copy(ptr, ptr + s, std::back_inserter(data));
-        
-        MZ_FREE(rawdata);
-        break;
-    }
-    case Format::RAW: {
-        auto header = std::string("P5 ") +
-                std::to_string(m_impl->resolution().width_px) + " " +
-                std::to_string(m_impl->resolution().height_px) + " " + "255 ";
-
-        auto sz = m_impl->buffer().size()*sizeof(Impl::TBuffer::value_type);
-        s = sz + header.size();
-        
-        data.reserve(s);
-        
-        auto buff = reinterpret_cast<std::uint8_t*>(m_impl->buffer().data());
-        std::copy(header.begin(), header.end(), std::back_inserter(data));
-        std::copy(buff, buff+sz, std::back_inserter(data));
-        
-        break;
-    }
+    case Format::PNG: return {encode_png(m_impl->buffer())};
+    case Format::RAW: return {encode_pgm(m_impl->buffer())};
     }
 
-    return {std::move(data)};
+    return {};
 }
 
 RawBytes Raster::save()
@@ -1,11 +1,18 @@
 #include "SLARasterWriter.hpp"
 #include "libslic3r/Zipper.hpp"
+#include "libslic3r/Utils.hpp"
 #include "ExPolygon.hpp"
 #include <libnest2d/backends/clipper/clipper_polygon.hpp>
 
 #include <boost/log/trivial.hpp>
+#include <boost/filesystem/operations.hpp>
 #include <boost/filesystem/path.hpp>
 
+#include <memory>
+
+#include <tbb/pipeline.h>
+#include <tbb/task_scheduler_init.h>
+
 namespace Slic3r { namespace sla {
 
 std::string SLARasterWriter::createIniContent(const std::string& projectname) const 
@@ -87,35 +94,92 @@ SLARasterWriter::SLARasterWriter(const SLAPrinterConfig &cfg,
     m_gamma = cfg.gamma_correction.getFloat();
 }
 
-void SLARasterWriter::save(const std::string &fpath, const std::string &prjname)
+RawBytes SLARasterWriter::rasterize_layer(const std::vector<ClipperLib::Polygon> &polygons) const
+{
+    Raster raster;
+    raster.reset(m_res, m_pxdim, m_mirror, m_gamma);
+    for(const ClipperLib::Polygon& poly : polygons) {
+        if(m_o == roPortrait) {
+            ClipperLib::Polygon p(poly); flpXY(p);
+            raster.draw(p);
+        }
+        else raster.draw(poly);
+    }
+    return raster.save(Raster::Format::PNG);
+}
+
+void SLARasterWriter::save(const std::string &fpath, const std::string &prjname,
+                           unsigned layer_cnt, const LayerPolygons &layer_polygons,
+                           const std::function<void()> &throw_if_canceled,
+                           const std::function<void(unsigned)> &layers_written)
 {
+    std::string project = prjname.empty()?
+                boost::filesystem::path(fpath).stem().string() : prjname;
+    
+    // A canceled or failed export shall not leave a truncated archive behind.
+    std::string fpath_tmp = fpath + ".tmp";
+    
     try {
-        Zipper zipper(fpath); // zipper with no compression
-        
-        std::string project = prjname.empty()?
-                    boost::filesystem::path(fpath).stem().string() : prjname;
-        
-        zipper.add_entry("config.ini");
-        
-        zipper << createIniContent(project);
-        
-        for(unsigned i = 0; i < m_layers_rst.size(); i++)
-        {
-            if(m_layers_rst[i].rawbytes.size() > 0) {
-                char lyrnum[6];
-                std::sprintf(lyrnum, "%.5d", i);
-                auto zfilename = project + lyrnum + ".png";
-                
-                // Add binary entry to the zipper
-                zipper.add_entry(zfilename,
-                                 m_layers_rst[i].rawbytes.data(),
-                                 m_layers_rst[i].rawbytes.size());
-            }
+        { // The zipper closes the file before it is renamed.
+            Zipper zipper(fpath_tmp); // zipper with no compression
+            
+            zipper.add_entry("config.ini");
+            
+            zipper << createIniContent(project);
+            
+            // A layer passed from the rasterizing stage to the writing stage of the pipeline.
+            struct EncodedLayer {
+                unsigned                  id = 0;
+                std::shared_ptr<RawBytes> png;
+            };
+            
+            // Each layer in flight holds either its raster or its PNG data. Two layers per thread
+            // let the rasterizers run while the layers are being written.
+            const size_t max_layers_in_flight = 2 * size_t(tbb::task_scheduler_init::default_num_threads());
+            unsigned     layer_to_rasterize   = 0;
+            tbb::parallel_pipeline(max_layers_in_flight,
+                tbb::make_filter<void, unsigned>(tbb::filter::serial_in_order,
+                    [layer_cnt, &layer_to_rasterize, &throw_if_canceled](tbb::flow_control &fc) -> unsigned {
+                        if (layer_to_rasterize == layer_cnt) {
+                            fc.stop();
+                            return 0;
+                        }
+                        if (throw_if_canceled)
+                            throw_if_canceled();
+                        return layer_to_rasterize ++;
+                    }) &
+                tbb::make_filter<unsigned, EncodedLayer>(tbb::filter::parallel,
+                    [this, &layer_polygons](unsigned layer_id) -> EncodedLayer {
+                        EncodedLayer out;
+                        out.id  = layer_id;
+                        out.png = std::make_shared<RawBytes>(this->rasterize_layer(layer_polygons(layer_id)));
+                        return out;
+                    }) &
+                tbb::make_filter<EncodedLayer, void>(tbb::filter::serial_in_order,
+                    [&zipper, &project, &layers_written](EncodedLayer layer) {
+                        if(layer.png->size() > 0) {
+                            char lyrnum[6];
+                            std::sprintf(lyrnum, "%.5d", layer.id);
+                            auto zfilename = project + lyrnum + ".png";
+                            
+                            // Add binary entry to the zipper
+                            zipper.add_entry(zfilename,
+                                             layer.png->data(),
+                                             layer.png->size());
+                        }
+                        if (layers_written)
+                            layers_written(layer.id + 1);
+                    }));
+            
+            zipper.finalize();
         }
         
-        zipper.finalize();
+        if (rename_file(fpath_tmp, fpath))
+            throw std::runtime_error(std::string("Failed to rename the archive from ") + fpath_tmp + " to " + fpath);
     } catch(std::exception& e) {
         BOOST_LOG_TRIVIAL(error) << e.what();
+        boost::system::error_code ec;
+        boost::filesystem::remove(fpath_tmp, ec);
         // Rethrow the exception
         throw;
     }
@@ -3,6 +3,7 @@
 
 // For png export of the sliced model
 #include <fstream>
+#include <functional>
 #include <sstream>
 #include <vector>
 #include <array>
@@ -14,12 +15,10 @@
 namespace Slic3r { namespace sla {
 
 // Implementation for PNG raster output
-// Be aware that if a large number of layers are allocated, it can very well
-// exhaust the available memory especially on 32 bit platform.
-// This class is designed to be used in parallel mode. Layers have an ID and
-// each layer can be written and compressed independently (in parallel).
-// At the end when all layers where written, the save method can be used to 
-// write out the result into a zipped archive.
+// The layers are rasterized and compressed independently (in parallel) when
+// the zipped archive is being saved, and they are written into the archive
+// one by one as soon as they are ready. Only a bounded window of layers is
+// held in memory at once, independently of the number of layers printed.
 class SLARasterWriter
 {
 public:
@@ -41,32 +40,6 @@ public:
     
 private:
     
-    // A struct to bind the raster image data and its compressed bytes together.
-    struct Layer {
-        Raster raster;
-        RawBytes rawbytes;
-
-        Layer() = default;
-        Layer(const Layer&) = delete; // The image is big, do not copy by accident
-        Layer& operator=(const Layer&) = delete;
-        
-        // /////////////////////////////////////////////////////////////////////
-        // FIXME: the following is needed for MSVC2013 compatibility
-        // /////////////////////////////////////////////////////////////////////
-
-        // Layer(Layer&& m) = default;
-        // Layer& operator=(Layer&&) = default;
-        Layer(Layer &&m):
-            raster(std::move(m.raster)), rawbytes(std::move(m.rawbytes)) {}
-        Layer& operator=(Layer &&m) {
-            raster = std::move(m.raster); rawbytes = std::move(m.rawbytes);
-            return *this;
-        }
-    };
-
-    // We will save the compressed PNG data into RawBytes type buffers in 
-    // parallel. Later we can write every layer to the disk sequentially.
-    std::vector<Layer> m_layers_rst;
     Raster::Resolution m_res;
     Raster::PixelDim m_pxdim;
     double m_exp_time_s = .0, m_exp_time_first_s = .0;
@@ -86,6 +59,9 @@ private:
     static void flpXY(ClipperLib::Polygon& poly);
     static void flpXY(ExPolygon& poly);
 
+    // Rasterize the polygons of a single layer and compress the raster to PNG.
+    RawBytes rasterize_layer(const std::vector<ClipperLib::Polygon> &polygons) const;
+
 public:
 
     SLARasterWriter(const SLAPrinterConfig& cfg, 
@@ -102,7 +78,6 @@ public:
     // SLARasterWriter(SLARasterWriter&& m) = default;
     // SLARasterWriter& operator=(SLARasterWriter&&) = default;
     SLARasterWriter(SLARasterWriter&& m):
-        m_layers_rst(std::move(m.m_layers_rst)),
         m_res(m.m_res),
         m_pxdim(m.m_pxdim),
         m_exp_time_s(m.m_exp_time_s),
@@ -119,44 +94,18 @@ public:
 
     // /////////////////////////////////////////////////////////////////////////
 
-    inline void layers(unsigned cnt) { if(cnt > 0) m_layers_rst.resize(cnt); }
-    inline unsigned layers() const { return unsigned(m_layers_rst.size()); }
-    
-    template<class Poly> void draw_polygon(const Poly& p, unsigned lyr) {
-        assert(lyr < m_layers_rst.size());
-        if(m_o == roPortrait) {
-            Poly poly(p); flpXY(poly);
-            m_layers_rst[lyr].raster.draw(poly);
-        }
-        else m_layers_rst[lyr].raster.draw(p);
-    }
-
-    inline void begin_layer(unsigned lyr) {
-        if(m_layers_rst.size() <= lyr) m_layers_rst.resize(lyr+1);
-        m_layers_rst[lyr].raster.reset(m_res, m_pxdim, m_mirror, m_gamma);
-    }
-
-    inline void begin_layer() {
-        m_layers_rst.emplace_back();
-        m_layers_rst.front().raster.reset(m_res, m_pxdim, m_mirror, m_gamma);
-    }
-
-    inline void finish_layer(unsigned lyr_id) {
-        assert(lyr_id < m_layers_rst.size());
-        m_layers_rst[lyr_id].rawbytes =
-                m_layers_rst[lyr_id].raster.save(Raster::Format::PNG);
-        m_layers_rst[lyr_id].raster.reset();
-    }
-
-    inline void finish_layer() {
-        if(!m_layers_rst.empty()) {
-            m_layers_rst.back().rawbytes =
-                    m_layers_rst.back().raster.save(Raster::Format::PNG);
-            m_layers_rst.back().raster.reset();
-        }
-    }
-
-    void save(const std::string& fpath, const std::string& prjname = "");
+    // Polygons of a layer to be rasterized, called for multiple layers concurrently.
+    using LayerPolygons = std::function<const std::vector<ClipperLib::Polygon>&(unsigned layer_id)>;
+
+    // Rasterize layer_cnt layers and save them into a zipped archive. The layers are rasterized and compressed
+    // in parallel and written in order, at most a couple of layers per thread are held in memory at once.
+    // throw_if_canceled is called before a layer is rasterized, to stop the export by an exception.
+    // layers_written is called with the number of layers written so far, from a single thread at a time.
+    // The archive is written into a temporary file, which is renamed to fpath once complete.
+    void save(const std::string& fpath, const std::string& prjname,
+              unsigned layer_cnt, const LayerPolygons &layer_polygons,
+              const std::function<void()> &throw_if_canceled = std::function<void()>(),
+              const std::function<void(unsigned)> &layers_written = std::function<void(unsigned)>());
 
     void set_statistics(const std::vector<double> statistics);
 };
@@ -7,9 +7,85 @@
 #include "SLASupportTree.hpp"
 #include "Model.hpp"
 
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_reduce.h>
+
 namespace Slic3r {
 namespace sla {
 
+RotationScore::RotationScore(const TriangleMesh& mesh)
+{
+    const stl_file& stl = mesh.stl;
+
+    std::vector<Vec3d> normals;
+    normals.reserve(stl.stats.number_of_facets);
+    for(unsigned int i = 0; i < stl.stats.number_of_facets; ++i) {
+        const stl_facet &facet = stl.facet_start[i];
+        Vec3d p1 = facet.vertex[0].cast<double>();
+        Vec3d U = facet.vertex[1].cast<double>() - p1;
+        Vec3d V = facet.vertex[2].cast<double>() - p1;
+        Vec3d n = U.cross(V);
+        // Degenerate triangles do not contribute to the score.
+        if(n.squaredNorm() > 0.) normals.emplace_back(n.normalized());
+    }
+
+    // Merge the equal normals, meshes with flat faces share a few of them.
+    std::sort(normals.begin(), normals.end(), [](const Vec3d& a, const Vec3d& b) {
+        return a.x() < b.x() || (a.x() == b.x() && (a.y() < b.y() || (a.y() == b.y() && a.z() < b.z())));
+    });
+    size_t cnt = 0;
+    for(size_t i = 0; i < normals.size(); ) {
+        size_t j = i + 1;
+        while(j < normals.size() && normals[j] == normals[i]) ++j;
+        normals[cnt++] = double(j - i) * normals[i];
+        i = j;
+    }
+
+    m_normals.resize(3, Eigen::Index(cnt));
+    for(size_t i = 0; i < cnt; ++i) m_normals.col(Eigen::Index(i)) = normals[i];
+}
+
+double RotationScore::operator()(double rx, double ry, double rz) const
+{
+    Eigen::Matrix3d rotation = (Eigen::AngleAxisd(rz, Vec3d::UnitZ()) *
+                                Eigen::AngleAxisd(ry, Vec3d::UnitY()) *
+                                Eigen::AngleAxisd(rx, Vec3d::UnitX())).toRotationMatrix();
+    return (*this)(rotation);
+}
+
+double RotationScore::operator()(const Eigen::Matrix3d& rotation) const
+{
+    // Number of the normals rotated at once, and the number of normals worth
+    // to be split between threads.
+    static const Eigen::Index BLOCK_SIZE = 4096;
+    static const Eigen::Index PARALLEL_MIN = 8 * BLOCK_SIZE;
+
+    // For all triangles we sum up the dot product (a scalar indicating how
+    // much are two vectors aligned) of the rotated normal with each axis.
+    // This will result in a value that is greater if a normal is aligned
+    // with all axes. If the normal is aligned than the triangle itself is
+    // orthogonal to the axes and that is good for print quality.
+    auto score = [this, &rotation](Eigen::Index begin, Eigen::Index end) {
+        double out = 0.;
+        for(Eigen::Index i = begin; i < end; i += BLOCK_SIZE) {
+            Eigen::Index n = std::min(BLOCK_SIZE, end - i);
+            out += (rotation * m_normals.middleCols(i, n)).cwiseAbs().sum();
+        }
+        return out;
+    };
+
+    Eigen::Index cnt = m_normals.cols();
+    if(cnt < PARALLEL_MIN) return score(0, cnt);
+
+    // The deterministic reduction yields the same score for the same rotation.
+    return tbb::parallel_deterministic_reduce(
+        tbb::blocked_range<Eigen::Index>(0, cnt, BLOCK_SIZE), 0.,
+        [&score](const tbb::blocked_range<Eigen::Index>& range, double out) {
+            return out + score(range.begin(), range.end());
+        },
+        std::plus<double>());
+}
+
 std::array<double, 3> find_best_rotation(const ModelObject& modelobj,
                                          float accuracy,
                                          std::function<void(unsigned)> statuscb,
@@ -26,9 +102,9 @@ std::array<double, 3> find_best_rotation(const ModelObject& modelobj,
     // return value
     std::array<double, 3> rot;
 
-    // We will use only one instance of this converted mesh to examine different
+    // The normals of the mesh are calculated once to examine different
     // rotations
-    EigenMesh3D emesh(modelobj.raw_mesh());
+    RotationScore rotation_score(modelobj.raw_mesh());
 
     // For current iteration number
     unsigned status = 0;
@@ -44,51 +120,14 @@ std::array<double, 3> find_best_rotation(const ModelObject& modelobj,
     // call the status callback in each iteration but the actual value may be
     // the same for subsequent iterations (status goes from 0 to 100 but
     // iterations can be many more)
-    auto objfunc = [&emesh, &status, &statuscb, &stopcond, max_tries]
+    auto objfunc = [&rotation_score, &status, &statuscb, &stopcond, max_tries]
             (double rx, double ry, double rz)
     {
-        EigenMesh3D& m = emesh;
-
-        // prepare the rotation transformation
-        Transform3d rt = Transform3d::Identity();
-
-        rt.rotate(Eigen::AngleAxisd(rz, Vec3d::UnitZ()));
-        rt.rotate(Eigen::AngleAxisd(ry, Vec3d::UnitY()));
-        rt.rotate(Eigen::AngleAxisd(rx, Vec3d::UnitX()));
-
-        double score = 0;
-
-        // For all triangles we calculate the normal and sum up the dot product
-        // (a scalar indicating how much are two vectors aligned) with each axis
-        // this will result in a value that is greater if a normal is aligned
-        // with all axes. If the normal is aligned than the triangle itself is
-        // orthogonal to the axes and that is good for print quality.
-
         // TODO: some applications optimize for minimum z-axis cross section
         // area. The current function is only an example of how to optimize.
 
         // Later we can add more criteria like the number of overhangs, etc...
-        for(int i = 0; i < m.F().rows(); i++) {
-            auto idx = m.F().row(i);
-
-            Vec3d p1 = m.V().row(idx(0));
-            Vec3d p2 = m.V().row(idx(1));
-            Vec3d p3 = m.V().row(idx(2));
-
-            Eigen::Vector3d U = p2 - p1;
-            Eigen::Vector3d V = p3 - p1;
-
-            // So this is the normal
-            auto n = U.cross(V).normalized();
-
-            // rotate the normal with the current rotation given by the solver
-            n = rt * n;
-
-            // We should score against the alignment with the reference planes
-            score += std::abs(n.dot(Vec3d::UnitX()));
-            score += std::abs(n.dot(Vec3d::UnitY()));
-            score += std::abs(n.dot(Vec3d::UnitZ()));
-        }
+        double score = rotation_score(rx, ry, rz);
 
         // report status
         if(!stopcond()) statuscb( unsigned(++status * 100.0/max_tries) );
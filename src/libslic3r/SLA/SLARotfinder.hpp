@@ -4,12 +4,40 @@
 #include <functional>
 #include <array>
 
+#include <libslic3r/Point.hpp>
+
 namespace Slic3r {
 
 class ModelObject;
+class TriangleMesh;
 
 namespace sla {
 
+/**
+  * The score of a rotation of a mesh maximized by find_best_rotation(): the
+  * sum of the alignments of the rotated triangle normals with the axes.
+  *
+  * The unit normals are calculated once, and the normals equal to each other
+  * are merged, so that a score is calculated as a product of the rotation
+  * matrix with the normals, in parallel for large meshes.
+  */
+class RotationScore {
+public:
+    explicit RotationScore(const TriangleMesh& mesh);
+
+    /// Score of the mesh rotated around the z, y and x axes in this order.
+    double operator()(double rx, double ry, double rz) const;
+    double operator()(const Eigen::Matrix3d& rotation) const;
+
+    /// Number of the distinct normals.
+    size_t normals_count() const { return size_t(m_normals.cols()); }
+
+private:
+    // Distinct unit normals, each multiplied by the number of triangles
+    // sharing it.
+    Eigen::Matrix3Xd m_normals;
+};
+
 /**
   * The function should find the best rotation for SLA upside down printing.
   *
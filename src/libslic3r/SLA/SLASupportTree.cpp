@@ -1193,11 +1193,11 @@ class SLASupportTree::Algorithm {
 
         // Now a and b vectors are perpendicular to v and to each other.
         // Together they define the plane where we have to iterate with the
-        // given angles in the 'phis' vector
-        ccr_par::enumerate(phis.begin(), phis.end(),
-                           [&hits, &m, sd, r_pin, r_back, s, a, b, c]
-                           (double phi, size_t i)
-        {
+        // given angles in the 'phis' vector. The rays are cast together.
+        std::array<Vec3d, SAMPLES> pss;
+        std::vector<Vec3d> sources(SAMPLES), dirs(SAMPLES);
+        for(size_t i = 0; i < phis.size(); ++i) {
+            double phi = phis[i];
             double sinphi = std::sin(phi);
             double cosphi = std::cos(phi);
 
@@ -1223,7 +1223,19 @@ class SLASupportTree::Algorithm {
                     c(Z) + rpbcos * a(Z) + rpbsin * b(Z));
 
             Vec3d n = (p - ps).normalized();
-            auto q = m.query_ray_hit(ps + sd*n, n);
+            pss[i] = ps;
+            sources[i] = ps + sd*n;
+            dirs[i] = n;
+        }
+
+        std::vector<HitResult> qs = m.query_ray_hits(sources, dirs);
+
+        // The rays to re-cast from the outside of the object.
+        std::vector<size_t> recast;
+        std::vector<Vec3d> recast_sources, recast_dirs;
+        for(size_t i = 0; i < qs.size(); ++i) {
+            HitResult& q = qs[i];
+            const Vec3d& n = dirs[i];
 
             if(q.is_inside()) { // the hit is inside the model
                 if(q.distance() > r_pin + sd)  {
@@ -1240,11 +1252,18 @@ class SLASupportTree::Algorithm {
                     // re-cast the ray from the outside of the object.
                     // The starting point has an offset of 2*safety_distance
                     // because the original ray has also had an offset
-                    auto q2 = m.query_ray_hit(ps + (q.distance() + 2*sd)*n, n);
-                    hits[i] = q2;
+                    recast.emplace_back(i);
+                    recast_sources.emplace_back(pss[i] + (q.distance() + 2*sd)*n);
+                    recast_dirs.emplace_back(n);
                 }
             } else hits[i] = q;
-        });
+        }
+
+        if(!recast.empty()) {
+            std::vector<HitResult> qs2 =
+                    m.query_ray_hits(recast_sources, recast_dirs);
+            for(size_t i = 0; i < recast.size(); ++i) hits[recast[i]] = qs2[i];
+        }
 
         auto mit = std::min_element(hits.begin(), hits.end());
 
@@ -1297,10 +1316,11 @@ class SLASupportTree::Algorithm {
         // Hit results
         std::array<HitResult, SAMPLES> hits;
 
-        ccr_par::enumerate(phis.begin(), phis.end(),
-                           [&m, a, b, sd, dir, r, s, ins_check, &hits]
-                           (double phi, size_t i)
-        {
+        // The rays are cast together.
+        std::array<Vec3d, SAMPLES> ps;
+        std::vector<Vec3d> sources(SAMPLES), dirs(SAMPLES, dir);
+        for(size_t i = 0; i < phis.size(); ++i) {
+            double phi = phis[i];
             double sinphi = std::sin(phi);
             double cosphi = std::cos(phi);
 
@@ -1313,19 +1333,33 @@ class SLASupportTree::Algorithm {
                      s(Y) + rcos * a(Y) + rsin * b(Y),
                      s(Z) + rcos * a(Z) + rsin * b(Z));
 
-            auto hr = m.query_ray_hit(p + sd*dir, dir);
+            ps[i] = p;
+            sources[i] = p + sd*dir;
+        }
+
+        std::vector<HitResult> hrs = m.query_ray_hits(sources, dirs);
+
+        // The rays to re-cast from the outside of the object.
+        std::vector<size_t> recast;
+        std::vector<Vec3d> recast_sources;
+        for(size_t i = 0; i < hrs.size(); ++i) {
+            HitResult& hr = hrs[i];
 
             if(ins_check && hr.is_inside()) {
                 if(hr.distance() > 2 * r + sd) hits[i] = HitResult(0.0);
                 else {
                     // re-cast the ray from the outside of the object
-                    auto hr2 =
-                           m.query_ray_hit(p + (hr.distance() + 2*sd)*dir, dir);
-
-                    hits[i] = hr2;
+                    recast.emplace_back(i);
+                    recast_sources.emplace_back(ps[i] + (hr.distance() + 2*sd)*dir);
                 }
             } else hits[i] = hr;
-        });
+        }
+
+        if(!recast.empty()) {
+            std::vector<HitResult> hrs2 = m.query_ray_hits(
+                        recast_sources, std::vector<Vec3d>(recast.size(), dir));
+            for(size_t i = 0; i < recast.size(); ++i) hits[recast[i]] = hrs2[i];
+        }
 
         auto mit = std::min_element(hits.begin(), hits.end());
 
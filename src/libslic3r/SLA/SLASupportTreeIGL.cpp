@@ -18,6 +18,11 @@
 #pragma warning(disable: 4267)
 #endif
 #include <igl/ray_mesh_intersect.h>
+// The triangle test of igl::ray_mesh_intersect()
+extern "C"
+{
+#include <igl/raytri.c>
+}
 #include <igl/point_mesh_squared_distance.h>
 #include <igl/remove_duplicate_vertices.h>
 #include <igl/signed_distance.h>
@@ -26,6 +31,7 @@
 #endif
 
 #include <tbb/parallel_for.h>
+#include <tbb/task_scheduler_init.h>
 
 #include "SLASpatIndex.hpp"
 #include "ClipperUtils.hpp"
@@ -247,6 +253,152 @@ EigenMesh3D::query_ray_hit(const Vec3d &s, const Vec3d &dir) const
     return ret;
 }
 
+namespace {
+
+// Number of the rays traversing the AABB tree together.
+const size_t RAY_PACKET_SIZE = 8;
+
+// A ray of a packet and its closest hit found so far.
+struct PacketRay {
+    double source[3];
+    double dir[3];
+    // Precomputed for the box tests.
+    double inv_dir[3];
+    bool   sign[3];
+    double min_t;
+    igl::Hit hit;
+};
+
+// The box test of igl::ray_box_intersect() with the inverse direction of the
+// ray precomputed. The results are the same as of igl::ray_box_intersect().
+inline bool intersect_box(const PacketRay &ray,
+                          const Eigen::AlignedBox<double, 3> &box)
+{
+    const Eigen::Vector3d *bounds[2] = { &box.min(), &box.max() };
+
+    double tmin  = ((*bounds[ray.sign[X]])(X)     - ray.source[X]) * ray.inv_dir[X];
+    double tmax  = ((*bounds[1 - ray.sign[X]])(X) - ray.source[X]) * ray.inv_dir[X];
+    double tymin = ((*bounds[ray.sign[Y]])(Y)     - ray.source[Y]) * ray.inv_dir[Y];
+    double tymax = ((*bounds[1 - ray.sign[Y]])(Y) - ray.source[Y]) * ray.inv_dir[Y];
+    if(tmin > tymax || tymin > tmax) return false;
+    if(tymin > tmin) tmin = tymin;
+    if(tymax < tmax) tmax = tymax;
+
+    double tzmin = ((*bounds[ray.sign[Z]])(Z)     - ray.source[Z]) * ray.inv_dir[Z];
+    double tzmax = ((*bounds[1 - ray.sign[Z]])(Z) - ray.source[Z]) * ray.inv_dir[Z];
+    if(tmin > tzmax || tzmin > tmax) return false;
+    if(tzmin > tmin) tmin = tzmin;
+    if(tzmax < tmax) tmax = tzmax;
+
+    return tmin < ray.min_t && tmax > 0.;
+}
+
+// Traverses the tree with a packet of rays the same way as
+// igl::AABB::intersect_ray() does with each of them: depth first, the left
+// child before the right one, skipping the boxes farther than the closest hit
+// of the ray found so far. Each node is visited once for all the rays of the
+// packet still hitting its box. ids: the rays hitting the box of the parent.
+void intersect_ray_packet(const igl::AABB<Eigen::MatrixXd, 3> &node,
+                          const Eigen::MatrixXd &V,
+                          const Eigen::MatrixXi &F,
+                          PacketRay *packet,
+                          const unsigned char *ids,
+                          size_t ids_cnt)
+{
+    unsigned char active[RAY_PACKET_SIZE];
+    size_t active_cnt = 0;
+    for(size_t i = 0; i < ids_cnt; ++i)
+        if(intersect_box(packet[ids[i]], node.m_box))
+            active[active_cnt++] = ids[i];
+
+    if(active_cnt == 0) return;
+
+    if(node.is_leaf()) {
+        // The triangle test of igl::ray_mesh_intersect() without collecting
+        // and sorting the hits of the single triangle in a vector.
+        auto face = F.row(node.m_primitive);
+        Eigen::RowVector3d v0 = V.row(face(0)), v1 = V.row(face(1)), v2 = V.row(face(2));
+        for(size_t i = 0; i < active_cnt; ++i) {
+            PacketRay &ray = packet[active[i]];
+            double t, u, v;
+            if(intersect_triangle1(ray.source, ray.dir, v0.data(), v1.data(),
+                                   v2.data(), &t, &u, &v) &&
+               t > 0 && float(t) < ray.hit.t) {
+                ray.hit = { node.m_primitive, -1, float(u), float(v), float(t) };
+                ray.min_t = ray.hit.t;
+            }
+        }
+        return;
+    }
+
+    intersect_ray_packet(*node.m_left, V, F, packet, active, active_cnt);
+    intersect_ray_packet(*node.m_right, V, F, packet, active, active_cnt);
+}
+
+}
+
+std::vector<EigenMesh3D::hit_result>
+EigenMesh3D::query_ray_hits(const std::vector<Vec3d> &sources,
+                            const std::vector<Vec3d> &dirs) const
+{
+    assert(sources.size() == dirs.size());
+
+    std::vector<hit_result> ret(sources.size(), hit_result(*this));
+
+    // A batch of a few rays (a single fan of the support tree) is split into
+    // smaller packets, so that all the threads are kept busy. The hits do not
+    // depend on how the rays are grouped into packets.
+    static const size_t threads_cnt =
+        size_t(std::max(1, tbb::task_scheduler_init::default_num_threads()));
+    size_t packet_size = std::max(size_t(1), std::min(RAY_PACKET_SIZE,
+                             (sources.size() + threads_cnt - 1) / threads_cnt));
+    size_t packets_cnt = (sources.size() + packet_size - 1) / packet_size;
+
+    auto cast_packets = [this, &sources, &dirs, &ret, packet_size](size_t from, size_t to) {
+        for(size_t p = from; p < to; ++p) {
+            size_t first = p * packet_size;
+            size_t cnt   = std::min(packet_size, sources.size() - first);
+
+            PacketRay packet[RAY_PACKET_SIZE];
+            unsigned char ids[RAY_PACKET_SIZE];
+            for(size_t i = 0; i < cnt; ++i) {
+                PacketRay &ray = packet[i];
+                for(int c = 0; c < 3; ++c) {
+                    ray.source[c]  = sources[first + i](c);
+                    ray.dir[c]     = dirs[first + i](c);
+                    ray.inv_dir[c] = 1. / ray.dir[c];
+                    ray.sign[c]    = ray.inv_dir[c] < 0;
+                }
+                ray.min_t = std::numeric_limits<double>::infinity();
+                ray.hit.t = std::numeric_limits<float>::infinity();
+                ids[i] = (unsigned char)i;
+            }
+
+            intersect_ray_packet(*m_aabb, m_V, m_F, packet, ids, cnt);
+
+            for(size_t i = 0; i < cnt; ++i) {
+                const igl::Hit &hit = packet[i].hit;
+                hit_result &r = ret[first + i];
+                r.m_t = double(hit.t);
+                r.m_dir = dirs[first + i];
+                r.m_source = sources[first + i];
+                if(!std::isinf(hit.t) && !std::isnan(hit.t)) r.m_face_id = hit.id;
+            }
+        }
+    };
+
+    // A single packet is not worth a task.
+    if(packets_cnt > 1)
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, packets_cnt),
+                          [&cast_packets](const tbb::blocked_range<size_t> &range) {
+            cast_packets(range.begin(), range.end());
+        });
+    else
+        cast_packets(0, packets_cnt);
+
+    return ret;
+}
+
 #ifdef SLIC3R_SLA_NEEDS_WINDTREE
 EigenMesh3D::si_result EigenMesh3D::signed_distance(const Vec3d &p) const {
     double sign = 0; double sqdst = 0; int i = 0;  Vec3d c;
@@ -5,6 +5,7 @@
 #include "ClipperUtils.hpp"
 #include "Geometry.hpp"
 #include "MTUtils.hpp"
+#include "Profiler.hpp"
 
 #include <unordered_set>
 #include <numeric>
@@ -74,8 +75,7 @@ std::string OBJ_STEP_LABELS(size_t idx)
 // Should also add up to 100 (%)
 const std::array<unsigned, slapsCount> PRINT_STEP_LEVELS =
 {
-    10,      // slapsMergeSlicesAndEval
-    90,      // slapsRasterize
+    100,     // slapsMergeSlicesAndEval
 };
 
 // Print step to status label. The labels are localized at the time of calling, thus supporting language switching.
@@ -83,7 +83,6 @@ std::string PRINT_STEP_LABELS(size_t idx)
 {
     switch (idx) {
     case slapsMergeSlicesAndEval:   return L("Merging slices and calculating statistics");
-    case slapsRasterize:            return L("Rasterizing layers");
     default:;
     }
     assert(false); return "Out of bounds!";
@@ -191,7 +190,7 @@ SLAPrint::ApplyStatus SLAPrint::apply(const Model &model, DynamicPrintConfig con
     // Apply variables to placeholder parser. The placeholder parser is currently used
     // only to generate the output file name.
     if (! placeholder_parser_diff.empty()) {
-        // update_apply_status(this->invalidate_step(slapsRasterize));
+        // update_apply_status(this->invalidate_step(slapsMergeSlicesAndEval));
         m_placeholder_parser.apply_config(config);
         // Set the profile aliases for the PrintBase::output_filename()
         m_placeholder_parser.set("print_preset",    config.option("sla_print_settings_id")->clone());
@@ -565,6 +564,26 @@ void SLAPrint::finalize()
         m_stepmask[istep] = true;
 }
 
+void SLAPrint::export_raster(const std::string &fpath, const std::string &projectname)
+{
+    if (! m_printer)
+        return;
+    Profiler::Zone zone("SLAPrint::export_raster");
+    // The slicing is done already, the export is reported from 0 to 100 percent of the layers written.
+    auto   layer_cnt = unsigned(m_printer_input.size());
+    int    pst       = -1;
+    m_printer->save(fpath, projectname, layer_cnt,
+        [this](unsigned layer_id) -> const std::vector<ClipperLib::Polygon>& { return m_printer_input[layer_id].transformed_slices(); },
+        [this]() { this->throw_if_canceled(); },
+        [this, layer_cnt, &pst](unsigned layers_written) {
+            int st = int(100. * layers_written / std::max(layer_cnt, 1u));
+            if (st > pst) {
+                m_report_status(*this, st, L("Exporting layers"));
+                pst = st;
+            }
+        });
+}
+
 // Generate a recommended output file name based on the format template, default extension, and template parameters
 // (timestamps, object placeholders derived from the model, current placeholder prameters and print statistics.
 // Use the final print statistics if available, or just keep the print statistics placeholders if not available yet (before the output is finalized).
@@ -1388,80 +1407,13 @@ void SLAPrint::process()
         m_print_statistics.fast_layers_count = fast_layers;
         m_print_statistics.slow_layers_count = slow_layers;
 
-        m_report_status(*this, -2, "", SlicingStatus::RELOAD_SLA_PREVIEW);
-    };
-
-    // Rasterizing the model objects, and their supports
-    auto rasterize = [this]() {
-        if(canceled()) return;
-
-        { // create a raster printer for the current print parameters
-            double layerh = m_default_object_config.layer_height.getFloat();
-            m_printer.reset(new sla::SLARasterWriter(m_printer_config,
-                                                     m_material_config,
-                                                     layerh));
-        }
-
-        // Allocate space for all the layers
-        sla::SLARasterWriter &printer = *m_printer;
-
-        auto lvlcnt = unsigned(m_printer_input.size());
-        printer.layers(lvlcnt);
-
-        // coefficient to map the rasterization state (0-99) to the allocated
-        // portion (slot) of the process state
-        double sd = (100 - max_objstatus) / 100.0;
-
-        // slot is the portion of 100% that is realted to rasterization
-        unsigned slot = PRINT_STEP_LEVELS[slapsRasterize];
-
-        // pst: previous state
-        double pst = m_report_status.status();
-
-        double increment = (slot * sd) / m_printer_input.size();
-        double dstatus = m_report_status.status();
-
-        SpinMutex slck;
-
-        // procedure to process one height level. This will run in parallel
-        auto lvlfn =
-        [this, &slck, &printer, increment, &dstatus, &pst]
-            (unsigned level_id)
-        {
-            if(canceled()) return;
-
-            PrintLayer& printlayer = m_printer_input[level_id];
-
-            // Switch to the appropriate layer in the printer
-            printer.begin_layer(level_id);
-
-            for(const ClipperLib::Polygon& poly : printlayer.transformed_slices())
-                printer.draw_polygon(poly, level_id);
-
-            // Finish the layer for later saving it.
-            printer.finish_layer(level_id);
-
-            // Status indication guarded with the spinlock
-            {
-                std::lock_guard<SpinMutex> lck(slck);
-                dstatus += increment;
-                double st = std::round(dstatus);
-                if(st > pst) {
-                    m_report_status(*this, st,
-                                    PRINT_STEP_LABELS(slapsRasterize));
-                    pst = st;
-                }
-            }
-        };
-
-        // last minute escape
-        if(canceled()) return;
-
-        // Sequential version (for testing)
-        // for(unsigned l = 0; l < lvlcnt; ++l) lvlfn(l);
-
-        // Print all the layers in parallel
-        tbb::parallel_for<unsigned, decltype(lvlfn)>(0, lvlcnt, lvlfn);
+        // Create a raster printer for the current print parameters. The layers
+        // are rasterized by export_raster() while being written into the
+        // archive, they are not held in memory here.
+        double layerh = m_default_object_config.layer_height.getFloat();
+        m_printer.reset(new sla::SLARasterWriter(m_printer_config,
+                                                 m_material_config,
+                                                 layerh));
 
         // Set statistics values to the printer
         m_printer->set_statistics(
@@ -1470,6 +1422,8 @@ void SLAPrint::process()
              double(m_default_object_config.faded_layers.getInt()),
              double(m_print_statistics.slow_layers_count),
              double(m_print_statistics.fast_layers_count)});
+
+        m_report_status(*this, -2, "", SlicingStatus::RELOAD_SLA_PREVIEW);
     };
 
     using slaposFn = std::function<void(SLAPrintObject&)>;
@@ -1490,8 +1444,12 @@ void SLAPrint::process()
         slaposSliceSupports
     };
 
-    slapsFn print_program[] = { merge_slices_and_eval_stats, rasterize };
-    SLAPrintStep print_steps[] = { slapsMergeSlicesAndEval, slapsRasterize };
+    slapsFn print_program[] = { merge_slices_and_eval_stats };
+    SLAPrintStep print_steps[] = { slapsMergeSlicesAndEval };
+
+    // Names of the profiled zones of the steps above.
+    static const char *pobj_zone_names[]  = { "SLAPrintObject::slice_model", "SLAPrintObject::support_points", "SLAPrintObject::support_tree", "SLAPrintObject::base_pool", "SLAPrintObject::slice_supports" };
+    static const char *print_zone_names[] = { "SLAPrint::merge_slices_and_eval_stats" };
 
     double st = min_objstatus;
 
@@ -1526,7 +1484,10 @@ void SLAPrint::process()
                 if (po->m_stepmask[step] && po->set_started(step)) {
                     m_report_status(*this, st, OBJ_STEP_LABELS(step));
                     bench.start();
-                    pobj_program[step](*po);
+                    {
+                        Profiler::Zone zone(pobj_zone_names[step]);
+                        pobj_program[step](*po);
+                    }
                     bench.stop();
                     step_times[step] += bench.getElapsedSec();
                     throw_if_canceled();
@@ -1552,7 +1513,10 @@ void SLAPrint::process()
         if (m_stepmask[currentstep] && set_started(currentstep)) {
             m_report_status(*this, st, PRINT_STEP_LABELS(currentstep));
             bench.start();
-            print_program[currentstep]();
+            {
+                Profiler::Zone zone(print_zone_names[currentstep]);
+                print_program[currentstep]();
+            }
             bench.stop();
             step_times[slaposCount + currentstep] += bench.getElapsedSec();
             throw_if_canceled();
@@ -13,7 +13,6 @@ namespace Slic3r {
 
 enum SLAPrintStep : unsigned int {
     slapsMergeSlicesAndEval,
-    slapsRasterize,
 	slapsCount
 };
 
@@ -205,8 +204,8 @@ public:
     //
     // These methods should be callable on the client side (e.g. UI thread)
     // when the appropriate steps slaposObjectSlice and slaposSliceSupports
-    // are ready. All the print objects are processed before slapsRasterize so
-    // it is safe to call them during and/or after slapsRasterize.
+    // are ready. All the print objects are processed before slapsMergeSlicesAndEval
+    // so it is safe to call them during and/or after slapsMergeSlicesAndEval.
     //
     // /////////////////////////////////////////////////////////////////////////
 
@@ -356,13 +355,12 @@ public:
     // Returns true if an object step is done on all objects and there's at least one object.
     bool                is_step_done(SLAPrintObjectStep step) const;
     // Returns true if the last step was finished with success.
-    bool                finished() const override { return this->is_step_done(slaposSliceSupports) && this->Inherited::is_step_done(slapsRasterize); }
+    bool                finished() const override { return this->is_step_done(slaposSliceSupports) && this->Inherited::is_step_done(slapsMergeSlicesAndEval); }
 
-    inline void export_raster(const std::string& fpath,
-                              const std::string& projectname = "")
-    {
-        if(m_printer) m_printer->save(fpath, projectname);
-    }
+    // Rasterize the layers and save them into a zipped archive. The layers are rasterized
+    // while being written, so that only a few of them are held in memory at once.
+    void export_raster(const std::string& fpath,
+                       const std::string& projectname = "");
 
     const PrintObjects& objects() const { return m_objects; }
 
@@ -0,0 +1,269 @@
+#include "ShortestPath.hpp"
+#include "BoundingBox.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+namespace Slic3r {
+
+// Nearest neighbor search over the end points of the items to be chained.
+// The end points are binned into a regular grid. The chained items are only marked as removed and skipped by the search,
+// the grid is rebuilt from the remaining end points once most of them were removed.
+class ChainSearch
+{
+public:
+    // keys_per_item: Number of end points (keys) of an item. The item of key k is k / keys_per_item.
+    ChainSearch(const Points &points, size_t keys_per_item, ChainTieBreak tie_break) :
+        m_points(points), m_keys_per_item(keys_per_item), m_tie_break(tie_break),
+        m_removed(points.size() / keys_per_item, false), m_item_keys(points.size() / keys_per_item, 0) {}
+
+    // Register an end point as a candidate of the search.
+    void add_key(size_t key) { m_keys.emplace_back(key); ++ m_item_keys[key / m_keys_per_item]; ++ m_num_live; }
+    // Call after all the keys were added.
+    void init() { this->rebuild(); }
+
+    // Remove the item with all its keys from the search.
+    void remove_item(size_t item) {
+        assert(! m_removed[item]);
+        m_removed[item] = true;
+        m_num_live -= m_item_keys[item];
+    }
+
+    // Returns the key nearest to pt, which was not removed yet.
+    size_t nearest(const Point &pt)
+    {
+        assert(m_num_live > 0);
+        if (m_num_live * 4 < m_keys.size())
+            this->rebuild();
+        size_t best_key  = std::numeric_limits<size_t>::max();
+        double best_dist = std::numeric_limits<double>::max();
+        if (m_cell_size == 0) {
+            // Few items remaining, linear search.
+            for (size_t key : m_keys)
+                this->test(pt, key, best_key, best_dist);
+        } else {
+            // Visit the rings of cells around the cell of pt. The cells of the ring r are at least (r - 1) cell sizes from pt.
+            // If pt is outside of the grid, the distance from pt is even larger than the distance from the cell of pt.
+            int64_t cx = std::min<int64_t>(std::max<int64_t>((int64_t(pt.x()) - m_origin.x()) / m_cell_size, 0), m_cols - 1);
+            int64_t cy = std::min<int64_t>(std::max<int64_t>((int64_t(pt.y()) - m_origin.y()) / m_cell_size, 0), m_rows - 1);
+            int64_t rmax = std::max(std::max(cx, m_cols - 1 - cx), std::max(cy, m_rows - 1 - cy));
+            for (int64_t r = 0; r <= rmax; ++ r) {
+                if (r > 1 && best_key != std::numeric_limits<size_t>::max()) {
+                    double lower_bound = double(r - 1) * double(m_cell_size);
+                    // Conservative test, the candidates in the same distance as the best one need to be visited to break the ties.
+                    if (lower_bound * lower_bound > best_dist * (1. + 1e-12) + 1.)
+                        break;
+                }
+                if (r == 0) {
+                    this->test_cell(pt, cx, cy, best_key, best_dist);
+                    continue;
+                }
+                for (int64_t x = std::max<int64_t>(cx - r, 0); x <= std::min<int64_t>(cx + r, m_cols - 1); ++ x) {
+                    if (cy - r >= 0)
+                        this->test_cell(pt, x, cy - r, best_key, best_dist);
+                    if (cy + r < m_rows)
+                        this->test_cell(pt, x, cy + r, best_key, best_dist);
+                }
+                for (int64_t y = std::max<int64_t>(cy - r + 1, 0); y <= std::min<int64_t>(cy + r - 1, m_rows - 1); ++ y) {
+                    if (cx - r >= 0)
+                        this->test_cell(pt, cx - r, y, best_key, best_dist);
+                    if (cx + r < m_cols)
+                        this->test_cell(pt, cx + r, y, best_key, best_dist);
+                }
+            }
+        }
+        assert(best_key != std::numeric_limits<size_t>::max());
+        return best_key;
+    }
+
+private:
+    void rebuild()
+    {
+        // Compact the keys, drop the keys of the removed items.
+        m_keys.erase(std::remove_if(m_keys.begin(), m_keys.end(), [this](size_t key){ return m_removed[key / m_keys_per_item]; }), m_keys.end());
+        assert(m_keys.size() == m_num_live);
+        m_cell_size = 0;
+        m_cell_keys.clear();
+        m_cell_start.clear();
+        if (m_keys.size() <= 32)
+            // Linear search will be faster.
+            return;
+
+        BoundingBox bbox;
+        for (size_t key : m_keys)
+            bbox.merge(m_points[key]);
+        double  width  = double(bbox.max.x()) - double(bbox.min.x()) + 1.;
+        double  height = double(bbox.max.y()) - double(bbox.min.y()) + 1.;
+        // Roughly two end points per cell, limit the number of cells if the end points are distributed along a line.
+        int64_t cell_size = std::max<int64_t>(1, int64_t(std::sqrt(width * height * 2. / double(m_keys.size()))));
+        while ((int64_t(width) / cell_size + 1) * (int64_t(height) / cell_size + 1) > 4 * int64_t(m_keys.size()))
+            cell_size *= 2;
+        m_cell_size = cell_size;
+        m_origin    = bbox.min;
+        m_cols      = int64_t(width) / cell_size + 1;
+        m_rows      = int64_t(height) / cell_size + 1;
+
+        // Counting sort of the keys by their cells.
+        std::vector<size_t> key_cells(m_keys.size());
+        m_cell_start.assign(size_t(m_cols * m_rows + 1), 0);
+        for (size_t i = 0; i < m_keys.size(); ++ i) {
+            const Point &pt = m_points[m_keys[i]];
+            key_cells[i] = size_t(((int64_t(pt.y()) - m_origin.y()) / m_cell_size) * m_cols + (int64_t(pt.x()) - m_origin.x()) / m_cell_size);
+            ++ m_cell_start[key_cells[i] + 1];
+        }
+        for (size_t i = 1; i < m_cell_start.size(); ++ i)
+            m_cell_start[i] += m_cell_start[i - 1];
+        m_cell_keys.assign(m_keys.size(), 0);
+        std::vector<size_t> cell_end(m_cell_start.begin(), m_cell_start.end() - 1);
+        for (size_t i = 0; i < m_keys.size(); ++ i)
+            m_cell_keys[cell_end[key_cells[i]] ++] = m_keys[i];
+    }
+
+    void test_cell(const Point &pt, int64_t x, int64_t y, size_t &best_key, double &best_dist) const
+    {
+        size_t cell = size_t(y * m_cols + x);
+        for (size_t i = m_cell_start[cell]; i < m_cell_start[cell + 1]; ++ i)
+            this->test(pt, m_cell_keys[i], best_key, best_dist);
+    }
+
+    void test(const Point &pt, size_t key, size_t &best_key, double &best_dist) const
+    {
+        if (m_removed[key / m_keys_per_item])
+            return;
+        const Point &p  = m_points[key];
+        double       dx = double(pt.x() - p.x());
+        double       dy = double(pt.y() - p.y());
+        double       d  = dx * dx + dy * dy;
+        if (d < best_dist || (d == best_dist &&
+            ((m_tie_break == ctbLowestIndex || d == 0.) ? key < best_key : key > best_key))) {
+            best_key  = key;
+            best_dist = d;
+        }
+    }
+
+    const Points               &m_points;
+    size_t                      m_keys_per_item;
+    ChainTieBreak               m_tie_break;
+    // Per item: Was the item chained already?
+    std::vector<bool>           m_removed;
+    // Per item: Number of its keys.
+    std::vector<unsigned char>  m_item_keys;
+    // Number of keys of the items not removed yet.
+    size_t                      m_num_live = 0;
+    // Keys at the time the grid was built.
+    std::vector<size_t>         m_keys;
+    // Regular grid, zero cell size if no grid is built.
+    int64_t                     m_cell_size = 0;
+    Point                       m_origin;
+    int64_t                     m_cols = 0;
+    int64_t                     m_rows = 0;
+    std::vector<size_t>         m_cell_start;
+    std::vector<size_t>         m_cell_keys;
+};
+
+std::vector<std::pair<size_t, bool>> chain_segments(const Points &end_points, const Point &start_near, bool could_reverse, const std::vector<bool> *reversible, ChainTieBreak tie_break)
+{
+    assert(end_points.size() % 2 == 0);
+    assert(reversible == nullptr || reversible->size() * 2 == end_points.size());
+    size_t num_segments = end_points.size() / 2;
+    std::vector<std::pair<size_t, bool>> out;
+    out.reserve(num_segments);
+    if (num_segments == 0)
+        return out;
+
+    ChainSearch search(end_points, 2, tie_break);
+    for (size_t i = 0; i < num_segments; ++ i) {
+        search.add_key(2 * i);
+        if (could_reverse && (reversible == nullptr || (*reversible)[i]))
+            search.add_key(2 * i + 1);
+    }
+    search.init();
+
+    Point pt = start_near;
+    for (size_t i = 0; i < num_segments; ++ i) {
+        size_t key     = search.nearest(pt);
+        size_t segment = key / 2;
+        bool   reverse = (key & 1) != 0;
+        out.emplace_back(segment, reverse);
+        search.remove_item(segment);
+        pt = end_points[reverse ? key - 1 : key + 1];
+    }
+    return out;
+}
+
+std::vector<size_t> chain_points(const Points &points, const Point &start_near, ChainTieBreak tie_break)
+{
+    std::vector<size_t> out;
+    out.reserve(points.size());
+    if (points.empty())
+        return out;
+
+    ChainSearch search(points, 1, tie_break);
+    for (size_t i = 0; i < points.size(); ++ i)
+        search.add_key(i);
+    search.init();
+
+    Point pt = start_near;
+    for (size_t i = 0; i < points.size(); ++ i) {
+        size_t idx = search.nearest(pt);
+        out.emplace_back(idx);
+        search.remove_item(idx);
+        pt = points[idx];
+    }
+    return out;
+}
+
+static inline const Point& chain_entry_point(const std::pair<size_t, bool> &segment, const Points &end_points)
+    { return end_points[2 * segment.first + (segment.second ? 1 : 0)]; }
+static inline const Point& chain_exit_point(const std::pair<size_t, bool> &segment, const Points &end_points)
+    { return end_points[2 * segment.first + (segment.second ? 0 : 1)]; }
+static inline double chain_distance(const Point &p1, const Point &p2)
+    { return (p2.cast<double>() - p1.cast<double>()).norm(); }
+
+double chain_travel_length(const std::vector<std::pair<size_t, bool>> &chain, const Points &end_points, const Point &start_near)
+{
+    double length = 0.;
+    const Point *pt = &start_near;
+    for (const std::pair<size_t, bool> &segment : chain) {
+        length += chain_distance(*pt, chain_entry_point(segment, end_points));
+        pt = &chain_exit_point(segment, end_points);
+    }
+    return length;
+}
+
+void improve_chain_2opt(std::vector<std::pair<size_t, bool>> &chain, const Points &end_points, const Point &start_near, const std::vector<bool> *reversible, size_t max_run, size_t max_passes)
+{
+    auto can_reverse = [reversible](size_t segment) { return reversible == nullptr || (*reversible)[segment]; };
+    for (size_t pass = 0; pass < max_passes; ++ pass) {
+        bool improved = false;
+        for (size_t i = 0; i < chain.size(); ++ i) {
+            const Point &prev = (i == 0) ? start_near : chain_exit_point(chain[i - 1], end_points);
+            for (size_t j = i; j < chain.size() && j < i + max_run && can_reverse(chain[j].first); ++ j) {
+                // Reversing the run i..j changes just the travel into the run and the travel out of the run.
+                const Point &entry_i = chain_entry_point(chain[i], end_points);
+                const Point &exit_j  = chain_exit_point(chain[j], end_points);
+                double before = chain_distance(prev, entry_i);
+                double after  = chain_distance(prev, exit_j);
+                if (j + 1 < chain.size()) {
+                    const Point &next = chain_entry_point(chain[j + 1], end_points);
+                    before += chain_distance(exit_j, next);
+                    after  += chain_distance(entry_i, next);
+                }
+                // Require an improvement of at least a single scaled unit to not oscillate due to rounding errors.
+                if (after + 1. < before) {
+                    std::reverse(chain.begin() + i, chain.begin() + j + 1);
+                    for (size_t k = i; k <= j; ++ k)
+                        chain[k].second = ! chain[k].second;
+                    improved = true;
+                    break;
+                }
+            }
+        }
+        if (! improved)
+            break;
+    }
+}
+
+} // namespace Slic3r
@@ -0,0 +1,47 @@
+#ifndef slic3r_ShortestPath_hpp_
+#define slic3r_ShortestPath_hpp_
+
+#include "libslic3r.h"
+#include "Point.hpp"
+
+#include <utility>
+#include <vector>
+
+namespace Slic3r {
+
+// Which one of the candidates with the same distance from the current position is picked by the greedy chaining.
+// The chaining functions this engine replaced resolved the ties differently, the tie breaking is retained
+// so that their results are reproduced exactly.
+enum ChainTieBreak
+{
+    // The candidate with the lowest index.
+    ctbLowestIndex,
+    // The candidate with the highest index, unless the candidate coincides with the current position,
+    // in which case the coincident candidate with the lowest index is picked.
+    ctbHighestIndex,
+};
+
+// Order segments (polylines, extrusions) by a greedy nearest neighbor walk starting at start_near to shorten the travel moves.
+// Segment i starts at end_points[2 * i] and ends at end_points[2 * i + 1]. A segment may be entered from its end point
+// and then traversed reversed if could_reverse is set and the segment is not excluded by the reversible vector.
+// Returns the chain as pairs of (segment index, reversed).
+// The nearest segment is searched in a regular grid of the end points with lazy deletion of the already chained segments,
+// therefore the chaining runs in O(n log n) time for evenly distributed segments, instead of O(n^2) of a linear search.
+std::vector<std::pair<size_t, bool>> chain_segments(const Points &end_points, const Point &start_near, bool could_reverse = true,
+    const std::vector<bool> *reversible = nullptr, ChainTieBreak tie_break = ctbLowestIndex);
+
+// Order points by a greedy nearest neighbor walk starting at start_near. Returns the indices of the points.
+std::vector<size_t> chain_points(const Points &points, const Point &start_near, ChainTieBreak tie_break = ctbLowestIndex);
+
+// Length of the travel moves of a chain returned by chain_segments().
+double chain_travel_length(const std::vector<std::pair<size_t, bool>> &chain, const Points &end_points, const Point &start_near);
+
+// Optional improvement of a chain returned by chain_segments() by 2-opt moves: A run of at most max_run consecutive segments
+// is reversed (both its order and the directions of its segments) if it shortens the travel. Runs containing segments,
+// which shall not be reversed, are skipped. Repeated until no improvement is found or max_passes is reached.
+void improve_chain_2opt(std::vector<std::pair<size_t, bool>> &chain, const Points &end_points, const Point &start_near,
+    const std::vector<bool> *reversible = nullptr, size_t max_run = 32, size_t max_passes = 4);
+
+} // namespace Slic3r
+
+#endif /* slic3r_ShortestPath_hpp_ */
@@ -7,7 +7,9 @@
 #include "Fill/FillBase.hpp"
 #include "EdgeGrid.hpp"
 #include "Geometry.hpp"
+#include "Profiler.hpp"
 
+#include <algorithm>
 #include <cmath>
 #include <memory>
 #include <boost/log/trivial.hpp>
@@ -218,6 +220,7 @@ struct MyLayersPtrCompare
 
 void PrintObjectSupportMaterial::generate(PrintObject &object)
 {
+    SLIC3R_PROFILE_ZONE("PrintObjectSupportMaterial::generate");
     BOOST_LOG_TRIVIAL(info) << "Support generator - Start";
 
     coordf_t max_object_layer_height = 0.;
@@ -959,6 +962,7 @@ static int run_support_test = Test();
 PrintObjectSupportMaterial::MyLayersPtr PrintObjectSupportMaterial::top_contact_layers(
     const PrintObject &object, MyLayerStorage &layer_storage) const
 {
+    SLIC3R_PROFILE_ZONE("PrintObjectSupportMaterial::top_contact_layers");
 #ifdef SLIC3R_DEBUG
     static int iRun = 0;
     ++ iRun; 
@@ -1411,6 +1415,7 @@ PrintObjectSupportMaterial::MyLayersPtr PrintObjectSupportMaterial::bottom_conta
     const PrintObject &object, const MyLayersPtr &top_contacts, MyLayerStorage &layer_storage,
     std::vector<Polygons> &layer_support_areas) const
 {
+    SLIC3R_PROFILE_ZONE("PrintObjectSupportMaterial::bottom_contact_layers_and_layer_support_areas");
 #ifdef SLIC3R_DEBUG
     static int iRun = 0;
     ++ iRun; 
@@ -1426,40 +1431,157 @@ PrintObjectSupportMaterial::MyLayersPtr PrintObjectSupportMaterial::bottom_conta
     if (! top_contacts.empty()) 
     {
         // There is some support to be built, if there are non-empty top surfaces detected.
+        // The projection of the contact areas is swept from the top layer down, trimmed by the object slices and stretched into a grid
+        // at each layer. The gridding makes each layer depend on the result of the layer above, therefore only this sweep is serial.
+        // Everything the sweep consumes is prepared in parallel beforehand, and the bottom contacts are detected in parallel afterwards.
+        const size_t num_layers = object.total_layer_count();
+        // The layers visited by the sweep. The topmost layer does not support anything.
+        const size_t num_sweep_layers = std::max<size_t>(num_layers, 1) - 1;
+        const bool   detect_bottom_contacts = ! m_object_config->support_material_buildplate_only;
+
+        // 1) Per layer: Top surfaces, which may receive bottom contacts, and the slices trimming the projection.
+        std::vector<Polygons> layer_top(num_sweep_layers);
+        std::vector<Polygons> layer_trimming(num_sweep_layers);
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, num_sweep_layers),
+            [&object, detect_bottom_contacts, &layer_top, &layer_trimming](const tbb::blocked_range<size_t>& range) {
+                for (size_t layer_id = range.begin(); layer_id < range.end(); ++ layer_id) {
+                    const Layer &layer = *object.get_layer(int(layer_id));
+                    if (detect_bottom_contacts)
+                        layer_top[layer_id] = collect_region_slices_by_type(layer, stTop);
+        //            Polygons trimming = union_(to_polygons(layer.slices.expolygons), touching, true);
+                    layer_trimming[layer_id] = offset(layer.slices.expolygons, float(SCALED_EPSILON));
+                }
+            });
+        // Per top contact layer: Its contribution to the projection. Only the top contact layers reached by the sweep are consumed.
+        std::vector<Polygons> contact_projection(top_contacts.size());
+        {
+            int contact_idx_min = int(top_contacts.size());
+            if (num_sweep_layers > 0)
+                while (contact_idx_min > 0 && top_contacts[contact_idx_min - 1]->print_z > object.get_layer(0)->print_z - EPSILON)
+                    -- contact_idx_min;
+            tbb::parallel_for(tbb::blocked_range<int>(contact_idx_min, int(top_contacts.size())),
+                [&top_contacts, &contact_projection](const tbb::blocked_range<int>& range) {
+                    for (int contact_idx = range.begin(); contact_idx < range.end(); ++ contact_idx) {
+                        Polygons polygons_new;
+                        // Contact surfaces are expanded away from the object, trimmed by the object.
+                        // Use a slight positive offset to overlap the touching regions.
+#if 0
+                        // Merge and collect the contact polygons. The contact polygons are inflated, but not extended into a grid form.
+                        polygons_append(polygons_new, offset(*top_contacts[contact_idx]->contact_polygons, SCALED_EPSILON));
+#else
+                        // Consume the contact_polygons. The contact polygons are already expanded into a grid form, and they are a tiny bit smaller
+                        // than the grid cells.
+                        polygons_append(polygons_new, std::move(*top_contacts[contact_idx]->contact_polygons));
+#endif
+                        // These are the overhang surfaces. They are touching the object and they are not expanded away from the object.
+                        // Use a slight positive offset to overlap the touching regions.
+                        polygons_append(polygons_new, offset(*top_contacts[contact_idx]->overhang_polygons, float(SCALED_EPSILON)));
+                        contact_projection[contact_idx] = union_(polygons_new);
+                    }
+                });
+        }
+
+        // 2) The serial sweep. Per layer: The projection of the unsupported contact areas above the layer, to be tested
+        // against the top surfaces of the layer, and the index of the last top contact layer collected into the projection.
+        std::vector<Polygons> layer_projection_raw(num_sweep_layers);
+        std::vector<int>      layer_contact_idx(num_sweep_layers, 0);
         // Sum of unsupported contact areas above the current layer.print_z.
         Polygons  projection;
         // Last top contact layer visited when collecting the projection of contact areas.
         int       contact_idx = int(top_contacts.size()) - 1;
-        for (int layer_id = int(object.total_layer_count()) - 2; layer_id >= 0; -- layer_id) {
+        for (int layer_id = int(num_sweep_layers) - 1; layer_id >= 0; -- layer_id) {
             BOOST_LOG_TRIVIAL(trace) << "Support generator - bottom_contact_layers - layer " << layer_id;
             const Layer &layer = *object.get_layer(layer_id);
             // Collect projections of all contact areas above or at the same level as this top surface.
-            for (; contact_idx >= 0 && top_contacts[contact_idx]->print_z > layer.print_z - EPSILON; -- contact_idx) {
-                Polygons polygons_new;
-                // Contact surfaces are expanded away from the object, trimmed by the object.
-                // Use a slight positive offset to overlap the touching regions.
-#if 0
-                // Merge and collect the contact polygons. The contact polygons are inflated, but not extended into a grid form.
-                polygons_append(polygons_new, offset(*top_contacts[contact_idx]->contact_polygons, SCALED_EPSILON));
-#else
-                // Consume the contact_polygons. The contact polygons are already expanded into a grid form, and they are a tiny bit smaller
-                // than the grid cells.
-                polygons_append(polygons_new, std::move(*top_contacts[contact_idx]->contact_polygons));
-#endif
-                // These are the overhang surfaces. They are touching the object and they are not expanded away from the object.
-                // Use a slight positive offset to overlap the touching regions.
-                polygons_append(polygons_new, offset(*top_contacts[contact_idx]->overhang_polygons, float(SCALED_EPSILON)));
-                polygons_append(projection, union_(polygons_new));
-            }
+            for (; contact_idx >= 0 && top_contacts[contact_idx]->print_z > layer.print_z - EPSILON; -- contact_idx)
+                polygons_append(projection, std::move(contact_projection[contact_idx]));
             if (projection.empty())
                 continue;
             Polygons projection_raw = union_(projection);
+            const Polygons &trimming = layer_trimming[layer_id];
+            // Remove the areas that touched from the projection that will continue on next, lower, top surfaces.
+            projection = diff(projection_raw, trimming, false);
+    #ifdef SLIC3R_DEBUG
+            {
+                BoundingBox bbox = get_extents(projection_raw);
+                bbox.merge(get_extents(trimming));
+                ::Slic3r::SVG svg(debug_out_path("support-support-areas-raw-%d-%lf.svg", iRun, layer.print_z), bbox);
+                svg.draw(union_ex(trimming, false), "blue", 0.5f);
+                svg.draw(union_ex(projection, true), "red", 0.5f);
+                svg.draw_outline(union_ex(projection, true), "red", "blue", scale_(0.1f));
+            }
+    #endif /* SLIC3R_DEBUG */
+            remove_sticks(projection);
+            remove_degenerate(projection);
+    #ifdef SLIC3R_DEBUG
+            Slic3r::SVG::export_expolygons(
+                debug_out_path("support-support-areas-raw-cleaned-%d-%lf.svg", iRun, layer.print_z),
+                union_ex(projection, false));
+    #endif /* SLIC3R_DEBUG */
+            SupportGridPattern support_grid_pattern(
+                // Support islands, to be stretched into a grid.
+                projection, 
+                // Trimming polygons, to trim the stretched support islands.
+                trimming,
+                // Grid spacing.
+                m_object_config->support_material_spacing.value + m_support_material_flow.spacing(),
+                Geometry::deg2rad(m_object_config->support_material_angle.value));
+            tbb::task_group task_group_inner;
+            // 1) Cache the slice of a support volume. The support volume is expanded by 1/2 of support material flow spacing
+            // to allow a placement of suppot zig-zag snake along the grid lines.
+            Polygons &layer_support_area = layer_support_areas[layer_id];
+            task_group_inner.run([this, &support_grid_pattern, &layer_support_area
+    #ifdef SLIC3R_DEBUG 
+                , &layer
+    #endif /* SLIC3R_DEBUG */
+                ] {
+                layer_support_area = support_grid_pattern.extract_support(m_support_material_flow.scaled_spacing()/2 + 25, true);
+    #ifdef SLIC3R_DEBUG
+                Slic3r::SVG::export_expolygons(
+                    debug_out_path("support-layer_support_area-gridded-%d-%lf.svg", iRun, layer.print_z),
+                    union_ex(layer_support_area, false));
+    #endif /* SLIC3R_DEBUG */
+            });
+            // 2) Support polygons will be projected down. To keep the interface and base layers from growing, return a contour a tiny bit smaller than the grid cells.
+            Polygons projection_new;
+            task_group_inner.run([&projection_new, &support_grid_pattern
+    #ifdef SLIC3R_DEBUG 
+                , &layer
+    #endif /* SLIC3R_DEBUG */
+                ] {
+                projection_new = support_grid_pattern.extract_support(-5, true);
+    #ifdef SLIC3R_DEBUG
+                Slic3r::SVG::export_expolygons(
+                    debug_out_path("support-projection_new-gridded-%d-%lf.svg", iRun, layer.print_z),
+                    union_ex(projection_new, false));
+    #endif /* SLIC3R_DEBUG */
+            });
+            task_group_inner.wait();
+            projection = std::move(projection_new);
+            if (! layer_top[layer_id].empty()) {
+                // Keep the projection for the detection of the bottom contacts.
+                layer_projection_raw[layer_id] = std::move(projection_raw);
+                layer_contact_idx[layer_id]    = contact_idx;
+            }
+        }
+        layer_trimming.clear();
+        layer_trimming.shrink_to_fit();
 
-            tbb::task_group task_group;
-            if (! m_object_config->support_material_buildplate_only)
-                // Find the bottom contact layers above the top surfaces of this layer.
-                task_group.run([this, &object, &top_contacts, contact_idx, &layer, layer_id, &layer_storage, &layer_support_areas, &bottom_contacts, &projection_raw] {
-                    Polygons top = collect_region_slices_by_type(layer, stTop);
+        // 3) Find the bottom contact layers above the top surfaces of the object layers, in parallel.
+        // The bottom contacts are indexed by the object layer below, their bottom contact areas are inflated to trim the support areas.
+        std::vector<MyLayer*> layer_bottom_contact(num_sweep_layers, nullptr);
+        std::vector<Polygons> layer_touching(num_sweep_layers);
+        tbb::spin_mutex layer_storage_mutex;
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, num_sweep_layers),
+            [this, &object, &top_contacts, &layer_storage, &layer_storage_mutex, &layer_top, &layer_projection_raw, &layer_contact_idx, &layer_bottom_contact, &layer_touching]
+            (const tbb::blocked_range<size_t>& range) {
+                for (size_t layer_id = range.begin(); layer_id < range.end(); ++ layer_id) {
+                    const Layer    &layer          = *object.get_layer(int(layer_id));
+                    const Polygons &top            = layer_top[layer_id];
+                    const Polygons &projection_raw = layer_projection_raw[layer_id];
+                    const int       contact_idx    = layer_contact_idx[layer_id];
+                    if (projection_raw.empty())
+                        continue;
         #ifdef SLIC3R_DEBUG
                     {
                         BoundingBox bbox = get_extents(projection_raw);
@@ -1476,161 +1598,112 @@ PrintObjectSupportMaterial::MyLayersPtr PrintObjectSupportMaterial::bottom_conta
                     // top surfaces above layer.print_z falls onto this top surface. 
                     // Touching are the contact surfaces supported exclusively by this top surfaces.
                     // Don't use a safety offset as it has been applied during insertion of polygons.
-                    if (! top.empty()) {
-                        Polygons touching = intersection(top, projection_raw, false);
-                        if (! touching.empty()) {
-                            // Allocate a new bottom contact layer.
-                            MyLayer &layer_new = layer_allocate(layer_storage, sltBottomContact);
-                            bottom_contacts.push_back(&layer_new);
-                            // Grow top surfaces so that interface and support generation are generated
-                            // with some spacing from object - it looks we don't need the actual
-                            // top shapes so this can be done here
-                            //FIXME calculate layer height based on the actual thickness of the layer:
-                            // If the layer is extruded with no bridging flow, support just the normal extrusions.
-                            layer_new.height  = m_slicing_params.soluble_interface ? 
-                                // Align the interface layer with the object's layer height.
-                                object.layers()[layer_id + 1]->height :
-                                // Place a bridge flow interface layer over the top surface.
-                                //FIXME Check whether the bottom bridging surfaces are extruded correctly (no bridging flow correction applied?)
-                                // According to Jindrich the bottom surfaces work well.
-                                //FIXME test the bridging flow instead?
-                                m_support_material_interface_flow.nozzle_diameter;
-                            layer_new.print_z = m_slicing_params.soluble_interface ? object.layers()[layer_id + 1]->print_z :
-                                layer.print_z + layer_new.height + m_object_config->support_material_contact_distance.value;
-                            layer_new.bottom_z = layer.print_z;
-                            layer_new.idx_object_layer_below = layer_id;
-                            layer_new.bridging = ! m_slicing_params.soluble_interface;
-                            //FIXME how much to inflate the bottom surface, as it is being extruded with a bridging flow? The following line uses a normal flow.
-                            //FIXME why is the offset positive? It will be trimmed by the object later on anyway, but then it just wastes CPU clocks.
-                            layer_new.polygons = offset(touching, float(m_support_material_flow.scaled_width()), SUPPORT_SURFACES_OFFSET_PARAMETERS);
-                            if (! m_slicing_params.soluble_interface) {
-                                // Walk the top surfaces, snap the top of the new bottom surface to the closest top of the top surface,
-                                // so there will be no support surfaces generated with thickness lower than m_support_layer_height_min.
-                                for (size_t top_idx = size_t(std::max<int>(0, contact_idx)); 
-                                    top_idx < top_contacts.size() && top_contacts[top_idx]->print_z < layer_new.print_z + this->m_support_layer_height_min + EPSILON; 
-                                    ++ top_idx) {
-                                    if (top_contacts[top_idx]->print_z > layer_new.print_z - this->m_support_layer_height_min - EPSILON) {
-                                        // A top layer has been found, which is close to the new bottom layer.
-                                        coordf_t diff = layer_new.print_z - top_contacts[top_idx]->print_z;
-                                        assert(std::abs(diff) <= this->m_support_layer_height_min + EPSILON);
-                                        if (diff > 0.) {
-                                            // The top contact layer is below this layer. Make the bridging layer thinner to align with the existing top layer.
-                                            assert(diff < layer_new.height + EPSILON);
-                                            assert(layer_new.height - diff >= m_support_layer_height_min - EPSILON);
-                                            layer_new.print_z  = top_contacts[top_idx]->print_z;
-                                            layer_new.height  -= diff;
-                                        } else {
-                                            // The top contact layer is above this layer. One may either make this layer thicker or thinner.
-                                            // By making the layer thicker, one will decrease the number of discrete layers with the price of extruding a bit too thick bridges.
-                                            // By making the layer thinner, one adds one more discrete layer.
-                                            layer_new.print_z  = top_contacts[top_idx]->print_z;
-                                            layer_new.height  -= diff;
-                                        }
-                                        break;
-                                    }
+                    Polygons touching = intersection(top, projection_raw, false);
+                    if (touching.empty())
+                        continue;
+                    // Allocate a new bottom contact layer.
+                    MyLayer &layer_new = layer_allocate(layer_storage, layer_storage_mutex, sltBottomContact);
+                    layer_bottom_contact[layer_id] = &layer_new;
+                    // Grow top surfaces so that interface and support generation are generated
+                    // with some spacing from object - it looks we don't need the actual
+                    // top shapes so this can be done here
+                    //FIXME calculate layer height based on the actual thickness of the layer:
+                    // If the layer is extruded with no bridging flow, support just the normal extrusions.
+                    layer_new.height  = m_slicing_params.soluble_interface ? 
+                        // Align the interface layer with the object's layer height.
+                        object.layers()[layer_id + 1]->height :
+                        // Place a bridge flow interface layer over the top surface.
+                        //FIXME Check whether the bottom bridging surfaces are extruded correctly (no bridging flow correction applied?)
+                        // According to Jindrich the bottom surfaces work well.
+                        //FIXME test the bridging flow instead?
+                        m_support_material_interface_flow.nozzle_diameter;
+                    layer_new.print_z = m_slicing_params.soluble_interface ? object.layers()[layer_id + 1]->print_z :
+                        layer.print_z + layer_new.height + m_object_config->support_material_contact_distance.value;
+                    layer_new.bottom_z = layer.print_z;
+                    layer_new.idx_object_layer_below = layer_id;
+                    layer_new.bridging = ! m_slicing_params.soluble_interface;
+                    //FIXME how much to inflate the bottom surface, as it is being extruded with a bridging flow? The following line uses a normal flow.
+                    //FIXME why is the offset positive? It will be trimmed by the object later on anyway, but then it just wastes CPU clocks.
+                    layer_new.polygons = offset(touching, float(m_support_material_flow.scaled_width()), SUPPORT_SURFACES_OFFSET_PARAMETERS);
+                    if (! m_slicing_params.soluble_interface) {
+                        // Walk the top surfaces, snap the top of the new bottom surface to the closest top of the top surface,
+                        // so there will be no support surfaces generated with thickness lower than m_support_layer_height_min.
+                        for (size_t top_idx = size_t(std::max<int>(0, contact_idx)); 
+                            top_idx < top_contacts.size() && top_contacts[top_idx]->print_z < layer_new.print_z + this->m_support_layer_height_min + EPSILON; 
+                            ++ top_idx) {
+                            if (top_contacts[top_idx]->print_z > layer_new.print_z - this->m_support_layer_height_min - EPSILON) {
+                                // A top layer has been found, which is close to the new bottom layer.
+                                coordf_t diff = layer_new.print_z - top_contacts[top_idx]->print_z;
+                                assert(std::abs(diff) <= this->m_support_layer_height_min + EPSILON);
+                                if (diff > 0.) {
+                                    // The top contact layer is below this layer. Make the bridging layer thinner to align with the existing top layer.
+                                    assert(diff < layer_new.height + EPSILON);
+                                    assert(layer_new.height - diff >= m_support_layer_height_min - EPSILON);
+                                    layer_new.print_z  = top_contacts[top_idx]->print_z;
+                                    layer_new.height  -= diff;
+                                } else {
+                                    // The top contact layer is above this layer. One may either make this layer thicker or thinner.
+                                    // By making the layer thicker, one will decrease the number of discrete layers with the price of extruding a bit too thick bridges.
+                                    // By making the layer thinner, one adds one more discrete layer.
+                                    layer_new.print_z  = top_contacts[top_idx]->print_z;
+                                    layer_new.height  -= diff;
                                 }
+                                break;
                             }
-                #ifdef SLIC3R_DEBUG
-                            Slic3r::SVG::export_expolygons(
-                                debug_out_path("support-bottom-contacts-%d-%lf.svg", iRun, layer_new.print_z),
-                                union_ex(layer_new.polygons, false));
-                #endif /* SLIC3R_DEBUG */
-                            // Trim the already created base layers above the current layer intersecting with the new bottom contacts layer.
-                            //FIXME Maybe this is no more needed, as the overlapping base layers are trimmed by the bottom layers at the final stage?
-                            touching = offset(touching, float(SCALED_EPSILON));
-                            for (int layer_id_above = layer_id + 1; layer_id_above < int(object.total_layer_count()); ++ layer_id_above) {
-                                const Layer &layer_above = *object.layers()[layer_id_above];
-                                if (layer_above.print_z > layer_new.print_z - EPSILON)
-                                    break; 
-                                if (! layer_support_areas[layer_id_above].empty()) {
+                        }
+                    }
+        #ifdef SLIC3R_DEBUG
+                    Slic3r::SVG::export_expolygons(
+                        debug_out_path("support-bottom-contacts-%d-%lf.svg", iRun, layer_new.print_z),
+                        union_ex(layer_new.polygons, false));
+        #endif /* SLIC3R_DEBUG */
+                    layer_touching[layer_id] = offset(touching, float(SCALED_EPSILON));
+                }
+            });
+        layer_top.clear();
+        layer_projection_raw.clear();
+        std::vector<size_t> bottom_contact_layer_ids;
+        for (size_t layer_id = 0; layer_id < num_sweep_layers; ++ layer_id)
+            if (layer_bottom_contact[layer_id] != nullptr) {
+                bottom_contacts.push_back(layer_bottom_contact[layer_id]);
+                bottom_contact_layer_ids.emplace_back(layer_id);
+            }
+
+        // 4) Trim the already created base layers above the bottom contact layers intersecting with the new bottom contacts layer.
+        //FIXME Maybe this is no more needed, as the overlapping base layers are trimmed by the bottom layers at the final stage?
+        // Each support area is trimmed by the bottom contacts below it, starting with the highest bottom contact, as the sweep would do.
+        if (! bottom_contacts.empty())
+            tbb::parallel_for(tbb::blocked_range<size_t>(bottom_contact_layer_ids.front() + 1, num_layers),
+                [&object, &bottom_contact_layer_ids, &layer_bottom_contact, &layer_touching, &layer_support_areas](const tbb::blocked_range<size_t>& range) {
+                    for (size_t layer_id_above = range.begin(); layer_id_above < range.end(); ++ layer_id_above) {
+                        const Layer &layer_above = *object.layers()[layer_id_above];
+                        for (auto it = std::lower_bound(bottom_contact_layer_ids.begin(), bottom_contact_layer_ids.end(), layer_id_above);
+                            it != bottom_contact_layer_ids.begin() && ! layer_support_areas[layer_id_above].empty();) {
+                            size_t         layer_id  = *(-- it);
+                            const MyLayer &layer_new = *layer_bottom_contact[layer_id];
+                            if (layer_above.print_z > layer_new.print_z - EPSILON)
+                                continue;
+                            const Polygons &touching = layer_touching[layer_id];
 #ifdef SLIC3R_DEBUG
-                                    {
-                                        BoundingBox bbox = get_extents(touching);
-                                        bbox.merge(get_extents(layer_support_areas[layer_id_above]));
-                                        ::Slic3r::SVG svg(debug_out_path("support-support-areas-raw-before-trimming-%d-with-%f-%lf.svg", iRun, layer.print_z, layer_above.print_z), bbox);
-                                        svg.draw(union_ex(touching, false), "blue", 0.5f);
-                                        svg.draw(union_ex(layer_support_areas[layer_id_above], true), "red", 0.5f);
-                                        svg.draw_outline(union_ex(layer_support_areas[layer_id_above], true), "red", "blue", scale_(0.1f));
-                                    }
+                            {
+                                const Layer &layer = *object.layers()[layer_id];
+                                BoundingBox bbox = get_extents(touching);
+                                bbox.merge(get_extents(layer_support_areas[layer_id_above]));
+                                ::Slic3r::SVG svg(debug_out_path("support-support-areas-raw-before-trimming-%d-with-%f-%lf.svg", iRun, layer.print_z, layer_above.print_z), bbox);
+                                svg.draw(union_ex(touching, false), "blue", 0.5f);
+                                svg.draw(union_ex(layer_support_areas[layer_id_above], true), "red", 0.5f);
+                                svg.draw_outline(union_ex(layer_support_areas[layer_id_above], true), "red", "blue", scale_(0.1f));
+                            }
 #endif /* SLIC3R_DEBUG */
-                                    layer_support_areas[layer_id_above] = diff(layer_support_areas[layer_id_above], touching);
+                            layer_support_areas[layer_id_above] = diff(layer_support_areas[layer_id_above], touching);
 #ifdef SLIC3R_DEBUG
-                                    Slic3r::SVG::export_expolygons(
-                                        debug_out_path("support-support-areas-raw-after-trimming-%d-with-%f-%lf.svg", iRun, layer.print_z, layer_above.print_z),
-                                        union_ex(layer_support_areas[layer_id_above], false));
+                            Slic3r::SVG::export_expolygons(
+                                debug_out_path("support-support-areas-raw-after-trimming-%d-with-%f-%lf.svg", iRun, object.layers()[layer_id]->print_z, layer_above.print_z),
+                                union_ex(layer_support_areas[layer_id_above], false));
 #endif /* SLIC3R_DEBUG */
-                                }
-                            }
                         }
-                    } // ! top.empty()
-                });
-
-            Polygons &layer_support_area = layer_support_areas[layer_id];
-            task_group.run([this, &projection, &projection_raw, &layer, &layer_support_area, layer_id] {
-                // Remove the areas that touched from the projection that will continue on next, lower, top surfaces.
-    //            Polygons trimming = union_(to_polygons(layer.slices.expolygons), touching, true);
-                Polygons trimming = offset(layer.slices.expolygons, float(SCALED_EPSILON));
-                projection = diff(projection_raw, trimming, false);
-    #ifdef SLIC3R_DEBUG
-                {
-                    BoundingBox bbox = get_extents(projection_raw);
-                    bbox.merge(get_extents(trimming));
-                    ::Slic3r::SVG svg(debug_out_path("support-support-areas-raw-%d-%lf.svg", iRun, layer.print_z), bbox);
-                    svg.draw(union_ex(trimming, false), "blue", 0.5f);
-                    svg.draw(union_ex(projection, true), "red", 0.5f);
-                    svg.draw_outline(union_ex(projection, true), "red", "blue", scale_(0.1f));
-                }
-    #endif /* SLIC3R_DEBUG */
-                remove_sticks(projection);
-                remove_degenerate(projection);
-        #ifdef SLIC3R_DEBUG
-                Slic3r::SVG::export_expolygons(
-                    debug_out_path("support-support-areas-raw-cleaned-%d-%lf.svg", iRun, layer.print_z),
-                    union_ex(projection, false));
-        #endif /* SLIC3R_DEBUG */
-                SupportGridPattern support_grid_pattern(
-                    // Support islands, to be stretched into a grid.
-                    projection, 
-                    // Trimming polygons, to trim the stretched support islands.
-                    trimming,
-                    // Grid spacing.
-                    m_object_config->support_material_spacing.value + m_support_material_flow.spacing(),
-                    Geometry::deg2rad(m_object_config->support_material_angle.value));
-                tbb::task_group task_group_inner;
-                // 1) Cache the slice of a support volume. The support volume is expanded by 1/2 of support material flow spacing
-                // to allow a placement of suppot zig-zag snake along the grid lines.
-                task_group_inner.run([this, &support_grid_pattern, &layer_support_area
-        #ifdef SLIC3R_DEBUG 
-                    , &layer
-        #endif /* SLIC3R_DEBUG */
-                    ] {
-                    layer_support_area = support_grid_pattern.extract_support(m_support_material_flow.scaled_spacing()/2 + 25, true);
-        #ifdef SLIC3R_DEBUG
-                    Slic3r::SVG::export_expolygons(
-                        debug_out_path("support-layer_support_area-gridded-%d-%lf.svg", iRun, layer.print_z),
-                        union_ex(layer_support_area, false));
-        #endif /* SLIC3R_DEBUG */
-                });
-                // 2) Support polygons will be projected down. To keep the interface and base layers from growing, return a contour a tiny bit smaller than the grid cells.
-                Polygons projection_new;
-                task_group_inner.run([&projection_new, &support_grid_pattern
-        #ifdef SLIC3R_DEBUG 
-                    , &layer
-        #endif /* SLIC3R_DEBUG */
-                    ] {
-                    projection_new = support_grid_pattern.extract_support(-5, true);
-        #ifdef SLIC3R_DEBUG
-                    Slic3r::SVG::export_expolygons(
-                        debug_out_path("support-projection_new-gridded-%d-%lf.svg", iRun, layer.print_z),
-                        union_ex(projection_new, false));
-        #endif /* SLIC3R_DEBUG */
+                    }
                 });
-                task_group_inner.wait();
-                projection = std::move(projection_new);
-            });
-            task_group.wait();
-        }
-        std::reverse(bottom_contacts.begin(), bottom_contacts.end());
 //        trim_support_layers_by_object(object, bottom_contacts, 0., 0., m_gap_xy);
         trim_support_layers_by_object(object, bottom_contacts, 
             m_slicing_params.soluble_interface ? 0. : m_object_config->support_material_contact_distance.value, 
@@ -1707,6 +1780,7 @@ int idx_lower_or_equal(const std::vector<T*> &vec, int idx, FN_LOWER_EQUAL fn_lo
 void PrintObjectSupportMaterial::trim_top_contacts_by_bottom_contacts(
     const PrintObject &object, const MyLayersPtr &bottom_contacts, MyLayersPtr &top_contacts) const
 {
+    SLIC3R_PROFILE_ZONE("PrintObjectSupportMaterial::trim_top_contacts_by_bottom_contacts");
     tbb::parallel_for(tbb::blocked_range<int>(0, int(top_contacts.size())),
         [this, &object, &bottom_contacts, &top_contacts](const tbb::blocked_range<int>& range) {
             int idx_bottom_overlapping_first = -2;
@@ -1735,6 +1809,7 @@ PrintObjectSupportMaterial::MyLayersPtr PrintObjectSupportMaterial::raft_and_int
     const MyLayersPtr   &top_contacts,
     MyLayerStorage      &layer_storage) const
 {
+    SLIC3R_PROFILE_ZONE("PrintObjectSupportMaterial::raft_and_intermediate_support_layers");
     MyLayersPtr intermediate_layers;
 
     // Collect and sort the extremes (bottoms of the top contacts and tops of the bottom contacts).
@@ -1924,6 +1999,7 @@ void PrintObjectSupportMaterial::generate_base_layers(
     MyLayersPtr         &intermediate_layers,
     const std::vector<Polygons> &layer_support_areas) const
 {
+    SLIC3R_PROFILE_ZONE("PrintObjectSupportMaterial::generate_base_layers");
 #ifdef SLIC3R_DEBUG
     static int iRun = 0;
 #endif /* SLIC3R_DEBUG */
@@ -2066,6 +2142,7 @@ void PrintObjectSupportMaterial::trim_support_layers_by_object(
     const coordf_t       gap_extra_below,
     const coordf_t       gap_xy) const
 {
+    SLIC3R_PROFILE_ZONE("PrintObjectSupportMaterial::trim_support_layers_by_object");
     const float gap_xy_scaled = float(scale_(gap_xy));
 
     // Collect non-empty layers to be processed in parallel.
@@ -2139,6 +2216,7 @@ PrintObjectSupportMaterial::MyLayersPtr PrintObjectSupportMaterial::generate_raf
     const MyLayersPtr   &base_layers,
     MyLayerStorage      &layer_storage) const
 {
+    SLIC3R_PROFILE_ZONE("PrintObjectSupportMaterial::generate_raft_base");
     // How much to inflate the support columns to be stable. This also applies to the 1st layer, if no raft layers are to be printed.
     const float inflate_factor_fine      = float(scale_((m_slicing_params.raft_layers() > 1) ? 0.5 : EPSILON));
     const float inflate_factor_1st_layer = float(scale_(3.)) - inflate_factor_fine;
@@ -2229,6 +2307,7 @@ PrintObjectSupportMaterial::MyLayersPtr PrintObjectSupportMaterial::generate_int
     MyLayersPtr         &intermediate_layers,
     MyLayerStorage      &layer_storage) const
 {
+    SLIC3R_PROFILE_ZONE("PrintObjectSupportMaterial::generate_interface_layers");
 //    my $area_threshold = $self->interface_flow->scaled_spacing ** 2;
 
     MyLayersPtr interface_layers;
@@ -2914,6 +2993,7 @@ void PrintObjectSupportMaterial::generate_toolpaths(
     const MyLayersPtr   &intermediate_layers,
     const MyLayersPtr   &interface_layers) const
 {
+    SLIC3R_PROFILE_ZONE("PrintObjectSupportMaterial::generate_toolpaths");
 //    Slic3r::debugf "Generating patterns\n";
     // loop_interface_processor with a given circle radius.
     LoopInterfaceProcessor loop_interface_processor(1.5 * m_support_material_interface_flow.scaled_width());
@@ -2990,6 +3070,7 @@ void PrintObjectSupportMaterial::generate_toolpaths(
         {
             assert(support_layer_id < raft_layers.size());
             SupportLayer &support_layer = *object.support_layers()[support_layer_id];
+            ExtrusionEntityArena::Scope arena_scope(support_layer.extrusion_arena());
             assert(support_layer.support_fills.entities.empty());
             MyLayer      &raft_layer    = *raft_layers[support_layer_id];
 
@@ -3103,6 +3184,7 @@ void PrintObjectSupportMaterial::generate_toolpaths(
         for (size_t support_layer_id = range.begin(); support_layer_id < range.end(); ++ support_layer_id)
         {
             SupportLayer &support_layer = *object.support_layers()[support_layer_id];
+            ExtrusionEntityArena::Scope arena_scope(support_layer.extrusion_arena());
             LayerCache   &layer_cache   = layer_caches[support_layer_id];
 
             // Find polygons with the same print_z.
@@ -3305,6 +3387,7 @@ void PrintObjectSupportMaterial::generate_toolpaths(
             (const tbb::blocked_range<size_t>& range) {
         for (size_t support_layer_id = range.begin(); support_layer_id < range.end(); ++ support_layer_id) {
             SupportLayer &support_layer = *object.support_layers()[support_layer_id];
+            ExtrusionEntityArena::Scope arena_scope(support_layer.extrusion_arena());
             LayerCache   &layer_cache   = layer_caches[support_layer_id];
             for (LayerCacheItem &layer_cache_item : layer_cache.overlaps) {
                 modulate_extrusion_by_overlapping_layers(layer_cache_item.layer_extruded->extrusions, *layer_cache_item.layer_extruded->layer, layer_cache_item.overlapping);
@@ -19,6 +19,8 @@
 #include <boost/log/trivial.hpp>
 
 #include <tbb/parallel_for.h>
+#include <tbb/parallel_sort.h>
+#include <tbb/task_scheduler_init.h>
 
 #include <Eigen/Core>
 #include <Eigen/Dense>
@@ -771,19 +773,7 @@ void TriangleMeshSlicer::slice(const std::vector<float> &z, std::vector<Polygons
     
     BOOST_LOG_TRIVIAL(debug) << "TriangleMeshSlicer::_slice_do";
     std::vector<IntersectionLines> lines(z.size());
-    {
-        boost::mutex lines_mutex;
-        tbb::parallel_for(
-            tbb::blocked_range<int>(0,this->mesh->stl.stats.number_of_facets),
-            [&lines, &lines_mutex, &z, throw_on_cancel, this](const tbb::blocked_range<int>& range) {
-                for (int facet_idx = range.begin(); facet_idx < range.end(); ++ facet_idx) {
-                    if ((facet_idx & 0x0ffff) == 0)
-                        throw_on_cancel();
-                    this->_slice_do(facet_idx, &lines, &lines_mutex, z);
-                }
-            }
-        );
-    }
+    this->_slice_do(z, lines, throw_on_cancel);
     throw_on_cancel();
 
     // v_scaled_shared could be freed here
@@ -837,42 +827,107 @@ void TriangleMeshSlicer::slice(const std::vector<float> &z, std::vector<Polygons
 #endif
 }
 
-void TriangleMeshSlicer::_slice_do(size_t facet_idx, std::vector<IntersectionLines>* lines, boost::mutex* lines_mutex, 
-    const std::vector<float> &z) const
+// Slice all facets, collect the intersection lines per layer.
+// No lock is taken: The facets crossing at least one slicing plane are sorted by the first layer they cross and sliced
+// in parallel in chunks of consecutive facets. Each chunk produces its own list of lines sorted by layer. Then the lines
+// of each layer are gathered from the chunks in parallel. The resulting order of lines does not depend on the number of threads.
+void TriangleMeshSlicer::_slice_do(const std::vector<float> &z, std::vector<IntersectionLines> &lines, throw_on_cancel_callback_type throw_on_cancel) const
 {
-    const stl_facet &facet = m_use_quaternion ? (this->mesh->stl.facet_start.data() + facet_idx)->rotated(m_quaternion) : *(this->mesh->stl.facet_start.data() + facet_idx);
-    
-    // find facet extents
-    const float min_z = fminf(facet.vertex[0](2), fminf(facet.vertex[1](2), facet.vertex[2](2)));
-    const float max_z = fmaxf(facet.vertex[0](2), fmaxf(facet.vertex[1](2), facet.vertex[2](2)));
-    
-    #ifdef SLIC3R_TRIANGLEMESH_DEBUG
-    printf("\n==> FACET %d (%f,%f,%f - %f,%f,%f - %f,%f,%f):\n", facet_idx,
-        facet.vertex[0](0), facet.vertex[0](1), facet.vertex[0](2),
-        facet.vertex[1](0), facet.vertex[1](1), facet.vertex[1](2),
-        facet.vertex[2](0), facet.vertex[2](1), facet.vertex[2](2));
-    printf("z: min = %.2f, max = %.2f\n", min_z, max_z);
-    #endif /* SLIC3R_TRIANGLEMESH_DEBUG */
-    
-    // find layer extents
-    std::vector<float>::const_iterator min_layer, max_layer;
-    min_layer = std::lower_bound(z.begin(), z.end(), min_z); // first layer whose slice_z is >= min_z
-    max_layer = std::upper_bound(min_layer, z.end(), max_z); // first layer whose slice_z is > max_z
-    #ifdef SLIC3R_TRIANGLEMESH_DEBUG
-    printf("layers: min = %d, max = %d\n", (int)(min_layer - z.begin()), (int)(max_layer - z.begin()));
-    #endif /* SLIC3R_TRIANGLEMESH_DEBUG */
-    
-    for (std::vector<float>::const_iterator it = min_layer; it != max_layer; ++ it) {
-        std::vector<float>::size_type layer_idx = it - z.begin();
-        IntersectionLine il;
-        if (this->slice_facet(*it / SCALING_FACTOR, facet, facet_idx, min_z, max_z, &il) == TriangleMeshSlicer::Slicing) {
-            boost::lock_guard<boost::mutex> l(*lines_mutex);
-            if (il.edge_type == feHorizontal) {
-                // Ignore horizontal triangles. Any valid horizontal triangle must have a vertical triangle connected, otherwise the part has zero volume.
-            } else
-                (*lines)[layer_idx].emplace_back(il);
-        }
-    }
+    const stl_facet *facets     = this->mesh->stl.facet_start.data();
+    const size_t     num_facets = this->mesh->stl.stats.number_of_facets;
+    auto facet_min_z = [](const stl_facet &facet) { return fminf(facet.vertex[0](2), fminf(facet.vertex[1](2), facet.vertex[2](2))); };
+    auto facet_max_z = [](const stl_facet &facet) { return fmaxf(facet.vertex[0](2), fmaxf(facet.vertex[1](2), facet.vertex[2](2))); };
+
+    // Range of layers crossed by a facet.
+    struct FacetLayers {
+        uint32_t facet_idx;
+        // First layer whose slice_z is >= min_z.
+        uint32_t layer_min;
+        // First layer whose slice_z is > max_z.
+        uint32_t layer_max;
+        bool operator<(const FacetLayers &rhs) const 
+            { return this->layer_min < rhs.layer_min || (this->layer_min == rhs.layer_min && this->facet_idx < rhs.facet_idx); }
+    };
+    std::vector<FacetLayers> facet_layers(num_facets);
+    tbb::parallel_for(
+        tbb::blocked_range<size_t>(0, num_facets),
+        [this, facets, &z, &facet_layers, &facet_min_z, &facet_max_z, throw_on_cancel](const tbb::blocked_range<size_t>& range) {
+            for (size_t facet_idx = range.begin(); facet_idx < range.end(); ++ facet_idx) {
+                if ((facet_idx & 0x0ffff) == 0)
+                    throw_on_cancel();
+                const stl_facet facet = m_use_quaternion ? facets[facet_idx].rotated(m_quaternion) : facets[facet_idx];
+                auto min_layer = std::lower_bound(z.begin(), z.end(), facet_min_z(facet));
+                auto max_layer = std::upper_bound(min_layer, z.end(), facet_max_z(facet));
+                facet_layers[facet_idx] = { uint32_t(facet_idx), uint32_t(min_layer - z.begin()), uint32_t(max_layer - z.begin()) };
+            }
+        });
+    // Drop the facets not crossing any slicing plane, sort the rest by their z span.
+    facet_layers.erase(std::remove_if(facet_layers.begin(), facet_layers.end(), [](const FacetLayers &fl) { return fl.layer_min == fl.layer_max; }), facet_layers.end());
+    tbb::parallel_sort(facet_layers.begin(), facet_layers.end());
+    throw_on_cancel();
+
+    struct Chunk {
+        // Range of layers crossed by the facets of this chunk.
+        uint32_t                       layer_min = 0;
+        uint32_t                       layer_max = 0;
+        // Intersection lines of layers <layer_min, layer_max), ordered by the facets.
+        std::vector<IntersectionLines> lines;
+    };
+    // A few chunks per thread for load balancing. Large chunks make most layers covered by a single chunk, whose lines are then moved, not copied.
+    const size_t       chunk_size = std::max<size_t>(4096, (facet_layers.size() + 4 * tbb::task_scheduler_init::default_num_threads() - 1) / (4 * tbb::task_scheduler_init::default_num_threads()));
+    std::vector<Chunk> chunks((facet_layers.size() + chunk_size - 1) / chunk_size);
+    tbb::parallel_for(
+        tbb::blocked_range<size_t>(0, chunks.size()),
+        [this, facets, &z, &facet_layers, &chunks, chunk_size, &facet_min_z, &facet_max_z, throw_on_cancel](const tbb::blocked_range<size_t>& range) {
+            for (size_t chunk_idx = range.begin(); chunk_idx < range.end(); ++ chunk_idx) {
+                throw_on_cancel();
+                Chunk       &chunk = chunks[chunk_idx];
+                const size_t begin = chunk_idx * chunk_size;
+                const size_t end   = std::min(begin + chunk_size, facet_layers.size());
+                chunk.layer_min = chunk.layer_max = facet_layers[begin].layer_min;
+                for (size_t i = begin; i < end; ++ i)
+                    chunk.layer_max = std::max(chunk.layer_max, facet_layers[i].layer_max);
+                chunk.lines.assign(chunk.layer_max - chunk.layer_min, IntersectionLines());
+                for (size_t i = begin; i < end; ++ i) {
+                    const FacetLayers &fl    = facet_layers[i];
+                    const stl_facet    facet = m_use_quaternion ? facets[fl.facet_idx].rotated(m_quaternion) : facets[fl.facet_idx];
+                    const float        min_z = facet_min_z(facet);
+                    const float        max_z = facet_max_z(facet);
+                    for (uint32_t layer_idx = fl.layer_min; layer_idx < fl.layer_max; ++ layer_idx) {
+                        IntersectionLine il;
+                        if (this->slice_facet(z[layer_idx] / SCALING_FACTOR, facet, fl.facet_idx, min_z, max_z, &il) == TriangleMeshSlicer::Slicing &&
+                            // Ignore horizontal triangles. Any valid horizontal triangle must have a vertical triangle connected, otherwise the part has zero volume.
+                            il.edge_type != feHorizontal)
+                            chunk.lines[layer_idx - chunk.layer_min].emplace_back(il);
+                    }
+                }
+            }
+        });
+    throw_on_cancel();
+
+    tbb::parallel_for(
+        tbb::blocked_range<size_t>(0, z.size()),
+        [&chunks, &lines](const tbb::blocked_range<size_t>& range) {
+            std::vector<IntersectionLines*> chunk_lines;
+            for (size_t layer_idx = range.begin(); layer_idx < range.end(); ++ layer_idx) {
+                // The chunks are sorted by their first layer.
+                auto it_end = std::upper_bound(chunks.begin(), chunks.end(), layer_idx, [](size_t layer_idx, const Chunk &chunk) { return layer_idx < chunk.layer_min; });
+                chunk_lines.clear();
+                size_t num_lines = 0;
+                for (auto it = chunks.begin(); it != it_end; ++ it)
+                    if (layer_idx < it->layer_max && ! it->lines[layer_idx - it->layer_min].empty()) {
+                        chunk_lines.emplace_back(&it->lines[layer_idx - it->layer_min]);
+                        num_lines += chunk_lines.back()->size();
+                    }
+                if (chunk_lines.empty())
+                    continue;
+                IntersectionLines &layer_lines = lines[layer_idx];
+                layer_lines = std::move(*chunk_lines.front());
+                layer_lines.reserve(num_lines);
+                for (size_t i = 1; i < chunk_lines.size(); ++ i)
+                    layer_lines.insert(layer_lines.end(), chunk_lines[i]->begin(), chunk_lines[i]->end());
+            }
+        });
 }
 
 void TriangleMeshSlicer::slice(const std::vector<float> &z, const float closing_radius, std::vector<ExPolygons>* layers, throw_on_cancel_callback_type throw_on_cancel) const
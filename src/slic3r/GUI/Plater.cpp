@@ -1963,6 +1963,8 @@ Plater::priv::priv(Plater *q, MainFrame *main_frame)
 {
     this->q->SetFont(Slic3r::GUI::wxGetApp().normal_font());
 
+    // Editing the variable layer height profile slices just the layers with a changed Z span.
+    fff_print.enable_layer_slices_cache(true);
     background_process.set_fff_print(&fff_print);
     background_process.set_sla_print(&sla_print);
     background_process.set_gcode_preview_data(&gcode_preview_data);